@@ -0,0 +1,374 @@
+/// \file	uio_bench.cpp
+/// \brief	Command "bench" of the program "uio": register latency, map bandwidth and interrupt round trip.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#include <algorithm>	// std::sort
+#include <cstdint>		// std::uint64_t
+#include <stdexcept>	// std::runtime_error
+#include <string>		// std::string
+#include <vector>		// std::vector
+
+#include <errno.h>		// errno
+#include <inttypes.h>	// PRIu64
+#include <poll.h>		// poll
+#include <stdio.h>		// fprintf
+#include <string.h>		// strncmp
+#include <time.h>		// clock_gettime
+#include <unistd.h>		// read, write
+
+#include <smart/MappedFile.h>
+#include <smart/string.h>
+
+#include "uio_bench.h"	// ourselves.
+
+using namespace smart;
+
+/// Bytes moved per bandwidth measurement, at least one pass over the map.
+static constexpr std::size_t	BANDWIDTH_BYTES = 16u * 1024u * 1024u;
+
+/// Time to wait for an interrupt, in milliseconds.
+static constexpr int			IRQ_TIMEOUT_MS = 1000;
+
+/// Keeps the compiler from dropping the timed reads.
+static volatile std::uint64_t	_sink;
+
+/// Options of the command.
+struct BenchOptions {
+	unsigned int	map = 0;
+	unsigned int	reg = 0;
+	unsigned int	samples = 10000;
+	/// Maps to measure the bandwidth of; none by default.
+	std::vector<unsigned int>	sweep;
+	bool			write = false;
+	bool			irq = false;
+	std::string		json;
+};
+
+/// Latency distribution of one operation, in nanoseconds.
+struct LatencyResult {
+	std::string		name;
+	std::size_t		samples;
+	std::uint64_t	min;
+	std::uint64_t	p50;
+	std::uint64_t	p90;
+	std::uint64_t	p99;
+	std::uint64_t	p999;
+	std::uint64_t	max;
+};
+
+/// Sequential bandwidth of one map at one access width, in MB/s; negative when not measured.
+struct BandwidthResult {
+	unsigned int	map;
+	std::size_t		size;
+	const char*		width;
+	double			read;
+	double			write;
+};
+
+// --------------------------------------------------------------------------
+static inline std::uint64_t _now_ns()
+{
+	struct timespec	ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+// --------------------------------------------------------------------------
+static LatencyResult _latency_of(const char* name, std::vector<std::uint64_t>& ns)
+{
+	LatencyResult	r;
+	r.name = name;
+	r.samples = ns.size();
+	if (ns.empty()) {
+		r.min = r.p50 = r.p90 = r.p99 = r.p999 = r.max = 0;
+		return r;
+	}
+	std::sort(ns.begin(), ns.end());
+	const auto	at = [&ns](const double q) { return ns[std::min(ns.size() - 1, static_cast<std::size_t>(q * ns.size()))]; };
+	r.min = ns.front();
+	r.p50 = at(0.5);
+	r.p90 = at(0.9);
+	r.p99 = at(0.99);
+	r.p999 = at(0.999);
+	r.max = ns.back();
+	return r;
+}
+
+// --------------------------------------------------------------------------
+/// Time each call of op on its own; the clock is read around every call.
+template <typename OP>
+static LatencyResult _time_each(const char* name, const unsigned int samples, OP op)
+{
+	std::vector<std::uint64_t>	ns(samples);
+	for (unsigned int i=0; i<samples; ++i) {
+		const std::uint64_t	t0 = _now_ns();
+		op();
+		ns[i] = _now_ns() - t0;
+	}
+	return _latency_of(name, ns);
+}
+
+// --------------------------------------------------------------------------
+/// \return MB/s of reading the map sequentially with volatile accesses of type T.
+template <typename T>
+static double _read_bandwidth(MappedFile* map)
+{
+	const volatile T*	p = static_cast<const volatile T*>(map->data());
+	const std::size_t	n = map->size() / sizeof(T);
+	const std::size_t	passes = std::max<std::size_t>(1u, BANDWIDTH_BYTES / map->size());
+	T					sink = 0;
+	const std::uint64_t	t0 = _now_ns();
+	for (std::size_t pass=0; pass<passes; ++pass) {
+		for (std::size_t i=0; i<n; ++i) {
+			sink ^= p[i];
+		}
+	}
+	const std::uint64_t	dt = _now_ns() - t0;
+	_sink = _sink + sink;
+	return static_cast<double>(passes * n * sizeof(T)) * 1e3 / std::max<std::uint64_t>(dt, 1u);
+}
+
+// --------------------------------------------------------------------------
+/// \return MB/s of writing zeros to the map sequentially with volatile accesses of type T.
+template <typename T>
+static double _write_bandwidth(MappedFile* map)
+{
+	volatile T*			p = static_cast<volatile T*>(map->data());
+	const std::size_t	n = map->size() / sizeof(T);
+	const std::size_t	passes = std::max<std::size_t>(1u, BANDWIDTH_BYTES / map->size());
+	const std::uint64_t	t0 = _now_ns();
+	for (std::size_t pass=0; pass<passes; ++pass) {
+		for (std::size_t i=0; i<n; ++i) {
+			p[i] = 0;
+		}
+	}
+	const std::uint64_t	dt = _now_ns() - t0;
+	return static_cast<double>(passes * n * sizeof(T)) * 1e3 / std::max<std::uint64_t>(dt, 1u);
+}
+
+// --------------------------------------------------------------------------
+/// \return MB/s of MappedFile::readBlock, or of MappedFile::fill when writing, in chunks of 64 KiB.
+static double _block_bandwidth(MappedFile* map, const bool write)
+{
+	std::vector<std::uint32_t>	chunk(std::min<std::size_t>(map->size32(), 16u * 1024u));
+	const std::size_t			passes = std::max<std::size_t>(1u, BANDWIDTH_BYTES / map->size());
+	const std::uint64_t			t0 = _now_ns();
+	for (std::size_t pass=0; pass<passes; ++pass) {
+		for (std::size_t index = 0; index < map->size32(); index += chunk.size()) {
+			const std::size_t	count = std::min(chunk.size(), map->size32() - index);
+			if (write) {
+				map->fill(index, 0, count);
+			} else {
+				map->readBlock(index, chunk.data(), count);
+			}
+		}
+	}
+	const std::uint64_t	dt = _now_ns() - t0;
+	_sink = _sink + chunk[0];
+	return static_cast<double>(passes * map->size32() * sizeof(std::uint32_t)) * 1e3 / std::max<std::uint64_t>(dt, 1u);
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+static BandwidthResult _bandwidth_of(const unsigned int map_index, MappedFile* map, const char* width, const bool write)
+{
+	BandwidthResult	r = { map_index, map->size(), width, _read_bandwidth<T>(map), -1.0 };
+	if (write) {
+		r.write = _write_bandwidth<T>(map);
+	}
+	return r;
+}
+
+// --------------------------------------------------------------------------
+/// Enable the interrupt, wait for it and read the count, for the given number of interrupts.
+/// \return false when no interrupt came within IRQ_TIMEOUT_MS.
+static bool _time_irq(LatencyResult& result, const int fd, const unsigned int samples)
+{
+	std::vector<std::uint64_t>	ns;
+	ns.reserve(samples);
+	for (unsigned int i=0; i<samples; ++i) {
+		const std::uint32_t	unmask = 1;
+		const std::uint64_t	t0 = _now_ns();
+		if (write(fd, &unmask, sizeof(unmask)) != sizeof(unmask)) {
+			throw std::runtime_error(ssprintf("uio bench: cannot enable the interrupt: %s", strerror(errno)));
+		}
+		struct pollfd	pfd = { fd, POLLIN, 0 };
+		if (poll(&pfd, 1, IRQ_TIMEOUT_MS) <= 0) {
+			break;
+		}
+		std::uint32_t	count;
+		if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+			throw std::runtime_error(ssprintf("uio bench: cannot read the interrupt count: %s", strerror(errno)));
+		}
+		ns.push_back(_now_ns() - t0);
+	}
+	result = _latency_of("irq round trip", ns);
+	return !ns.empty();
+}
+
+// --------------------------------------------------------------------------
+static BenchOptions _parse_options(const unsigned int argc, const char** argv)
+{
+	BenchOptions	options;
+	for (unsigned int i=0; i<argc; ++i) {
+		const char*	arg = argv[i];
+		if (strncmp(arg, "map=", 4) == 0) {
+			options.map = uint_of(arg + 4);
+		} else if (strncmp(arg, "reg=", 4) == 0) {
+			options.reg = uint_of(arg + 4);
+		} else if (strncmp(arg, "samples=", 8) == 0) {
+			options.samples = std::max(1u, uint_of(arg + 8));
+		} else if (strncmp(arg, "sweep=", 6) == 0) {
+			options.sweep.push_back(uint_of(arg + 6));
+		} else if (strcmp(arg, "write") == 0) {
+			options.write = true;
+		} else if (strcmp(arg, "irq") == 0) {
+			options.irq = true;
+		} else if (strncmp(arg, "json=", 5) == 0) {
+			options.json = arg + 5;
+		} else {
+			throw std::runtime_error(ssprintf("uio bench: unknown argument '%s'", arg));
+		}
+	}
+	return options;
+}
+
+// --------------------------------------------------------------------------
+static void _print_table(
+	FILE*									f,
+	const std::vector<LatencyResult>&		latencies,
+	const std::vector<BandwidthResult>&		bandwidths,
+	const char*								irq_note)
+{
+	fprintf(f, "%-24s %8s %8s %8s %8s %8s %8s %8s\n", "Latency [ns]", "samples", "min", "p50", "p90", "p99", "p99.9", "max");
+	for (const auto& r : latencies) {
+		fprintf(f, "%-24s %8zu %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 "\n",
+			r.name.c_str(), r.samples, r.min, r.p50, r.p90, r.p99, r.p999, r.max);
+	}
+	if (irq_note != nullptr) {
+		fprintf(f, "%-24s %s\n", "irq round trip", irq_note);
+	}
+	if (bandwidths.empty()) {
+		return;
+	}
+	fprintf(f, "\n%-4s %12s %6s %12s %12s\n", "Map", "Size", "Width", "Read [MB/s]", "Write [MB/s]");
+	for (const auto& r : bandwidths) {
+		fprintf(f, "%-4u %12zu %6s %12.1f ", r.map, r.size, r.width, r.read);
+		if (r.write >= 0) {
+			fprintf(f, "%12.1f\n", r.write);
+		} else {
+			fprintf(f, "%12s\n", "-");
+		}
+	}
+}
+
+// --------------------------------------------------------------------------
+static void _print_json(
+	FILE*									f,
+	const UioDevice&						device,
+	const std::vector<LatencyResult>&		latencies,
+	const std::vector<BandwidthResult>&		bandwidths,
+	const char*								irq_note)
+{
+	fprintf(f, "{\n  \"device\": \"%s\",\n  \"index\": %u,\n  \"latency_ns\": [", device.name.c_str(), device.index);
+	for (std::size_t i=0; i<latencies.size(); ++i) {
+		const auto&	r = latencies[i];
+		fprintf(f, "%s\n    { \"op\": \"%s\", \"samples\": %zu, \"min\": %" PRIu64 ", \"p50\": %" PRIu64 ", \"p90\": %" PRIu64
+			", \"p99\": %" PRIu64 ", \"p99.9\": %" PRIu64 ", \"max\": %" PRIu64 " }",
+			i == 0 ? "" : ",", r.name.c_str(), r.samples, r.min, r.p50, r.p90, r.p99, r.p999, r.max);
+	}
+	fprintf(f, "\n  ],\n  \"bandwidth_mb_s\": [");
+	for (std::size_t i=0; i<bandwidths.size(); ++i) {
+		const auto&	r = bandwidths[i];
+		fprintf(f, "%s\n    { \"map\": %u, \"size\": %zu, \"width\": \"%s\", \"read\": %.1f, \"write\": ",
+			i == 0 ? "" : ",", r.map, r.size, r.width, r.read);
+		if (r.write >= 0) {
+			fprintf(f, "%.1f }", r.write);
+		} else {
+			fprintf(f, "null }");
+		}
+	}
+	fprintf(f, "\n  ]");
+	if (irq_note != nullptr) {
+		fprintf(f, ",\n  \"irq\": \"%s\"", irq_note);
+	}
+	fprintf(f, "\n}\n");
+}
+
+// --------------------------------------------------------------------------
+const void uio_bench(std::shared_ptr<UioDevice> device, const unsigned int argc, const char** argv)
+{
+	const BenchOptions	options = _parse_options(argc, argv);
+	MappedFile*			regs = device->getRequiredMap(options.map);
+	if (options.reg >= regs->size32()) {
+		throw std::runtime_error(ssprintf("uio bench: register %u outside of map %u", options.reg, options.map));
+	}
+	// Reads of registers may have side effects, and accesses other than 32-bit may fault on AXI-Lite.
+	for (const unsigned int map_index : options.sweep) {
+		if (map_index == options.map) {
+			throw std::runtime_error(ssprintf("uio bench: map %u holds the timed register, not swept", map_index));
+		}
+		if (map_index >= device->maps.size()) {
+			throw std::runtime_error(ssprintf("uio bench: no map %u", map_index));
+		}
+	}
+
+	// Single register accesses, and the clock itself as the baseline.
+	std::vector<LatencyResult>	latencies;
+	const std::string			reg_name = ssprintf("map%u[%u]", options.map, options.reg);
+	latencies.push_back(_time_each("clock", options.samples, [] { }));
+	latencies.push_back(_time_each(("read32 " + reg_name).c_str(), options.samples, [&] { _sink = _sink + regs->read32(options.reg); }));
+	if (options.write) {
+		const std::uint32_t	value = regs->read32(options.reg);
+		latencies.push_back(_time_each(("write32 " + reg_name).c_str(), options.samples, [&] { regs->write32(options.reg, value); }));
+		latencies.push_back(_time_each(("write32+read32 " + reg_name).c_str(), options.samples, [&] {
+			regs->write32(options.reg, value);
+			_sink = _sink + regs->read32(options.reg);
+		}));
+	}
+
+	const char*	irq_note = nullptr;
+	if (options.irq) {
+		LatencyResult	irq;
+		const int		fd = device->getFileHandle();
+		if (fd == File::NullHandle) {
+			irq_note = "no interrupt";
+		} else if (_time_irq(irq, fd, std::min(options.samples, 1000u))) {
+			latencies.push_back(irq);
+		} else {
+			irq_note = "no interrupt pending";
+		}
+	}
+
+	// Sequential accesses over the maps asked for, memory only.
+	std::vector<BandwidthResult>	bandwidths;
+	for (const unsigned int map_index : options.sweep) {
+		MappedFile*	map = device->getRequiredMap(map_index);
+		map->setMemory(true);
+		bandwidths.push_back(_bandwidth_of<std::uint8_t>(map_index, map, "8", options.write));
+		bandwidths.push_back(_bandwidth_of<std::uint16_t>(map_index, map, "16", options.write));
+		bandwidths.push_back(_bandwidth_of<std::uint32_t>(map_index, map, "32", options.write));
+		bandwidths.push_back(_bandwidth_of<std::uint64_t>(map_index, map, "64", options.write));
+		BandwidthResult	block = { map_index, map->size(), "block", _block_bandwidth(map, false), -1.0 };
+		if (options.write) {
+			block.write = _block_bandwidth(map, true);
+		}
+		bandwidths.push_back(block);
+	}
+
+	const bool	json_stdout = options.json == "-";
+	_print_table(json_stdout ? stderr : stdout, latencies, bandwidths, irq_note);
+	if (json_stdout) {
+		_print_json(stdout, *device, latencies, bandwidths, irq_note);
+	} else if (!options.json.empty()) {
+		FILE*	f = fopen(options.json.c_str(), "w");
+		if (f == nullptr) {
+			throw std::runtime_error(ssprintf("uio bench: cannot open '%s' for writing", options.json.c_str()));
+		}
+		_print_json(f, *device, latencies, bandwidths, irq_note);
+		fclose(f);
+	}
+}
@@ -0,0 +1,24 @@
+/// \file	uio_bench.h
+/// \brief	Command "bench" of the program "uio".
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#pragma once
+
+#include <memory>	// std::shared_ptr
+
+#include <smart/UioDevice.h>
+
+/// Measure the register access latency, the bandwidth of the maps and the interrupt round trip of a device.
+/// Arguments, all optional:
+///	map=N		Map of the register, default 0.
+///	reg=N		Index of the 32-bit register to time, default 0.
+///	samples=N	Latency samples, default 10000.
+///	sweep=N		Measure the bandwidth of map N with 8- to 64-bit and block accesses; repeatable.
+///				Memory maps only: reads of registers may have side effects. Not the map of the register.
+///	write		Time writes as well. Overwrites the register with its own value and the swept maps with zeros!
+///	irq			Time the interrupt round trip: enable, wait, read the count. Needs a pending interrupt.
+///	json=FILE	Write the results as JSON; "-" for the standard output, the table then goes to stderr.
+const void uio_bench(std::shared_ptr<smart::UioDevice> device, const unsigned int argc, const char** argv);
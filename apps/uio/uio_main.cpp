@@ -5,8 +5,10 @@
 /// \date		2017
 /// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
 
+#include <algorithm>	// std::min
 #include <exception>	// std::exception
 #include <sstream>
+#include <vector>		// std::vector
 
 #include <inttypes.h>
 #include <memory>	// std::make_shared
@@ -19,11 +21,14 @@
 
 #include <smart/File.h>
 #include <smart/hw/AxiDataCapture.h>
+#include <smart/hw/CapturePipeline.h>
 #include <smart/string.h>
 #include <smart/time.h>
 #include <smart/UioDevice.h>
 #include <smart/WavFormat.h>
 
+#include "uio_bench.h"	// uio_bench
+
 
 using namespace smart;
 
@@ -34,9 +39,15 @@ static void _print_usage()
 	printf("    uio DEVICE COMMAND ARG1\n");
 	printf("\n");
 	printf("possible commands are\n");
-	printf("    capture time output_file         Capture data from the AXI-Data-Capture IP core and write it as a raw file\n");
+	printf("    capture time output_file [direct] Capture data from the AXI-Data-Capture IP core and write it as a raw file,\n");
+	printf("                                      or as a WAV file when the file name ends with .wav\n");
 	printf("    dump map output_file             Dump the memory area\n");
 	printf("    fill map 32-bit-value            Fill the memory area with 32-bit value\n");
+	printf("                                      map 0, the registers, with 32-bit accesses only\n");
+	printf("    bench [map=N] [reg=N] [samples=N] [sweep=N]... [write] [irq] [json=FILE]\n");
+	printf("                                      Register latency, interrupt round trip and bandwidth of the memory\n");
+	printf("                                      maps given by sweep=; 'write' overwrites the register and the swept\n");
+	printf("                                      maps, json=- prints JSON\n");
 	printf("Example: capture 1 second of data from the UIO device \"RMS-Stream\":\n");
 	printf("    uio RMS-Stream capture 1 rms.raw\n");
 }
@@ -61,7 +72,9 @@ const static void uio_dump(const std::shared_ptr<UioDevice> device, const unsign
 		throw std::runtime_error(err.str());
 	}
 
-	MappedFile*		map = device->maps[map_index].map;
+	MappedFile*		map = device->getRequiredMap(map_index);
+	// Map 0 holds the registers; the maps after it are memory.
+	map->setMemory(map_index > 0);
 
 	FILE*	f = fopen(filename, "wb");
 	if (f == nullptr) {
@@ -70,12 +83,20 @@ const static void uio_dump(const std::shared_ptr<UioDevice> device, const unsign
 		throw std::runtime_error(err.str());
 	} else {
 		printf("Writing file '%s'.\n", filename);
-		const int	r_write = fwrite(map->data(), 1, map->size(), f);
-		if (r_write != static_cast<int>(map->size())) {
-			std::stringstream err;
-			err << "Cannot write: fwrite returned " << r_write << ", errno=" << errno;
-			throw std::runtime_error(err.str());
+		// The map may be device memory: copy it out with aligned accesses, 1 MiB at a time.
+		std::vector<std::uint32_t>	chunk(std::min<std::size_t>(map->size32(), 256u * 1024u));
+		for (std::size_t index = 0; index < map->size32(); index += chunk.size()) {
+			const std::size_t	count = std::min(chunk.size(), map->size32() - index);
+			map->readBlock(index, chunk.data(), count);
+			const std::size_t	r_write = fwrite(chunk.data(), sizeof(std::uint32_t), count, f);
+			if (r_write != count) {
+				std::stringstream err;
+				err << "Cannot write: fwrite returned " << r_write << ", errno=" << errno;
+				fclose(f);
+				throw std::runtime_error(err.str());
+			}
 		}
+		fclose(f);
 		printf("Wrote %zu bytes.\n", map->size());
 	}
 }
@@ -98,22 +119,13 @@ const static void uio_fill(const std::shared_ptr<UioDevice> device, const unsign
 		throw std::runtime_error(err.str());
 	}
 
-	MappedFile*		map = device->maps[map_index].map;
-	const unsigned int	size = map->size32();
-
-	for (unsigned int i=0; i<size; ++i) {
-		map->write32(i, value);
-	}
+	MappedFile*		map = device->getRequiredMap(map_index);
+	// Map 0 holds the registers; the maps after it are memory.
+	map->setMemory(map_index > 0);
+	map->fill(0, value, map->size32());
 	printf("Successfully wrote value %d to map %d\n", value, map_index);
 }
 
-#pragma pack(push, 1)
-	class PacketBuffer {
-	public:
-		uint64_t	payload;
-	};
-#pragma pack(pop)
-
 // --------------------------------------------------------------------------
 const static void uio_capture(std::shared_ptr<UioDevice> device, const unsigned int argc, const char** args)
 {
@@ -132,34 +144,40 @@ const static void uio_capture(std::shared_ptr<UioDevice> device, const unsigned
 	const unsigned int user_time = uint_of(args[0]);
 	const char* filename = args[1];
 
-	PacketBuffer	buffer = { 0 };
-	constexpr int	bufsize = sizeof(buffer);
+	hw::CapturePipeline::Options	options;
+	options.direct_io = argc > 2 && strcmp(args[2], "direct") == 0;
+	if (ends_with(filename, ".wav")) {
+		options.format = hw::CapturePipeline::Format::WAV;
+		printf("Capture format:   WAV, %u channels, %u bits, %u Hz\n", dev.nchannels, dev.sample_width, dev.sample_rate);
+	}
+	hw::CapturePipeline				pipeline(dev, filename, options);
+
 	const uint64_t t0 = time_us();
 	const uint64_t target_time = t0 +  user_time * 1000 * 1000;
-	uint64_t		bytes_written = 0;
-
-	FILE*	f = fopen(filename, "w");
 
-	dev.startCapture(smart::hw::AxiDataCapture::CAPTURE_STREAMING); // 0=streaming
-	while (time_us() < target_time) {
-		volatile PacketBuffer* res = dev.fetchPacket<PacketBuffer>(&buffer);
-		if (res == nullptr) {
-			usleep(1000);
-			continue;
-		}
-		const int r_write = fwrite((const void*)res, sizeof(uint8_t), bufsize, f);
-		if (r_write != bufsize) {
-			throw std::runtime_error(ssprintf("Cannot write: fwrite returned %d, errno=%d", r_write, errno));
-		}
-		bytes_written += r_write;
+	pipeline.start();
+	for (uint64_t now = time_us(); now < target_time; now = time_us()) {
+		msleep(std::min<uint64_t>((target_time - now) / 1000u + 1u, 1000u));
+		const auto stats = pipeline.getStatistics();
+		const auto telemetry = dev.getTelemetry();
+		printf("\r%" PRIu64 " bytes written, %.1f MB/s, ring %u%% full, lag %" PRIu64 " us   ", stats.bytes_written, stats.write_rate() * 1e-6,
+			static_cast<unsigned int>(telemetry.fill_bytes * 100u / telemetry.buffer_size), telemetry.lag_us);
+		fflush(stdout);
 	}
+	const auto	telemetry = dev.getTelemetry();
+	pipeline.stop();
+	printf("\n");
 
-	const uint64_t		real_time = time_us() - t0;
-	dev.stopCapture();
-
-	printf("Capture time: %u ms\n", static_cast<unsigned int>(real_time / 1000u));
-	printf("Bytes written: %" PRIu64 "\n", bytes_written);
-	printf("Data rate:  %g bytes/sec\n", bytes_written / (real_time * 1e-6));
+	const auto	stats = pipeline.getStatistics();
+	printf("Capture time: %u ms\n", static_cast<unsigned int>(stats.elapsed_us / 1000u));
+	printf("Bytes written: %" PRIu64 "%s\n", stats.bytes_written, stats.direct_io ? " (O_DIRECT)" : "");
+	printf("Data rate:  %g bytes/sec\n", stats.write_rate());
+	printf("Max buffers queued: %u, reader stalls: %" PRIu64 "\n", stats.max_buffers_queued, stats.reader_stalls);
+	printf("Max ring fill: %" PRIu64 " of %" PRIu64 " bytes, max fetch latency: %" PRIu64 " us\n", telemetry.max_fill_bytes, telemetry.buffer_size, telemetry.max_fetch_latency_us);
+	printf("AXI bursts: %u ok, %u failed\n", telemetry.burst_successes, telemetry.burst_errors);
+	if (telemetry.loss.overruns > 0) {
+		printf("Overruns: %" PRIu64 ", bytes lost: %" PRIu64 "\n", telemetry.loss.overruns, telemetry.loss.bytes_lost);
+	}
 }
 
 const static void uio_list(std::shared_ptr<UioDevice> device, const unsigned int argc, const char** argv)
@@ -185,6 +203,7 @@ static const CommandInfo commands[] = {
 		{ "capture", 2, uio_capture },
 		{ "fill", 2, uio_fill },
 		{ "dump", 2, uio_dump },
+		{ "bench", 0, uio_bench },
 		{ nullptr, 0, nullptr }
 };
 
@@ -0,0 +1,137 @@
+/// \file	bench_capture.cpp
+/// \brief	Consumer throughput of AxiDataCapture on the emulated IP core.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#include <algorithm>	// std::max
+#include <cstdint>		// std::uint8_t
+#include <exception>	// std::exception
+#include <vector>		// std::vector
+
+#include <inttypes.h>	// PRIu64
+#include <stdio.h>		// printf
+#include <string.h>		// memcpy
+
+#include <smart/hw/AxiDataCapture.h>
+#include <smart/hw/AxiDataCaptureEmulator.h>
+#include <smart/hw/CapturePipeline.h>
+#include <smart/string.h>
+#include <smart/time.h>
+
+using namespace smart;
+
+/// Bytes moved through the ring per measurement.
+static constexpr std::size_t	DATA_SIZE = 1024u * 1024u * 1024u;
+
+// --------------------------------------------------------------------------
+/// reserve/copy/release in lockstep with the emulator, i.e. the cost of the consumer side alone.
+static void _bench_consumer(const std::size_t chunk_size)
+{
+	hw::AxiDataCaptureEmulator::Options	options;
+	options.buffer_size = 4u * 1024u * 1024u;
+	options.pattern = hw::AxiDataCaptureEmulator::Pattern::ZERO;
+	hw::AxiDataCaptureEmulator	emulator(options);
+	hw::AxiDataCapture			dev(emulator.getDevice());
+	std::vector<std::uint8_t>	buffer(chunk_size);
+
+	dev.startCapture(hw::AxiDataCapture::CAPTURE_STREAMING);
+	std::uint64_t	consumer_us = 0;
+	for (std::size_t done = 0; done < DATA_SIZE; done += chunk_size) {
+		emulator.advance(chunk_size);
+		const std::uint64_t	t0 = time_us();
+		const auto			region = dev.reserve(chunk_size);
+		memcpy(&buffer[0], region.first.data(), region.first.size());
+		memcpy(&buffer[region.first.size()], region.second.data(), region.second.size());
+		dev.release(region.size());
+		consumer_us += time_us() - t0;
+	}
+	printf("%12zu %16.1f\n", chunk_size, static_cast<double>(DATA_SIZE) / std::max<std::uint64_t>(consumer_us, 1u));
+}
+
+// --------------------------------------------------------------------------
+/// Small packets fetched one by one, in batches, and in batches with head caching.
+static void _bench_packets(const char* name, const std::size_t batch, const bool head_caching)
+{
+	typedef std::uint64_t	Packet;
+	static constexpr std::size_t	ROUND_SIZE = 64u * 1024u;
+	hw::AxiDataCaptureEmulator::Options	options;
+	options.buffer_size = 4u * 1024u * 1024u;
+	options.pattern = hw::AxiDataCaptureEmulator::Pattern::ZERO;
+	hw::AxiDataCaptureEmulator	emulator(options);
+	hw::AxiDataCapture			dev(emulator.getDevice());
+	std::vector<Packet>			packets(batch);
+
+	dev.setHeadCaching(head_caching);
+	dev.startCapture(hw::AxiDataCapture::CAPTURE_STREAMING);
+	std::uint64_t	consumer_us = 0;
+	for (std::size_t done = 0; done < DATA_SIZE / 16u; done += ROUND_SIZE) {
+		emulator.advance(ROUND_SIZE);
+		const std::uint64_t	t0 = time_us();
+		for (std::size_t n = 0; n < ROUND_SIZE / sizeof(Packet); ) {
+			if (batch == 1) {
+				n += dev.fetchPacket(&packets[0]) != nullptr ? 1u : 0u;
+			} else {
+				n += dev.fetchPackets(packets.data(), batch);
+			}
+		}
+		consumer_us += time_us() - t0;
+	}
+	printf("%24s %16.1f\n", name, static_cast<double>(DATA_SIZE / 16u) / std::max<std::uint64_t>(consumer_us, 1u));
+}
+
+// --------------------------------------------------------------------------
+/// Capture to a file at the given data rate and report the overruns.
+static void _bench_pipeline(const unsigned int sample_rate, const char* filename)
+{
+	hw::AxiDataCaptureEmulator::Options	options;
+	options.nchannels = 8;
+	options.sample_rate = sample_rate;
+	options.buffer_size = 4u * 1024u * 1024u;
+	hw::AxiDataCaptureEmulator	emulator(options);
+	hw::AxiDataCapture			dev(emulator.getDevice());
+	hw::CapturePipeline			pipeline(dev, filename);
+
+	emulator.startProducer();
+	pipeline.start();
+	msleep(2000);
+	pipeline.stop();
+	emulator.stopProducer();
+
+	const auto	stats = pipeline.getStatistics();
+	const auto	telemetry = dev.getTelemetry();
+	printf("%12.1f %16.1f %10" PRIu64 " %14" PRIu64 " %12" PRIu64 "\n", sample_rate * 16e-6, stats.write_rate() * 1e-6,
+		telemetry.loss.overruns, telemetry.max_fill_bytes, telemetry.max_fetch_latency_us);
+}
+
+// --------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	try {
+		const char*	filename = argc > 1 ? argv[1] : "/dev/null";
+
+		printf("Consumer, %zu MiB per chunk size\n", DATA_SIZE >> 20);
+		printf("%12s %16s\n", "chunk", "MB/s");
+		for (const std::size_t chunk_size : { 4096u, 65536u, 1048576u }) {
+			_bench_consumer(chunk_size);
+		}
+
+		printf("\n8-byte packets, %zu MiB\n", (DATA_SIZE / 16u) >> 20);
+		printf("%24s %16s\n", "fetch", "MB/s");
+		_bench_packets("fetchPacket", 1, false);
+		_bench_packets("fetchPacket, cached head", 1, true);
+		_bench_packets("fetchPackets x512", 512, false);
+		_bench_packets("fetchPackets x512, cached", 512, true);
+
+		printf("\nCapture pipeline to %s, 2 s per data rate\n", filename);
+		printf("%12s %16s %10s %14s %12s\n", "MB/s in", "MB/s written", "overruns", "max fill", "max gap us");
+		for (const unsigned int sample_rate : { 1000000u, 4000000u, 16000000u }) {
+			_bench_pipeline(sample_rate, filename);
+		}
+	} catch (const std::exception& ex) {
+		fprintf(stderr, "Error: %s\n", ex.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,81 @@
+/// \file	bench_interleave.cpp
+/// \brief	Throughput of the channel interleaving functions.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#include <algorithm>	// std::min
+#include <cstdint>		// std::uint8_t
+#include <exception>	// std::exception
+#include <vector>		// std::vector
+
+#include <stdio.h>		// printf
+
+#include <smart/Interleave.h>
+#include <smart/string.h>
+#include <smart/time.h>
+
+using namespace smart;
+
+/// Bytes of interleaved data per run, large enough to leave the caches.
+static constexpr std::size_t	DATA_SIZE = 64u * 1024u * 1024u;
+
+typedef void (*DeinterleaveFunction)(void* const*, const void*, unsigned int, unsigned int, std::size_t);
+typedef void (*InterleaveFunction)(void*, const void* const*, unsigned int, unsigned int, std::size_t);
+
+// --------------------------------------------------------------------------
+/// Best of a few runs, in MB/s.
+template <class F>
+static double _measure(F f, const unsigned int runs)
+{
+	std::uint64_t	best_us = UINT64_MAX;
+	for (unsigned int i=0; i<runs; ++i) {
+		const std::uint64_t	t0 = time_us();
+		f();
+		best_us = std::min(best_us, time_us() - t0);
+	}
+	return static_cast<double>(DATA_SIZE) / std::max<std::uint64_t>(best_us, 1u);
+}
+
+// --------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	try {
+		const unsigned int	runs = argc > 1 ? uint_of(argv[1]) : 5u;
+		const unsigned int	widths[] = { 1, 2, 3, 4 };
+		const unsigned int	channel_counts[] = { 2, 4, 8, 16, 3, 6 };
+
+		std::vector<std::uint8_t>	frames(DATA_SIZE, 0x5A);
+		std::vector<std::uint8_t>	planes(DATA_SIZE);
+
+		printf("Implementation: %s, %zu MiB per run, best of %u runs\n", Interleave::implementation(), DATA_SIZE >> 20, runs);
+		printf("%5s %8s %16s %16s %16s %16s\n", "bits", "channels", "deint MB/s", "deint ref MB/s", "int MB/s", "int ref MB/s");
+		for (const unsigned int width : widths) {
+			for (const unsigned int nchannels : channel_counts) {
+				const std::size_t	nframes = DATA_SIZE / (width * nchannels);
+				const std::size_t	plane_size = nframes * width;
+				std::vector<void*>			channels;
+				std::vector<const void*>	const_channels;
+				for (unsigned int c=0; c<nchannels; ++c) {
+					channels.push_back(&planes[c * plane_size]);
+					const_channels.push_back(&planes[c * plane_size]);
+				}
+
+				auto	deint = [&](DeinterleaveFunction f) {
+					return _measure([&]() { f(channels.data(), frames.data(), nchannels, width, nframes); }, runs);
+				};
+				auto	inter = [&](InterleaveFunction f) {
+					return _measure([&]() { f(frames.data(), const_channels.data(), nchannels, width, nframes); }, runs);
+				};
+				printf("%5u %8u %16.1f %16.1f %16.1f %16.1f\n", width * 8, nchannels,
+					deint(Interleave::deinterleave), deint(Interleave::deinterleaveScalar),
+					inter(Interleave::interleave), inter(Interleave::interleaveScalar));
+			}
+		}
+	} catch (const std::exception& ex) {
+		fprintf(stderr, "Error: %s\n", ex.what());
+		return 1;
+	}
+	return 0;
+}
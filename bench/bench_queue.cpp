@@ -0,0 +1,111 @@
+/// \file	bench_queue.cpp
+/// \brief	Throughput of ts::Queue and ts::BoundedQueue with several producer and consumer threads.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#include <algorithm>	// std::max
+#include <atomic>		// std::atomic
+#include <cstdint>		// std::uint64_t
+#include <thread>		// std::thread
+#include <vector>		// std::vector
+
+#include <stdio.h>		// printf
+
+#include <smart/ts/BoundedQueue.h>
+#include <smart/ts/Queue.h>
+#include <smart/time.h>
+
+using namespace smart;
+
+/// Elements moved per measurement, over all producers.
+static constexpr std::uint64_t	COUNT = 2u * 1000u * 1000u;
+
+/// Slots of the bounded queue.
+static constexpr unsigned int	QUEUE_SIZE = 4096u;
+
+// --------------------------------------------------------------------------
+/// Push one element; the bounded queue is retried while full.
+static void _push(ts::Queue<std::uint64_t>& queue, const std::uint64_t e)
+{
+	queue.push(e);
+}
+
+static void _push(ts::BoundedQueue<std::uint64_t>& queue, const std::uint64_t e)
+{
+	while (!queue.try_push(e)) {
+		// Full: let a consumer run, in case they share a core.
+		std::this_thread::yield();
+	}
+}
+
+// --------------------------------------------------------------------------
+/// Pop one element if any.
+static bool _pop(ts::Queue<std::uint64_t>& queue, std::uint64_t& e)
+{
+	return queue.pop(e);
+}
+
+static bool _pop(ts::BoundedQueue<std::uint64_t>& queue, std::uint64_t& e)
+{
+	return queue.try_pop(e);
+}
+
+// --------------------------------------------------------------------------
+/// Move COUNT elements from n_producers threads to n_consumers threads.
+/// \return Million elements per second.
+template <typename QUEUE>
+static double _run(QUEUE& queue, const unsigned int n_producers, const unsigned int n_consumers)
+{
+	const std::uint64_t			per_producer = COUNT / n_producers;
+	const std::uint64_t			total = per_producer * n_producers;
+	std::atomic<std::uint64_t>	popped(0u);
+	std::atomic<std::uint64_t>	sum(0u);
+
+	const std::uint64_t	t0 = time_us();
+	std::vector<std::thread>	threads;
+	for (unsigned int p=0; p<n_producers; ++p) {
+		threads.emplace_back([&queue, p, per_producer] {
+			for (std::uint64_t i = 0; i < per_producer; ++i) {
+				_push(queue, p * per_producer + i);
+			}
+		});
+	}
+	for (unsigned int c=0; c<n_consumers; ++c) {
+		threads.emplace_back([&queue, &popped, &sum, total] {
+			std::uint64_t	local_sum = 0;
+			while (popped.load(std::memory_order_relaxed) < total) {
+				std::uint64_t	e;
+				if (_pop(queue, e)) {
+					local_sum += e;
+					popped.fetch_add(1u, std::memory_order_relaxed);
+				} else {
+					std::this_thread::yield();
+				}
+			}
+			sum.fetch_add(local_sum);
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	const std::uint64_t	dt = std::max<std::uint64_t>(time_us() - t0, 1u);
+	if (sum.load() != total * (total - 1u) / 2u) {
+		printf("Checksum mismatch!\n");
+	}
+	return static_cast<double>(total) / dt;
+}
+
+// --------------------------------------------------------------------------
+int main()
+{
+	printf("%-16s %10s %10s %16s\n", "Queue", "Producers", "Consumers", "M elements/s");
+	for (const unsigned int n : { 1u, 2u, 4u }) {
+		ts::Queue<std::uint64_t>		locked;
+		printf("%-16s %10u %10u %16.2f\n", "Queue", n, n, _run(locked, n, n));
+		ts::BoundedQueue<std::uint64_t>	bounded(QUEUE_SIZE);
+		printf("%-16s %10u %10u %16.2f\n", "BoundedQueue", n, n, _run(bounded, n, n));
+	}
+	return 0;
+}
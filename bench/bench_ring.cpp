@@ -0,0 +1,95 @@
+/// \file	bench_ring.cpp
+/// \brief	Throughput of CircularBuffer and SpscRing between two threads.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#include <algorithm>	// std::max
+#include <cstdint>		// std::uint64_t
+#include <thread>		// std::thread
+#include <vector>		// std::vector
+
+#include <stdio.h>		// printf
+
+#include <smart/CircularBuffer.h>
+#include <smart/SpscRing.h>
+#include <smart/time.h>
+
+using namespace smart;
+
+/// Elements moved per measurement.
+static constexpr std::uint64_t	COUNT = 20u * 1000u * 1000u;
+
+/// Slots of the rings.
+static constexpr unsigned int	RING_SIZE = 4096u;
+
+// --------------------------------------------------------------------------
+/// Move COUNT elements from a producer thread to the calling thread, batch elements per call.
+/// \return Million elements per second.
+template <typename RING>
+static double _run(RING& ring, const unsigned int batch)
+{
+	const std::uint64_t	t0 = time_us();
+	std::thread	producer([&ring, batch] {
+		std::vector<std::uint64_t>	items(batch);
+		for (std::uint64_t i = 0; i < COUNT; ) {
+			bool	pushed;
+			if (batch == 1) {
+				pushed = ring.push(i);
+			} else {
+				for (unsigned int k=0; k<batch; ++k) {
+					items[k] = i + k;
+				}
+				pushed = ring.push(items.data(), items.data() + batch);
+			}
+			if (pushed) {
+				i += batch;
+			} else {
+				// Full: let the consumer run, in case both share a core.
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	std::vector<std::uint64_t>	items(batch);
+	std::uint64_t				sum = 0;
+	for (std::uint64_t done = 0; done < COUNT; ) {
+		unsigned int	n = 0;
+		if (batch == 1) {
+			std::uint64_t	e;
+			if (ring.pop(e)) {
+				sum += e;
+				n = 1;
+			}
+		} else {
+			n = ring.pop_n(items.data(), batch);
+			for (unsigned int k=0; k<n; ++k) {
+				sum += items[k];
+			}
+		}
+		if (n == 0) {
+			std::this_thread::yield();
+		}
+		done += n;
+	}
+	producer.join();
+	const std::uint64_t	dt = std::max<std::uint64_t>(time_us() - t0, 1u);
+	if (sum != COUNT * (COUNT - 1u) / 2u) {
+		printf("Checksum mismatch!\n");
+	}
+	return static_cast<double>(COUNT) / dt;
+}
+
+// --------------------------------------------------------------------------
+int main()
+{
+	printf("%-16s %8s %16s\n", "Ring", "Batch", "M elements/s");
+	for (const unsigned int batch : { 1u, 16u, 256u }) {
+		CircularBuffer<std::uint64_t>	circular(RING_SIZE);
+		printf("%-16s %8u %16.1f\n", "CircularBuffer", batch, _run(circular, batch));
+		SpscRing<std::uint64_t>			spsc(RING_SIZE);
+		printf("%-16s %8u %16.1f\n", "SpscRing", batch, _run(spsc, batch));
+	}
+	return 0;
+}
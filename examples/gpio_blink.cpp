@@ -11,15 +11,20 @@
 #include <csignal>
 #include <unistd.h>
 
+#include "smart/RegisterMap.h"
 #include "smart/UioDevice.h"
 
-// Xilinx AXI GPIO register indices (32-bit word addressing)
-enum Reg : uint32_t {
-    GPIO_DATA  = 0,  // Channel 1 Data
-    GPIO_TRI   = 1,  // Channel 1 Tri-state (0 = output)
-    GPIO2_DATA = 2,  // Channel 2 Data
-    GPIO2_TRI  = 3,  // Channel 2 Tri-state
-};
+// Xilinx AXI GPIO registers (32-bit word addressing)
+using namespace smart::RegisterMap;
+typedef Register<0> GPIO_DATA;   // Channel 1 Data
+typedef Register<1> GPIO_TRI;    // Channel 1 Tri-state (0 = output)
+typedef Register<2> GPIO2_DATA;  // Channel 2 Data
+typedef Register<3> GPIO2_TRI;   // Channel 2 Tri-state
+typedef Block<4>    GpioRegisters;
+
+// Bit 0 of channel 1
+typedef Field<GPIO_DATA, 0, 1> GPIO_DATA_BIT0;
+typedef Field<GPIO_TRI, 0, 1>  GPIO_TRI_BIT0;
 
 static volatile sig_atomic_t running = 1;
 
@@ -30,11 +35,10 @@ int main(int argc, char* argv[])
     const char* dev = argc > 1 ? argv[1] : "gpio";
 
     smart::UioDevice uio(dev);
-    smart::MappedFile* regs = uio.getRequiredMap(0);
+    GpioRegisters regs(uio.getRequiredMap(0));
 
     // Configure bit 0 as output
-    uint32_t tri = regs->read32(GPIO_TRI);
-    regs->write32(GPIO_TRI, tri & ~1u);
+    regs.modify<GPIO_TRI_BIT0::Clear>();
 
     std::fprintf(stderr, "gpio_blink: %s bit 0, 1 Hz (ctrl-C to quit)\n", dev);
 
@@ -44,12 +48,12 @@ int main(int argc, char* argv[])
     uint32_t state = 0;
     while (running) {
         state ^= 1;
-        regs->write32(GPIO_DATA, (regs->read32(GPIO_DATA) & ~1u) | state);
+        regs.set<GPIO_DATA_BIT0>(state);
         usleep(500'000);  // 500 ms half-period → 1 Hz
     }
 
     // Turn off on exit
-    regs->write32(GPIO_DATA, regs->read32(GPIO_DATA) & ~1u);
+    regs.modify<GPIO_DATA_BIT0::Clear>();
     std::fprintf(stderr, "\ngpio_blink: exiting\n");
     return 0;
 }
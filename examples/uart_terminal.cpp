@@ -10,71 +10,79 @@
 #include <cstdio>
 #include <cstdint>
 #include <cstring>
-#include <cerrno>
 #include <unistd.h>
-#include <poll.h>
 #include <termios.h>
 
+#include "smart/RegisterMap.h"
 #include "smart/UioDevice.h"
-
-// 16550 register indices (32-bit word addressing)
-enum Reg : uint32_t {
-    RBR = 0,  // Receive Buffer (read)
-    THR = 0,  // Transmit Holding (write)
-    IER = 1,  // Interrupt Enable
-    IIR = 2,  // Interrupt Identification (read)
-    FCR = 2,  // FIFO Control (write)
-    LCR = 3,  // Line Control
-    MCR = 4,  // Modem Control
-    LSR = 5,  // Line Status
-    MSR = 6,  // Modem Status
-    SCR = 7,  // Scratch
-    DLL = 0,  // Divisor Latch Low  (LCR.DLAB=1)
-    DLM = 1,  // Divisor Latch High (LCR.DLAB=1)
-};
+#include "smart/UioEventLoop.h"
+
+// 16550 registers (32-bit word addressing)
+using namespace smart::RegisterMap;
+typedef Register<0, ReadOnly>  RBR;  // Receive Buffer
+typedef Register<0, WriteOnly> THR;  // Transmit Holding
+typedef Register<1>            IER;  // Interrupt Enable
+typedef Register<2, ReadOnly>  IIR;  // Interrupt Identification
+typedef Register<2, WriteOnly> FCR;  // FIFO Control
+typedef Register<3>            LCR;  // Line Control
+typedef Register<4>            MCR;  // Modem Control
+typedef Register<5, ReadOnly>  LSR;  // Line Status
+typedef Register<6, ReadOnly>  MSR;  // Modem Status
+typedef Register<7>            SCR;  // Scratch
+typedef Register<0>            DLL;  // Divisor Latch Low  (LCR.DLAB=1)
+typedef Register<1>            DLM;  // Divisor Latch High (LCR.DLAB=1)
+typedef Block<8>               UartRegisters;
 
 // LSR bits
-constexpr uint32_t LSR_DR   = 0x01;  // Data Ready
-constexpr uint32_t LSR_THRE = 0x20;  // TX Holding Register Empty
+typedef Field<LSR, 0, 1> LSR_DR;     // Data Ready
+typedef Field<LSR, 5, 1> LSR_THRE;   // TX Holding Register Empty
 
 // IER bits
-constexpr uint32_t IER_RDI  = 0x01;  // Receive Data Available
+typedef Field<IER, 0, 1> IER_RDI;    // Receive Data Available
+
+// FCR bits
+typedef Field<FCR, 0, 1> FCR_ENABLE;    // Enable FIFOs
+typedef Field<FCR, 1, 1> FCR_RX_RESET;  // Reset RX FIFO
+typedef Field<FCR, 2, 1> FCR_TX_RESET;  // Reset TX FIFO
+
+// LCR bits
+typedef Field<LCR, 0, 2> LCR_WLS;    // Word length - 5
+typedef Field<LCR, 7, 1> LCR_DLAB;   // Divisor Latch Access
 
-static void set_baud(smart::MappedFile* regs, uint32_t clk_hz, uint32_t baud)
+static void set_baud(UartRegisters& regs, uint32_t clk_hz, uint32_t baud)
 {
     uint32_t divisor = clk_hz / (16 * baud);
-    uint32_t lcr = regs->read32(LCR);
-    regs->write32(LCR, lcr | 0x80);       // Set DLAB
-    regs->write32(DLL, divisor & 0xFF);
-    regs->write32(DLM, (divisor >> 8) & 0xFF);
-    regs->write32(LCR, lcr & ~0x80u);     // Clear DLAB
+    regs.modify<LCR_DLAB::Set>();
+    regs.write<DLL>(divisor & 0xFF);
+    regs.write<DLM>((divisor >> 8) & 0xFF);
+    regs.modify<LCR_DLAB::Clear>();
 }
 
-static void uart_init(smart::MappedFile* regs, uint32_t clk_hz, uint32_t baud)
+static void uart_init(UartRegisters& regs, uint32_t clk_hz, uint32_t baud)
 {
-    regs->write32(IER, 0x00);             // Disable all interrupts
-    regs->write32(FCR, 0x07);             // Enable & reset FIFOs
-    regs->write32(LCR, 0x03);             // 8N1
-    regs->write32(MCR, 0x00);             // No flow control
+    regs.write<IER>(0x00);                                                  // Disable all interrupts
+    regs.assign<FCR_ENABLE::Set, FCR_RX_RESET::Set, FCR_TX_RESET::Set>();   // Enable & reset FIFOs
+    regs.assign<LCR_WLS::Value<3>>();                                       // 8N1
+    regs.write<MCR>(0x00);                                                  // No flow control
     set_baud(regs, clk_hz, baud);
-    regs->write32(IER, IER_RDI);          // Enable RX interrupt
+    regs.assign<IER_RDI::Set>();                                            // Enable RX interrupt
 }
 
 // Drain all available bytes from the UART RX FIFO
-static void drain_rx(smart::MappedFile* regs)
+static void drain_rx(UartRegisters& regs)
 {
-    while (regs->read32(LSR) & LSR_DR) {
-        char c = static_cast<char>(regs->read32(RBR) & 0xFF);
+    while (regs.isSet<LSR_DR>()) {
+        char c = static_cast<char>(regs.read<RBR>() & 0xFF);
         write(STDOUT_FILENO, &c, 1);
     }
 }
 
 // Transmit one byte, busy-wait for THRE
-static void tx_byte(smart::MappedFile* regs, uint8_t b)
+static void tx_byte(UartRegisters& regs, uint8_t b)
 {
-    while (!(regs->read32(LSR) & LSR_THRE))
+    while (!regs.isSet<LSR_THRE>())
         ;
-    regs->write32(THR, b);
+    regs.write<THR>(b);
 }
 
 int main(int argc, char* argv[])
@@ -85,7 +93,7 @@ int main(int argc, char* argv[])
 
     // Open the UIO device by name
     smart::UioDevice uio(dev);
-    smart::MappedFile* regs = uio.getRequiredMap(0);
+    UartRegisters regs(uio.getRequiredMap(0));
 
     uart_init(regs, clk_hz, baud);
     std::fprintf(stderr, "uart_terminal: %s @ %u baud (ctrl-C to quit)\n", dev, baud);
@@ -97,44 +105,24 @@ int main(int argc, char* argv[])
     cfmakeraw(&raw);
     tcsetattr(STDIN_FILENO, TCSANOW, &raw);
 
-    int uio_fd = uio.getFileHandle();
+    smart::UioEventLoop loop;
 
-    struct pollfd fds[2] = {
-        { .fd = STDIN_FILENO, .events = POLLIN, .revents = 0 },
-        { .fd = uio_fd,       .events = POLLIN, .revents = 0 },
-    };
-
-    bool running = true;
-    while (running) {
-        int ret = poll(fds, 2, -1);
-        if (ret < 0) {
-            if (errno == EINTR) continue;
-            break;
+    // Keyboard → UART TX
+    loop.addFile(STDIN_FILENO, [&](uint32_t) {
+        char buf[64];
+        ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+        for (ssize_t i = 0; i < n; ++i) {
+            if (buf[i] == 0x03) { loop.stop(); break; }  // Ctrl-C
+            tx_byte(regs, static_cast<uint8_t>(buf[i]));
         }
+    });
 
-        // Keyboard → UART TX
-        if (fds[0].revents & POLLIN) {
-            char buf[64];
-            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
-            for (ssize_t i = 0; i < n; ++i) {
-                if (buf[i] == 0x03) { running = false; break; }  // Ctrl-C
-                tx_byte(regs, static_cast<uint8_t>(buf[i]));
-            }
-        }
+    // UART RX interrupt → screen; the loop acknowledges and re-enables the UIO interrupt
+    loop.add(uio, [&](const smart::UioEventLoop::Interrupt&) {
+        drain_rx(regs);
+    });
 
-        // UART RX interrupt → screen
-        if (fds[1].revents & POLLIN) {
-            // Acknowledge the UIO interrupt (read the count)
-            uint32_t irq_count;
-            read(uio_fd, &irq_count, sizeof(irq_count));
-
-            drain_rx(regs);
-
-            // Re-enable the UIO interrupt
-            uint32_t unmask = 1;
-            write(uio_fd, &unmask, sizeof(unmask));
-        }
-    }
+    loop.run();
 
     // Restore terminal
     tcsetattr(STDIN_FILENO, TCSANOW, &orig);
@@ -9,13 +9,23 @@
 
 #include <algorithm>	// std::max
 #include <atomic>		// std::atomic
+#include <chrono>		// std::chrono::steady_clock
+#include <cstddef>		// std::size_t
+#include <span>			// std::span
 #include <vector>		// std::vector
 
+#include "futex.h"		// futex_wait, futex_wake
+
 
 namespace smart {
 
-/// Lock-free circular buffer.
-template <class E>
+/// Lock-free circular buffer for one producer thread and one consumer thread.
+///
+/// With BLOCKING, either side can block until the other has made progress with #wait_for_data and #wait_for_space.
+/// These park the thread on a futex on the index of the other side, which wakes it only when it is parked.
+/// The price is paid by every push and pop: a sequentially consistent store and load, a full barrier on ARM.
+/// Without BLOCKING, the indices are published with a release store only; see also BlockingCircularBuffer.
+template <class E, bool BLOCKING = false>
 class CircularBuffer {
 private:
 	enum class OPERATION {
@@ -23,12 +33,30 @@ private:
 		POP
 	};
 public:
+	/// Up to two pieces of the buffer, for #reserve and #readable.
+	template <class T>
+	struct Region {
+		/// Elements starting at the index.
+		std::span<T>	first;
+
+		/// Continuation at the start of the buffer, if any.
+		std::span<T>	second;
+
+		/// Total number of elements in both pieces.
+		std::size_t size() const
+		{
+			return first.size() + second.size();
+		}
+	};
+
 	/// Initialize buffer to empty state.
 	CircularBuffer(const unsigned int size)
 	: buffer_(size)
 	{
 		push_index_ = 0u;
 		pop_index_ = 0u;
+		consumer_parked_ = 0u;
+		producer_parked_ = 0u;
 	}
 
 	/// Push element \c e into buffer.
@@ -41,7 +69,7 @@ public:
 			return false;
 		} else {
 			buffer_[push_index] = e;
-			push_index_.store(next_push_index, std::memory_order_release);
+			publish_push_index(next_push_index);
 			return true;
 		}
 	}
@@ -66,20 +94,48 @@ public:
 				push_index = (push_index + this_round) % buffer_.size();
 			}
 
-			push_index_.store(push_index, std::memory_order_release);
+			publish_push_index(push_index);
 			return true;
 		} else {
 			return false;
 		}
 	}
 
+	/// Producer: free locations to be written in place, up to n of them; make them visible with #commit.
+	/// \return The locations, fewer than n when the buffer is short of room.
+	Region<E> reserve(const unsigned int n)
+	{
+		const auto	push_index = push_index_.load(std::memory_order_relaxed);
+		return region<E>(push_index, std::min(n, available()));
+	}
+
+	/// Producer: publish the first n locations returned by #reserve; doesn't check n.
+	void commit(const unsigned int n)
+	{
+		const auto	push_index = push_index_.load(std::memory_order_relaxed);
+		publish_push_index((push_index + n) % buffer_.size());
+	}
+
+	/// Consumer: all elements stored, in place; free them with #consume.
+	Region<const E> readable() const
+	{
+		const auto	pop_index = pop_index_.load(std::memory_order_relaxed);
+		return region<const E>(pop_index, size());
+	}
+
+	/// Consumer: drop the first n elements returned by #readable; doesn't check n.
+	void consume(const unsigned int n)
+	{
+		pop_n(n);
+	}
+
 	/// Pop an element, note that it doesn't check for failure!
 	/// \return Popped element.
 	E pop()
 	{
 		const auto	pop_index = pop_index_.load(std::memory_order_relaxed);
 		const E		r = buffer_[pop_index];
-		pop_index_.store((pop_index + 1) % buffer_.size(), std::memory_order_release);
+		publish_pop_index((pop_index + 1) % buffer_.size());
 		return r;
 	}
 
@@ -96,7 +152,7 @@ public:
 	{
 		const unsigned int	pop_index = pop_index_.load(std::memory_order_acquire);
 		const unsigned int	new_pop_index = (pop_index + n) % buffer_.size();
-		pop_index_.store(new_pop_index, std::memory_order_release);
+		publish_pop_index(new_pop_index);
 	}
 
 	/// Peek for an element, note that it doesn't check for a failure!
@@ -154,7 +210,7 @@ public:
 			return false;
 		} else {
 			e = buffer_[pop_index];
-			pop_index_.store((pop_index_ + 1) % buffer_.size(), std::memory_order_release);
+			publish_pop_index((pop_index + 1) % buffer_.size());
 			return true;
 		}
 	}
@@ -162,8 +218,8 @@ public:
 	/// Clear the buffer, by setting pop index equal to the push index.
 	void clear()
 	{
-		const auto	push_index = push_index_.load(std::memory_order_relaxed);
-		pop_index_.store(push_index, std::memory_order_release);
+		const auto	push_index = push_index_.load(std::memory_order_acquire);
+		publish_pop_index(push_index);
 	}
 
 	/// Is buffer empty? */
@@ -182,9 +238,10 @@ public:
 	}
 
 	/// Number of elements currently stored in the buffer.
+	/// Acquires both indices, thus the elements counted can be read, and the locations not counted written.
 	unsigned int size() const
 	{
-		const auto	push_index = push_index_.load(std::memory_order_relaxed);
+		const auto	push_index = push_index_.load(std::memory_order_acquire);
 		const auto	pop_index = pop_index_.load(std::memory_order_acquire);
 
 		return (push_index + buffer_.size() - pop_index) % buffer_.size();
@@ -193,7 +250,7 @@ public:
 	/// Number of locations available.
 	unsigned int available() const
 	{
-		const auto	push_index = push_index_.load(std::memory_order_relaxed);
+		const auto	push_index = push_index_.load(std::memory_order_acquire);
 		const auto	pop_index = pop_index_.load(std::memory_order_acquire);
 
 		return (buffer_.size() - 1u + pop_index - push_index) % buffer_.size();
@@ -204,7 +261,91 @@ public:
 	{
 		return buffer_.size() - 1u;
 	}
+
+	/// Consumer: wait until at least n elements are stored, or the timeout expires. BLOCKING only.
+	/// \return true if there are n elements, false on timeout or when n exceeds the capacity.
+	template <class Rep, class Period>
+	bool wait_for_data(const unsigned int n, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		static_assert(BLOCKING, "the producer publishes without waking, use BlockingCircularBuffer");
+		return wait_until(push_index_, consumer_parked_, [this, n] { return size() >= n; }, n <= capacity(), timeout);
+	}
+
+	/// Producer: wait until at least n locations are free, or the timeout expires. BLOCKING only.
+	/// \return true if there is room for n elements, false on timeout or when n exceeds the capacity.
+	template <class Rep, class Period>
+	bool wait_for_space(const unsigned int n, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		static_assert(BLOCKING, "the consumer publishes without waking, use BlockingCircularBuffer");
+		return wait_until(pop_index_, producer_parked_, [this, n] { return available() >= n; }, n <= capacity(), timeout);
+	}
 private:
+	/// Store a new push index; BLOCKING: wake the consumer if it is parked on it.
+	void publish_push_index(const unsigned int push_index)
+	{
+		if constexpr (BLOCKING) {
+			// Sequentially consistent, thus either the consumer sees the new index or we see it parked.
+			push_index_.store(push_index, std::memory_order_seq_cst);
+			if (consumer_parked_.load(std::memory_order_seq_cst) != 0u) {
+				futex_wake(push_index_);
+			}
+		} else {
+			push_index_.store(push_index, std::memory_order_release);
+		}
+	}
+
+	/// Store a new pop index; BLOCKING: wake the producer if it is parked on it.
+	void publish_pop_index(const unsigned int pop_index)
+	{
+		if constexpr (BLOCKING) {
+			pop_index_.store(pop_index, std::memory_order_seq_cst);
+			if (producer_parked_.load(std::memory_order_seq_cst) != 0u) {
+				futex_wake(pop_index_);
+			}
+		} else {
+			pop_index_.store(pop_index, std::memory_order_release);
+		}
+	}
+
+	/// Park on the index of the other side until ready() holds or the timeout expires.
+	template <class READY, class Rep, class Period>
+	bool wait_until(std::atomic_uint& index, std::atomic_uint& parked, READY ready, const bool possible,
+		const std::chrono::duration<Rep, Period>& timeout)
+	{
+		if (ready()) {
+			return true;
+		}
+		if (!possible) {
+			return false;
+		}
+		const auto	deadline = std::chrono::steady_clock::now() + timeout;
+		for (;;) {
+			const unsigned int	seen = index.load(std::memory_order_acquire);
+			if (ready()) {
+				return true;
+			}
+			const auto	remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+			if (remaining.count() <= 0) {
+				return false;
+			}
+			parked.store(1u, std::memory_order_seq_cst);
+			// The other side can't bring the index back to seen without us moving ours.
+			if (index.load(std::memory_order_seq_cst) == seen) {
+				futex_wait(index, seen, remaining);
+			}
+			parked.store(0u, std::memory_order_relaxed);
+		}
+	}
+
+	/// n elements starting at the index, split at the end of the buffer.
+	template <class T>
+	Region<T> region(const unsigned int index, const unsigned int n) const
+	{
+		T*					data = const_cast<T*>(buffer_.data());
+		const unsigned int	n1 = std::min<unsigned int>(buffer_.size() - index, n);
+		return Region<T>{ std::span<T>(data + index, n1), std::span<T>(data, n - n1) };
+	}
+
 	/// Peek or pop as many elements as possible.
 	/// Returns the actual number of elements copied.
 	unsigned int peek_pop(E* buffer, const unsigned int n_max, const OPERATION operation)
@@ -228,7 +369,7 @@ private:
 			pop_index = (pop_index + this_round) % buffer_.size();
 		}
 		if (operation == OPERATION::POP) {
-			pop_index_.store(pop_index, std::memory_order_release);
+			publish_pop_index(pop_index);
 		}
 		return r;
 	}
@@ -244,6 +385,16 @@ private:
 	/// Index of the next item to be read.
 	std::atomic_uint	pop_index_;
 
+	/// Nonzero while the consumer is parked in #wait_for_data.
+	std::atomic_uint	consumer_parked_;
+
+	/// Nonzero while the producer is parked in #wait_for_space.
+	std::atomic_uint	producer_parked_;
+
 }; // class CircularBuffer
 
+/// CircularBuffer with #wait_for_data and #wait_for_space.
+template <class E>
+using BlockingCircularBuffer = CircularBuffer<E, true>;
+
 } // namespace
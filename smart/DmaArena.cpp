@@ -0,0 +1,162 @@
+/// \file  DmaArena.cpp
+/// \brief	Implementation of the class DmaArena.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#include <algorithm>		// std::max
+#include <iterator>			// std::prev
+#include <stdexcept>		// std::runtime_error
+
+#include "string.h"			// ssprintf
+
+#include "DmaArena.h"		// ourselves.
+
+namespace smart {
+
+// --------------------------------------------------------------------------------------------------------------------
+static std::uintptr_t align_up(const std::uintptr_t x, const std::size_t alignment)
+{
+	return (x + alignment - 1u) & ~static_cast<std::uintptr_t>(alignment - 1u);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+DmaArena::DmaArena(MappedFile* map, const std::uintptr_t physical_base)
+: _data(static_cast<std::uint8_t*>(map->data())),
+  _physical(physical_base),
+  _size(map->size())
+{
+	// Whole cache lines only.
+	const std::size_t	first = align_up(_physical, MIN_ALIGNMENT) - _physical;
+	if (first < _size) {
+		const std::size_t	usable = (_size - first) & ~(MIN_ALIGNMENT - 1u);
+		if (usable > 0) {
+			_free[first] = usable;
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+DmaArena::DmaArena(UioDevice& device, const unsigned int map_index)
+: DmaArena(device.getRequiredMap(map_index), device.maps[map_index].addr)
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+DmaArena::Block DmaArena::allocate(const std::size_t size, const std::size_t alignment)
+{
+	if (size == 0) {
+		throw std::runtime_error("DmaArena::allocate: size 0");
+	}
+	if ((alignment & (alignment - 1u)) != 0) {
+		throw std::runtime_error(ssprintf("DmaArena::allocate: alignment %zu is not a power of 2", alignment));
+	}
+	// Would wrap to 0 when rounded up.
+	if (size > SIZE_MAX - MIN_ALIGNMENT + 1u) {
+		throw std::runtime_error(ssprintf("DmaArena::allocate: size %zu too large", size));
+	}
+	const std::size_t	a = std::max(alignment, MIN_ALIGNMENT);
+	const std::size_t	n = align_up(size, MIN_ALIGNMENT);
+
+	std::lock_guard<std::mutex>	lock(_mutex);
+	// First fit, lowest address first.
+	for (auto it = _free.begin(); it != _free.end(); ++it) {
+		const std::size_t	range_offset = it->first;
+		const std::size_t	range_size = it->second;
+		const std::uintptr_t	start = _physical + range_offset;
+		const std::uintptr_t	aligned = align_up(start, a);
+		// The range end doesn't overflow, offset + n might; a huge alignment may wrap the address.
+		if (aligned < start || aligned - start >= range_size || n > range_size - (aligned - start)) {
+			continue;
+		}
+		const std::size_t	offset = aligned - _physical;
+		_free.erase(it);
+		if (offset > range_offset) {
+			_free[range_offset] = offset - range_offset;
+		}
+		if (offset + n < range_offset + range_size) {
+			_free[offset + n] = range_offset + range_size - (offset + n);
+		}
+		_used[offset] = n;
+		return Block{ _data + offset, _physical + offset, offset, n };
+	}
+	std::size_t	total = 0;
+	for (const auto& range : _free) {
+		total += range.second;
+	}
+	throw std::runtime_error(ssprintf("DmaArena::allocate: no free range of %zu bytes aligned to %zu, %zu bytes free in total",
+		n, a, total));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void DmaArena::free(const Block& block)
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	const auto	used = _used.find(block.offset);
+	if (used == _used.end() || block.data != _data + block.offset) {
+		throw std::runtime_error(ssprintf("DmaArena::free: no block at offset %zu", block.offset));
+	}
+	std::size_t	offset = used->first;
+	std::size_t	size = used->second;
+	_used.erase(used);
+
+	// Merge with the free neighbours.
+	auto	next = _free.lower_bound(offset);
+	if (next != _free.end() && next->first == offset + size) {
+		size += next->second;
+		next = _free.erase(next);
+	}
+	if (next != _free.begin()) {
+		const auto	prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			offset = prev->first;
+			size += prev->second;
+			_free.erase(prev);
+		}
+	}
+	_free[offset] = size;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::uintptr_t DmaArena::physicalOf(const void* address) const
+{
+	const std::uint8_t*	p = static_cast<const std::uint8_t*>(address);
+	if (p < _data || p >= _data + _size) {
+		throw std::runtime_error(ssprintf("DmaArena::physicalOf: %p outside of the region", address));
+	}
+	return _physical + static_cast<std::size_t>(p - _data);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* DmaArena::virtualOf(const std::uintptr_t physical) const
+{
+	if (physical < _physical || physical - _physical >= _size) {
+		throw std::runtime_error(ssprintf("DmaArena::virtualOf: 0x%zx outside of the region", static_cast<std::size_t>(physical)));
+	}
+	return _data + (physical - _physical);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t DmaArena::freeSize() const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	std::size_t	total = 0;
+	for (const auto& range : _free) {
+		total += range.second;
+	}
+	return total;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t DmaArena::largestFree() const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	std::size_t	largest = 0;
+	for (const auto& range : _free) {
+		largest = std::max(largest, range.second);
+	}
+	return largest;
+}
+
+} // namespace smart
@@ -0,0 +1,104 @@
+/// \file  DmaArena.h
+/// \brief	Interface of the class DmaArena.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#pragma once
+
+#include <cstddef>			// std::size_t
+#include <cstdint>			// std::uintptr_t
+#include <map>				// std::map
+#include <mutex>			// std::mutex
+
+#include "MappedFile.h"		// MappedFile
+#include "UioDevice.h"		// UioDevice
+
+namespace smart {
+
+/// Allocator of DMA buffers in one mapped memory region, e.g. the reserved memory of a UIO device.
+///
+/// The region is split into blocks known by both their virtual and their physical address, the latter to be
+/// programmed into the DMA engines. Blocks start on a physical address aligned as requested and never share
+/// a cache line with another block, thus cache maintenance of one block leaves the others alone.
+/// Free space is kept in a list ordered by offset, with neighbours merged on #free.
+///
+/// Example, two capture rings in the buffer of one device:
+/// @code
+///	DmaArena				arena(*device, 1);
+///	const DmaArena::Block	ring1 = arena.allocate(4u * 1024u * 1024u, 4096u);
+///	const DmaArena::Block	ring2 = arena.allocate(4u * 1024u * 1024u, 4096u);
+///	hw::AxiDataCapture		capture(device, ring1);
+/// @endcode
+class DmaArena {
+public:
+	/// Allocated memory.
+	struct Block {
+		/// Virtual address.
+		void*			data;
+
+		/// Physical address, for the DMA engine.
+		std::uintptr_t	physical;
+
+		/// Offset from the start of the map.
+		std::size_t		offset;
+
+		/// Size, in bytes.
+		std::size_t		size;
+	};
+
+	/// Granularity of the allocations, the largest cache line of the supported CPUs.
+	static constexpr std::size_t	MIN_ALIGNMENT = 64u;
+
+	/// Allocate from a mapping.
+	/// \param map				The memory, not owned.
+	/// \param physical_base	Physical address of the start of the mapping.
+	DmaArena(MappedFile* map, const std::uintptr_t physical_base);
+
+	/// Allocate from a map of a device, which has to outlive the arena.
+	DmaArena(UioDevice& device, const unsigned int map_index);
+
+	DmaArena(const DmaArena&) = delete;
+	DmaArena& operator=(const DmaArena&) = delete;
+
+	/// Allocate a block. Throws when there is no free range large enough.
+	/// \param size			Size, rounded up to a multiple of MIN_ALIGNMENT.
+	/// \param alignment	Alignment of the physical address, a power of 2; at least MIN_ALIGNMENT is used.
+	Block allocate(const std::size_t size, const std::size_t alignment = MIN_ALIGNMENT);
+
+	/// Return a block. Throws when the block was not allocated from this arena.
+	void free(const Block& block);
+
+	/// Physical address of a virtual address in the region. Throws when outside.
+	std::uintptr_t physicalOf(const void* address) const;
+
+	/// Virtual address of a physical address in the region. Throws when outside.
+	void* virtualOf(const std::uintptr_t physical) const;
+
+	/// Size of the region, in bytes.
+	std::size_t size() const
+	{
+		return _size;
+	}
+
+	/// Bytes not allocated.
+	std::size_t freeSize() const;
+
+	/// Largest block that can be allocated with MIN_ALIGNMENT.
+	std::size_t largestFree() const;
+private:
+	std::uint8_t*							_data;
+	std::uintptr_t							_physical;
+	std::size_t								_size;
+
+	mutable std::mutex						_mutex;
+
+	/// Free ranges, offset to size.
+	std::map<std::size_t, std::size_t>		_free;
+
+	/// Allocated blocks, offset to size.
+	std::map<std::size_t, std::size_t>		_used;
+}; // class DmaArena
+
+} // namespace smart
@@ -0,0 +1,410 @@
+/// \file  Interleave.cpp
+/// \brief	Definitions of the channel interleaving functions.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#include <algorithm>	// std::copy_n
+#include <cstdint>		// std::uint8_t
+#include <stdexcept>	// std::runtime_error
+
+#include <string.h>		// memcpy
+
+#if defined(__AVX2__)
+#include <immintrin.h>	// AVX2
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>	// SSE2
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>	// NEON
+#endif
+
+#include "Interleave.h"	// ourselves.
+#include "string.h"		// ssprintf
+
+namespace smart {
+namespace Interleave {
+
+// --------------------------------------------------------------------------------------------------------------------
+// Vector kernels.
+//
+// Both directions are the same permutation network. Loading C registers of L lanes each gives a sequence of C*L
+// samples. One zip stage (zip register i with register i+C/2, for all i < C/2) interleaves the first and the second
+// half of that sequence, i.e. rotates the bits of the sample index left by one. Sample index bits are
+// <frame><channel> for interleaved data and <channel><frame> for per-channel data, thus log2(L) stages deinterleave
+// and log2(C) stages interleave.
+//
+// The traits provide 16-byte halves: AVX2 unpacks within 128-bit lanes, so its registers are two independent halves.
+
+#if defined(__AVX2__)
+/// AVX2 traits, two 16-byte halves per register.
+struct Avx2 {
+	typedef __m256i	Vector;
+	static constexpr unsigned int HALVES = 2;
+
+	static Vector load(const std::uint8_t* p)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	}
+
+	static void store(std::uint8_t* p, const Vector v)
+	{
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+	}
+
+	static Vector loadSplit(const std::uint8_t* p0, const std::uint8_t* p1)
+	{
+		const __m256i	lo = _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p0)));
+		return _mm256_inserti128_si256(lo, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1)), 1);
+	}
+
+	static void storeSplit(std::uint8_t* p0, std::uint8_t* p1, const Vector v)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p0), _mm256_castsi256_si128(v));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p1), _mm256_extracti128_si256(v, 1));
+	}
+
+	template <unsigned int B>
+	static void zip(const Vector a, const Vector b, Vector& lo, Vector& hi)
+	{
+		if constexpr (B == 1) {
+			lo = _mm256_unpacklo_epi8(a, b);
+			hi = _mm256_unpackhi_epi8(a, b);
+		} else if constexpr (B == 2) {
+			lo = _mm256_unpacklo_epi16(a, b);
+			hi = _mm256_unpackhi_epi16(a, b);
+		} else {
+			lo = _mm256_unpacklo_epi32(a, b);
+			hi = _mm256_unpackhi_epi32(a, b);
+		}
+	}
+};
+typedef Avx2	Simd;
+static const char* const	SIMD_NAME = "AVX2";
+
+#elif defined(__SSE2__)
+/// SSE2 traits.
+struct Sse2 {
+	typedef __m128i	Vector;
+	static constexpr unsigned int HALVES = 1;
+
+	static Vector load(const std::uint8_t* p)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	}
+
+	static void store(std::uint8_t* p, const Vector v)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+	}
+
+	static Vector loadSplit(const std::uint8_t* p0, const std::uint8_t*)
+	{
+		return load(p0);
+	}
+
+	static void storeSplit(std::uint8_t* p0, std::uint8_t*, const Vector v)
+	{
+		store(p0, v);
+	}
+
+	template <unsigned int B>
+	static void zip(const Vector a, const Vector b, Vector& lo, Vector& hi)
+	{
+		if constexpr (B == 1) {
+			lo = _mm_unpacklo_epi8(a, b);
+			hi = _mm_unpackhi_epi8(a, b);
+		} else if constexpr (B == 2) {
+			lo = _mm_unpacklo_epi16(a, b);
+			hi = _mm_unpackhi_epi16(a, b);
+		} else {
+			lo = _mm_unpacklo_epi32(a, b);
+			hi = _mm_unpackhi_epi32(a, b);
+		}
+	}
+};
+typedef Sse2	Simd;
+static const char* const	SIMD_NAME = "SSE2";
+
+#elif defined(__ARM_NEON)
+/// NEON traits.
+struct Neon {
+	typedef uint8x16_t	Vector;
+	static constexpr unsigned int HALVES = 1;
+
+	static Vector load(const std::uint8_t* p)
+	{
+		return vld1q_u8(p);
+	}
+
+	static void store(std::uint8_t* p, const Vector v)
+	{
+		vst1q_u8(p, v);
+	}
+
+	static Vector loadSplit(const std::uint8_t* p0, const std::uint8_t*)
+	{
+		return load(p0);
+	}
+
+	static void storeSplit(std::uint8_t* p0, std::uint8_t*, const Vector v)
+	{
+		store(p0, v);
+	}
+
+	template <unsigned int B>
+	static void zip(const Vector a, const Vector b, Vector& lo, Vector& hi)
+	{
+		if constexpr (B == 1) {
+			const uint8x16x2_t	r = vzipq_u8(a, b);
+			lo = r.val[0];
+			hi = r.val[1];
+		} else if constexpr (B == 2) {
+			const uint16x8x2_t	r = vzipq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b));
+			lo = vreinterpretq_u8_u16(r.val[0]);
+			hi = vreinterpretq_u8_u16(r.val[1]);
+		} else {
+			const uint32x4x2_t	r = vzipq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b));
+			lo = vreinterpretq_u8_u32(r.val[0]);
+			hi = vreinterpretq_u8_u32(r.val[1]);
+		}
+	}
+};
+typedef Neon	Simd;
+static const char* const	SIMD_NAME = "NEON";
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(__ARM_NEON)
+#define SMART_INTERLEAVE_SIMD 1
+
+/// Base-2 logarithm of a power of two.
+static constexpr unsigned int log2_of(const unsigned int n)
+{
+	return n <= 1u ? 0u : 1u + log2_of(n / 2u);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Apply the given number of zip stages to C registers.
+template <class T, unsigned int B, unsigned int C, unsigned int STAGES>
+static inline void _shuffle(typename T::Vector* r)
+{
+	for (unsigned int s=0; s<STAGES; ++s) {
+		typename T::Vector	tmp[C];
+		for (unsigned int i=0; i<C/2; ++i) {
+			T::template zip<B>(r[i], r[i + C/2], tmp[2*i], tmp[2*i + 1]);
+		}
+		std::copy_n(tmp, C, r);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Deinterleave whole vector blocks.
+/// \return Number of frames done.
+template <class T, unsigned int B, unsigned int C>
+static std::size_t _deinterleave_simd(std::uint8_t* const* channels, const std::uint8_t* src, const std::size_t nframes)
+{
+	constexpr unsigned int	L = 16u / B;			// Samples per 16-byte half.
+	constexpr unsigned int	F = L * T::HALVES;		// Frames per block.
+	std::size_t				f = 0;
+
+	for (; f + F <= nframes; f += F) {
+		typename T::Vector	r[C];
+		const std::uint8_t*	s = &src[f * C * B];
+		for (unsigned int i=0; i<C; ++i) {
+			r[i] = T::loadSplit(&s[i * 16u], &s[(L * C + i * L) * B]);
+		}
+		_shuffle<T, B, C, log2_of(L)>(r);
+		for (unsigned int i=0; i<C; ++i) {
+			T::store(&channels[i][f * B], r[i]);
+		}
+	}
+	return f;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Interleave whole vector blocks.
+/// \return Number of frames done.
+template <class T, unsigned int B, unsigned int C>
+static std::size_t _interleave_simd(std::uint8_t* dst, const std::uint8_t* const* channels, const std::size_t nframes)
+{
+	constexpr unsigned int	L = 16u / B;
+	constexpr unsigned int	F = L * T::HALVES;
+	std::size_t				f = 0;
+
+	for (; f + F <= nframes; f += F) {
+		typename T::Vector	r[C];
+		for (unsigned int i=0; i<C; ++i) {
+			r[i] = T::load(&channels[i][f * B]);
+		}
+		_shuffle<T, B, C, log2_of(C)>(r);
+		std::uint8_t*	d = &dst[f * C * B];
+		for (unsigned int i=0; i<C; ++i) {
+			T::storeSplit(&d[i * 16u], &d[(L * C + i * L) * B], r[i]);
+		}
+	}
+	return f;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Select the kernel for the channel count.
+template <unsigned int B>
+static std::size_t _deinterleave_simd(std::uint8_t* const* channels, const std::uint8_t* src, const unsigned int nchannels, const std::size_t nframes)
+{
+	switch (nchannels) {
+	case 2:		return _deinterleave_simd<Simd, B, 2>(channels, src, nframes);
+	case 4:		return _deinterleave_simd<Simd, B, 4>(channels, src, nframes);
+	case 8:		return _deinterleave_simd<Simd, B, 8>(channels, src, nframes);
+	case 16:	return _deinterleave_simd<Simd, B, 16>(channels, src, nframes);
+	default:	return 0;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Select the kernel for the channel count.
+template <unsigned int B>
+static std::size_t _interleave_simd(std::uint8_t* dst, const std::uint8_t* const* channels, const unsigned int nchannels, const std::size_t nframes)
+{
+	switch (nchannels) {
+	case 2:		return _interleave_simd<Simd, B, 2>(dst, channels, nframes);
+	case 4:		return _interleave_simd<Simd, B, 4>(dst, channels, nframes);
+	case 8:		return _interleave_simd<Simd, B, 8>(dst, channels, nframes);
+	case 16:	return _interleave_simd<Simd, B, 16>(dst, channels, nframes);
+	default:	return 0;
+	}
+}
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+// Scalar kernels, from the frame \c begin on.
+
+template <unsigned int B>
+static void _deinterleave_scalar(std::uint8_t* const* channels, const std::uint8_t* src, const unsigned int nchannels, const std::size_t begin, const std::size_t nframes)
+{
+	const std::size_t	stride = nchannels * B;
+	for (unsigned int c=0; c<nchannels; ++c) {
+		std::uint8_t*		d = &channels[c][begin * B];
+		const std::uint8_t*	s = &src[begin * stride + c * B];
+		for (std::size_t f=begin; f<nframes; ++f, d+=B, s+=stride) {
+			memcpy(d, s, B);
+		}
+	}
+}
+
+template <unsigned int B>
+static void _interleave_scalar(std::uint8_t* dst, const std::uint8_t* const* channels, const unsigned int nchannels, const std::size_t begin, const std::size_t nframes)
+{
+	const std::size_t	stride = nchannels * B;
+	for (unsigned int c=0; c<nchannels; ++c) {
+		std::uint8_t*		d = &dst[begin * stride + c * B];
+		const std::uint8_t*	s = &channels[c][begin * B];
+		for (std::size_t f=begin; f<nframes; ++f, d+=stride, s+=B) {
+			memcpy(d, s, B);
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+static void _deinterleave(void* const* channels, const void* src, const unsigned int nchannels, const unsigned int bytes_per_sample, const std::size_t nframes, const bool simd)
+{
+	std::uint8_t* const*	ch = reinterpret_cast<std::uint8_t* const*>(channels);
+	const std::uint8_t*		s = reinterpret_cast<const std::uint8_t*>(src);
+	std::size_t				done = 0;
+
+	switch (bytes_per_sample) {
+	case 1:
+#if defined(SMART_INTERLEAVE_SIMD)
+		done = simd ? _deinterleave_simd<1>(ch, s, nchannels, nframes) : 0;
+#endif
+		_deinterleave_scalar<1>(ch, s, nchannels, done, nframes);
+		break;
+	case 2:
+#if defined(SMART_INTERLEAVE_SIMD)
+		done = simd ? _deinterleave_simd<2>(ch, s, nchannels, nframes) : 0;
+#endif
+		_deinterleave_scalar<2>(ch, s, nchannels, done, nframes);
+		break;
+	case 3:
+		_deinterleave_scalar<3>(ch, s, nchannels, done, nframes);
+		break;
+	case 4:
+#if defined(SMART_INTERLEAVE_SIMD)
+		done = simd ? _deinterleave_simd<4>(ch, s, nchannels, nframes) : 0;
+#endif
+		_deinterleave_scalar<4>(ch, s, nchannels, done, nframes);
+		break;
+	default:
+		throw std::runtime_error(ssprintf("Interleave::deinterleave: unsupported sample size %u", bytes_per_sample));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+static void _interleave(void* dst, const void* const* channels, const unsigned int nchannels, const unsigned int bytes_per_sample, const std::size_t nframes, const bool simd)
+{
+	std::uint8_t*				d = reinterpret_cast<std::uint8_t*>(dst);
+	const std::uint8_t* const*	ch = reinterpret_cast<const std::uint8_t* const*>(channels);
+	std::size_t					done = 0;
+
+	switch (bytes_per_sample) {
+	case 1:
+#if defined(SMART_INTERLEAVE_SIMD)
+		done = simd ? _interleave_simd<1>(d, ch, nchannels, nframes) : 0;
+#endif
+		_interleave_scalar<1>(d, ch, nchannels, done, nframes);
+		break;
+	case 2:
+#if defined(SMART_INTERLEAVE_SIMD)
+		done = simd ? _interleave_simd<2>(d, ch, nchannels, nframes) : 0;
+#endif
+		_interleave_scalar<2>(d, ch, nchannels, done, nframes);
+		break;
+	case 3:
+		_interleave_scalar<3>(d, ch, nchannels, done, nframes);
+		break;
+	case 4:
+#if defined(SMART_INTERLEAVE_SIMD)
+		done = simd ? _interleave_simd<4>(d, ch, nchannels, nframes) : 0;
+#endif
+		_interleave_scalar<4>(d, ch, nchannels, done, nframes);
+		break;
+	default:
+		throw std::runtime_error(ssprintf("Interleave::interleave: unsupported sample size %u", bytes_per_sample));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void deinterleave(void* const* channels, const void* src, const unsigned int nchannels, const unsigned int bytes_per_sample, const std::size_t nframes)
+{
+	_deinterleave(channels, src, nchannels, bytes_per_sample, nframes, true);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void interleave(void* dst, const void* const* channels, const unsigned int nchannels, const unsigned int bytes_per_sample, const std::size_t nframes)
+{
+	_interleave(dst, channels, nchannels, bytes_per_sample, nframes, true);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void deinterleaveScalar(void* const* channels, const void* src, const unsigned int nchannels, const unsigned int bytes_per_sample, const std::size_t nframes)
+{
+	_deinterleave(channels, src, nchannels, bytes_per_sample, nframes, false);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void interleaveScalar(void* dst, const void* const* channels, const unsigned int nchannels, const unsigned int bytes_per_sample, const std::size_t nframes)
+{
+	_interleave(dst, channels, nchannels, bytes_per_sample, nframes, false);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+const char* implementation()
+{
+#if defined(SMART_INTERLEAVE_SIMD)
+	return SIMD_NAME;
+#else
+	return "scalar";
+#endif
+}
+
+} // namespace Interleave
+} // namespace smart
@@ -0,0 +1,73 @@
+/// \file  Interleave.h
+/// \brief	Declarations of the channel interleaving functions.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#pragma once
+
+#include <cstddef>	// std::size_t
+
+namespace smart {
+
+/// Conversion between interleaved multi-channel frames and one buffer per channel.
+///
+/// Interleaved data, as produced by AxiDataCapture and stored in WAV files, holds one sample of every channel per frame:
+/// <tt>c0 c1 c2 c0 c1 c2 ...</tt>. Per-channel processing wants the samples of one channel contiguous instead.
+/// Samples are 1, 2, 3 or 4 bytes wide and are moved as-is, no byte order or sign conversion is done.
+///
+/// Power-of-two channel counts up to #MAX_SIMD_CHANNELS with 1, 2 or 4 byte samples are converted with
+/// NEON, AVX2 or SSE2, whichever the compiler targets, everything else with a scalar loop.
+namespace Interleave {
+
+/// Largest channel count handled by the vector kernels.
+constexpr unsigned int MAX_SIMD_CHANNELS = 16;
+
+/// Split interleaved frames into one buffer per channel.
+/// \param channels			Destination buffers, \c nchannels of them, each receiving \c nframes samples.
+/// \param src				Interleaved frames.
+/// \param nchannels		Number of channels.
+/// \param bytes_per_sample	Size of one sample: 1, 2, 3 or 4.
+/// \param nframes			Number of frames.
+void deinterleave(
+	void* const*		channels,
+	const void*			src,
+	const unsigned int	nchannels,
+	const unsigned int	bytes_per_sample,
+	const std::size_t	nframes);
+
+/// Merge one buffer per channel into interleaved frames.
+/// \param dst				Interleaved frames, \c nframes of them.
+/// \param channels			Source buffers, \c nchannels of them, each holding \c nframes samples.
+/// \param nchannels		Number of channels.
+/// \param bytes_per_sample	Size of one sample: 1, 2, 3 or 4.
+/// \param nframes			Number of frames.
+void interleave(
+	void*				dst,
+	const void* const*	channels,
+	const unsigned int	nchannels,
+	const unsigned int	bytes_per_sample,
+	const std::size_t	nframes);
+
+/// Scalar reference implementation of #deinterleave.
+void deinterleaveScalar(
+	void* const*		channels,
+	const void*			src,
+	const unsigned int	nchannels,
+	const unsigned int	bytes_per_sample,
+	const std::size_t	nframes);
+
+/// Scalar reference implementation of #interleave.
+void interleaveScalar(
+	void*				dst,
+	const void* const*	channels,
+	const unsigned int	nchannels,
+	const unsigned int	bytes_per_sample,
+	const std::size_t	nframes);
+
+/// Name of the vector instruction set used: "NEON", "AVX2", "SSE2" or "scalar".
+const char* implementation();
+
+} // namespace Interleave
+} // namespace smart
@@ -12,6 +12,9 @@
 #	include <sys/time.h>
 #endif
 
+#include <algorithm>	// std::min
+#include <atomic>		// std::atomic_thread_fence
+#include <cstring>		// memcpy
 #include <string>		// std::string
 #include <stdexcept>	// std::runtime_error
 #include <cstdint>		// std::uintptr_t, etc.
@@ -25,6 +28,12 @@
 #include <sys/mman.h>	// mmap
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>	// SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>	// NEON
+#endif
+
 #include "string.h"
 
 #include "MappedFile.h"	// ourselves.
@@ -59,7 +68,7 @@ MappedFile::MappedFile(
 	_file(INVALID_HANDLE_VALUE),
 	_data((std::uint32_t*)MAP_FAILED),
 	_size(length),
-	_shadow_read_mask(0),
+	_memory(false),
 	filename(filename),
 	offset(offset)
 {
@@ -83,7 +92,7 @@ MappedFile::MappedFile(Handle h,
 	_file(INVALID_HANDLE_VALUE),
 	_data((std::uint32_t*)MAP_FAILED),
 	_size(length),
-	_shadow_read_mask(0),
+	_memory(false),
 	filename(ssprintf("filehandle:%d", h)),
 	offset(offset)
 {
@@ -112,7 +121,7 @@ MappedFile::_closeMapping()
 // --------------------------------------------------------------------------------------------------------------------
 std::uint32_t MappedFile::_read32Unchecked(const std::uint32_t index)
 {
-	if (index < _shadow_data.size() && (index>=8*sizeof(_shadow_read_mask) || (_shadow_read_mask & (1 << index))==0)) {
+	if (index < _shadow_data.size() && (index >= _shadow_read.size() || !_shadow_read[index])) {
 		return _shadow_data[index];
 	}
 	else {
@@ -124,6 +133,100 @@ std::uint32_t MappedFile::_read32Unchecked(const std::uint32_t index)
 	}
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+// Block transfers.
+//
+// Registers may fault or hang the bus on anything but 32-bit accesses, thus a mapping not declared as memory is
+// accessed word by word. Memory is accessed with 32-bit accesses up to the first 16-byte boundary, aligned 128-bit
+// accesses (64-bit without SSE2 or NEON) in the middle and 32-bit accesses for the rest.
+// All accesses to the mapping are volatile, thus the compiler can neither merge, split nor replace them,
+// e.g. by a call of memset. The other side is ordinary memory, accessed unaligned.
+
+#if defined(__SSE2__)
+typedef __m128i			Wide;
+#elif defined(__ARM_NEON)
+typedef uint32x4_t		Wide;
+#else
+typedef std::uint64_t	Wide;
+#endif
+
+/// Number of words in a wide access.
+static constexpr std::size_t	WIDE_WORDS = sizeof(Wide) / sizeof(std::uint32_t);
+
+/// Alignment of the wide accesses.
+static constexpr std::uintptr_t	BLOCK_ALIGNMENT = 16;
+
+/// Number of words before the first aligned wide access, at most count; count when not wide.
+static std::size_t _head_words(const volatile std::uint32_t* p, const std::size_t count, const bool wide)
+{
+	if (!wide) {
+		return count;
+	}
+	const std::uintptr_t	misalignment = reinterpret_cast<std::uintptr_t>(p) % BLOCK_ALIGNMENT;
+	return std::min<std::size_t>(count, misalignment == 0 ? 0 : (BLOCK_ALIGNMENT - misalignment) / sizeof(std::uint32_t));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+static void _read_block(const volatile std::uint32_t* src, std::uint32_t* dst, const std::size_t count, const bool wide)
+{
+	std::size_t	i = 0;
+	for (const std::size_t head = _head_words(src, count, wide); i < head; ++i) {
+		dst[i] = src[i];
+	}
+	for (; i + WIDE_WORDS <= count; i += WIDE_WORDS) {
+		const Wide	v = *reinterpret_cast<const volatile Wide*>(&src[i]);
+		memcpy(&dst[i], &v, sizeof(v));
+	}
+	for (; i < count; ++i) {
+		dst[i] = src[i];
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+static void _write_block(volatile std::uint32_t* dst, const std::uint32_t* src, const std::size_t count, const bool wide)
+{
+	std::size_t	i = 0;
+	for (const std::size_t head = _head_words(dst, count, wide); i < head; ++i) {
+		dst[i] = src[i];
+	}
+	for (; i + WIDE_WORDS <= count; i += WIDE_WORDS) {
+		Wide	v;
+		memcpy(&v, &src[i], sizeof(v));
+		*reinterpret_cast<volatile Wide*>(&dst[i]) = v;
+	}
+	for (; i < count; ++i) {
+		dst[i] = src[i];
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+static void _fill_block(volatile std::uint32_t* dst, const std::uint32_t value, const std::size_t count, const bool wide)
+{
+	std::size_t	i = 0;
+	for (const std::size_t head = _head_words(dst, count, wide); i < head; ++i) {
+		dst[i] = value;
+	}
+	std::uint32_t	values[WIDE_WORDS];
+	std::fill_n(values, WIDE_WORDS, value);
+	Wide			v;
+	memcpy(&v, values, sizeof(v));
+	for (; i + WIDE_WORDS <= count; i += WIDE_WORDS) {
+		*reinterpret_cast<volatile Wide*>(&dst[i]) = v;
+	}
+	for (; i < count; ++i) {
+		dst[i] = value;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void MappedFile::_write32Unchecked(const std::uint32_t index, const std::uint32_t value)
+{
+	reinterpret_cast<volatile std::uint32_t*>(_data)[index] = value;
+	if (index < _shadow_data.size()) {
+		_shadow_data[index] = value;
+	}
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 MappedFile::~MappedFile()
 {
@@ -146,8 +249,19 @@ std::size_t MappedFile::size32() const
 void
 MappedFile::createShadow(const unsigned int readMask)
 {
-	_shadow_data.resize(size());
-	_shadow_read_mask = readMask;
+	std::vector<bool>	mask(8 * sizeof(readMask));
+	for (std::size_t i=0; i<mask.size(); ++i) {
+		mask[i] = (readMask & (1u << i)) != 0;
+	}
+	createShadow(mask);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void
+MappedFile::createShadow(const std::vector<bool>& readMask)
+{
+	_shadow_data.resize(size32());
+	_shadow_read = readMask;
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -156,10 +270,7 @@ void MappedFile::write32(const std::uint32_t index, const std::uint32_t value)
 	if (index>_size || index*sizeof(std::uint32_t)>_size) {
 		throw std::runtime_error("MappedFile::write32: index out of bounds");
 	} else {
-		_data[index] = value;
-		if (index < _shadow_data.size()) {
-			_shadow_data[index] = value;
-		}
+		_write32Unchecked(index, value);
 	}
 }
 
@@ -172,10 +283,7 @@ void MappedFile::write32Masked(const std::uint32_t index, const std::uint32_t ma
 		const std::uint32_t	v_old = _read32Unchecked(index);
 		const std::uint32_t	v_new = (v_old & ~mask) | (value & mask);
 
-		_data[index] = v_new;
-		if (index < _shadow_data.size()) {
-			_shadow_data[index] = v_new;
-		}
+		_write32Unchecked(index, v_new);
 	}
 }
 
@@ -189,12 +297,102 @@ uint32_t MappedFile::read32(const std::uint32_t index)
 	}
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+void MappedFile::_checkBlock(const char* what, const std::uint32_t index, const std::size_t count) const
+{
+	if (index > size32() || count > size32() - index) {
+		throw std::runtime_error(ssprintf("MappedFile::%s: words %u..%zu out of bounds, size %zu words", what, index, index + count, size32()));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void MappedFile::readBlock(const std::uint32_t index, std::uint32_t* dst, const std::size_t count)
+{
+	_checkBlock("readBlock", index, count);
+	const std::size_t	nshadow = index < _shadow_data.size() ? std::min<std::size_t>(count, _shadow_data.size() - index) : 0;
+	for (std::size_t i=0; i<nshadow; ++i) {
+		dst[i] = _read32Unchecked(index + i);
+	}
+	_read_block(&_data[index + nshadow], &dst[nshadow], count - nshadow, _memory);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void MappedFile::writeBlock(const std::uint32_t index, const std::uint32_t* src, const std::size_t count)
+{
+	_checkBlock("writeBlock", index, count);
+	_write_block(&_data[index], src, count, _memory);
+	if (index < _shadow_data.size()) {
+		std::copy(src, src + std::min<std::size_t>(count, _shadow_data.size() - index), &_shadow_data[index]);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void MappedFile::fill(const std::uint32_t index, const std::uint32_t value, const std::size_t count)
+{
+	_checkBlock("fill", index, count);
+	_fill_block(&_data[index], value, count, _memory);
+	if (index < _shadow_data.size()) {
+		std::fill_n(&_shadow_data[index], std::min<std::size_t>(count, _shadow_data.size() - index), value);
+	}
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 MappedFile::Handle MappedFile::getFile()
 {
 	return _file;
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+MappedFile::Transaction::Transaction(MappedFile& file)
+: _file(file)
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void MappedFile::Transaction::write32(const std::uint32_t index, const std::uint32_t value)
+{
+	write32Masked(index, 0xFFFFFFFFu, value);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void MappedFile::Transaction::write32Masked(const std::uint32_t index, const std::uint32_t mask, const std::uint32_t value)
+{
+	if (index >= _file.size32()) {
+		throw std::runtime_error(ssprintf("MappedFile::Transaction: index %u out of bounds", index));
+	}
+	const auto	r = _positions.emplace(index, _writes.size());
+	if (r.second) {
+		_writes.push_back(Write{ index, mask, value & mask });
+	} else {
+		Write&	w = _writes[r.first->second];
+		w.mask |= mask;
+		w.value = (w.value & ~mask) | (value & mask);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void MappedFile::Transaction::commit()
+{
+	// Reads first: the old values must not see any of the new ones.
+	for (Write& w : _writes) {
+		if (w.mask != 0xFFFFFFFFu) {
+			w.value |= _file._read32Unchecked(w.index) & ~w.mask;
+		}
+	}
+	for (const Write& w : _writes) {
+		_file._write32Unchecked(w.index, w.value);
+	}
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	clear();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void MappedFile::Transaction::clear()
+{
+	_writes.clear();
+	_positions.clear();
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 unsigned int
 MappedFile::pageSize()
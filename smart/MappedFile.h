@@ -8,6 +8,7 @@
 
 #include <cstdint>	// std::int32_t, etc.
 #include <string>	// std::string
+#include <unordered_map>	// std::unordered_map
 #include <vector>	// std::vector
 #include <stdexcept>	// std::runtime_error
 #include <cstdint>	// std::uintptr_t, etc.
@@ -35,11 +36,14 @@ private:
 	std::uint32_t*		_data;
 	std::size_t			_size;
 
+	/// Is the mapping memory, taking wide accesses?
+	bool				_memory;
+
 	/// Shadow copy of the data, if any.
 	std::vector<std::uint32_t>		_shadow_data;
 
-	/// Bitmask of registers that support reading.
-	unsigned int					_shadow_read_mask;
+	/// Registers that are read from the hardware even when shadowed, one bit per word.
+	std::vector<bool>				_shadow_read;
 
 	/// Size of the memory page.
 	static unsigned int		_pageSize;
@@ -49,6 +53,12 @@ private:
 
 	/// Unchecked read.
 	std::uint32_t		_read32Unchecked(const std::uint32_t index);
+
+	/// Unchecked write, including the shadow copy.
+	void				_write32Unchecked(const std::uint32_t index, const std::uint32_t value);
+
+	/// Throw when the words [index, index+count) are not all mapped.
+	void				_checkBlock(const char* what, const std::uint32_t index, const std::size_t count) const;
 public:
 	/// Create new memory mapping.
 	/// NB! Use the pageSize() function to determine granularity.
@@ -83,8 +93,14 @@ public:
 
 	/// Create shadow copy of the data.
 	/// Reads will be done from the shadow copy except for those registers that have a corresponding bit set in the readMask.
+	/// Covers the first 32 registers only; see the other overload for larger register files.
 	void createShadow(const unsigned int readMask);
 
+	/// Create shadow copy of the data.
+	/// Reads will be done from the shadow copy except for the registers whose entry in readMask is set,
+	/// e.g. status registers changed by the hardware. Registers beyond the end of readMask are shadowed.
+	void createShadow(const std::vector<bool>& readMask);
+
 	/// Write the given word at the given index.
 	void write32(const std::uint32_t index, const std::uint32_t value);
 
@@ -95,6 +111,40 @@ public:
 	/// Read a word from the given index.
 	uint32_t read32(const std::uint32_t index);
 
+	/// Declare the mapping as memory, e.g. a DMA buffer, for the block transfers to use wide accesses.
+	/// Off by default: registers, e.g. on AXI-Lite, may fault or hang the bus on other than 32-bit accesses.
+	void setMemory(const bool memory)
+	{
+		_memory = memory;
+	}
+
+	/// Is the mapping declared as memory?
+	bool isMemory() const
+	{
+		return _memory;
+	}
+
+	/// Read consecutive words starting at the given index.
+	/// All accesses to the mapping are volatile. Unless the mapping is declared as memory they are 32-bit;
+	/// otherwise aligned 128-bit loads (SSE2 or NEON; 64-bit elsewhere) with 32-bit loads at the unaligned ends.
+	/// Words with a shadow copy are read as by #read32.
+	/// \param index	Index of the first word.
+	/// \param dst		Destination, count words.
+	/// \param count	Number of words.
+	void readBlock(const std::uint32_t index, std::uint32_t* dst, const std::size_t count);
+
+	/// Write consecutive words starting at the given index, with the accesses of #readBlock.
+	/// \param index	Index of the first word.
+	/// \param src		Source, count words.
+	/// \param count	Number of words.
+	void writeBlock(const std::uint32_t index, const std::uint32_t* src, const std::size_t count);
+
+	/// Write the same word to a range of words, with the accesses of #readBlock.
+	/// \param index	Index of the first word.
+	/// \param value	Value to write.
+	/// \param count	Number of words.
+	void fill(const std::uint32_t index, const std::uint32_t value, const std::size_t count);
+
 	/// Return the data pointer.
 	void* data()
 	{
@@ -104,6 +154,58 @@ public:
 	/// Get file handle.
 	Handle getFile();
 
+	/// Batch of register writes, applied together by #commit.
+	///
+	/// Masked writes to the same register are merged, thus every register is written once. Registers not fully
+	/// covered by the writes are read once, from the shadow copy when possible. On commit, all reads are done
+	/// first, then the writes in the order the registers were first written to, followed by a single barrier.
+	/// Nothing is written when the transaction is destroyed without commit.
+	///
+	/// Example:
+	/// @code
+	///	MappedFile::Transaction	t(*regs);
+	///	t.write32Masked(CONTROL, 0x0F, mode);
+	///	t.write32Masked(CONTROL, 0x100, 0x100);
+	///	t.write32(DIVIDER, divider);
+	///	t.commit();		// One read of CONTROL, two writes, one barrier.
+	/// @endcode
+	class Transaction {
+	public:
+		/// Start a transaction on the given file.
+		explicit Transaction(MappedFile& file);
+
+		/// Queue a write of the whole word.
+		void write32(const std::uint32_t index, const std::uint32_t value);
+
+		/// Queue a write of the bits given in the mask.
+		void write32Masked(const std::uint32_t index, const std::uint32_t mask, const std::uint32_t value);
+
+		/// Apply the queued writes and start over.
+		void commit();
+
+		/// Drop the queued writes.
+		void clear();
+
+		/// Number of registers to be written.
+		std::size_t size() const
+		{
+			return _writes.size();
+		}
+	private:
+		/// Merged write to one register.
+		struct Write {
+			std::uint32_t	index;
+			std::uint32_t	mask;
+			std::uint32_t	value;
+		};
+
+		MappedFile&										_file;
+		std::vector<Write>								_writes;
+
+		/// Position of a register in _writes.
+		std::unordered_map<std::uint32_t, std::size_t>	_positions;
+	};
+
 	/// Size of a memory page.
 	static unsigned int pageSize();
 }; // class MappedFile
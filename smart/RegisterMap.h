@@ -0,0 +1,234 @@
+/// \file  RegisterMap.h
+/// \brief	Typed register maps over memory-mapped register files.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#pragma once
+
+#include <cstddef>		// std::size_t
+#include <cstdint>		// std::uint32_t
+#include <stdexcept>	// std::runtime_error
+#include <type_traits>	// std::is_same_v
+
+#include "MappedFile.h"
+#include "string.h"		// ssprintf
+
+namespace smart {
+
+/// Registers and bitfields of an IP core declared as types, with all offsets and masks known at compile time.
+///
+/// A Block accesses the registers with a single volatile 32-bit load or store each; the size of the mapping is
+/// checked once, when the block is created, instead of on every access as by MappedFile::read32.
+/// Read-modify-write of fields with constant values folds into one load, one AND/OR with constants and one store.
+///
+/// Example, two registers of the Xilinx AXI GPIO:
+/// @code
+///	typedef RegisterMap::Register<0>			GPIO_DATA;
+///	typedef RegisterMap::Register<1>			GPIO_TRI;
+///	typedef RegisterMap::Field<GPIO_TRI, 0, 1>	GPIO_TRI_BIT0;
+///
+///	RegisterMap::Block<2>	regs(uio.getRequiredMap(0));
+///	regs.modify<GPIO_TRI_BIT0::Clear>();		// bit 0 as output
+///	regs.write<GPIO_DATA>(1);
+/// @endcode
+namespace RegisterMap {
+
+/// Access policy of a register that can be read and written.
+struct ReadWrite {
+	static constexpr bool	readable = true;
+	static constexpr bool	writable = true;
+};
+
+/// Access policy of a read-only register, e.g. a status register.
+struct ReadOnly {
+	static constexpr bool	readable = true;
+	static constexpr bool	writable = false;
+};
+
+/// Access policy of a write-only register, e.g. a FIFO input.
+struct WriteOnly {
+	static constexpr bool	readable = false;
+	static constexpr bool	writable = true;
+};
+
+/// 32-bit register.
+/// \tparam INDEX	Index of the register, in 32-bit words.
+/// \tparam ACCESS	Access policy: ReadWrite, ReadOnly or WriteOnly.
+template <std::uint32_t INDEX, typename ACCESS = ReadWrite>
+struct Register {
+	typedef ACCESS	Access;
+
+	/// Index, in 32-bit words.
+	static constexpr std::uint32_t	index = INDEX;
+
+	/// Offset, in bytes.
+	static constexpr std::size_t	offset = INDEX * sizeof(std::uint32_t);
+};
+
+template <typename F, std::uint32_t VALUE> struct FieldValue;
+
+/// Bitfield of a register.
+/// \tparam R		Register.
+/// \tparam SHIFT	Position of the lowest bit.
+/// \tparam WIDTH	Number of bits.
+template <typename R, unsigned int SHIFT, unsigned int WIDTH>
+struct Field {
+	static_assert(WIDTH > 0 && SHIFT + WIDTH <= 32, "Field: bits outside of the register");
+
+	typedef R	Register;
+
+	static constexpr unsigned int	shift = SHIFT;
+	static constexpr unsigned int	width = WIDTH;
+
+	/// Largest value of the field.
+	static constexpr std::uint32_t	max = WIDTH == 32 ? 0xFFFFFFFFu : (1u << WIDTH) - 1u;
+
+	/// Bits of the field in the register.
+	static constexpr std::uint32_t	mask = max << SHIFT;
+
+	/// Field value to register bits; excess bits are cut off.
+	static constexpr std::uint32_t encode(const std::uint32_t value)
+	{
+		return (value << SHIFT) & mask;
+	}
+
+	/// Register value to field value.
+	static constexpr std::uint32_t decode(const std::uint32_t r)
+	{
+		return (r & mask) >> SHIFT;
+	}
+
+	/// Constant value of the field, for Block::modify and Block::assign.
+	template <std::uint32_t VALUE>
+	using Value = FieldValue<Field, VALUE>;
+
+	/// All bits of the field set.
+	typedef FieldValue<Field, max>	Set;
+
+	/// All bits of the field cleared.
+	typedef FieldValue<Field, 0>	Clear;
+};
+
+/// Field with a value known at compile time.
+template <typename F, std::uint32_t VALUE>
+struct FieldValue {
+	static_assert(VALUE <= F::max, "FieldValue: value does not fit the field");
+
+	typedef F							Field;
+	typedef typename F::Register		Register;
+
+	/// Bits of the field in the register.
+	static constexpr std::uint32_t	mask = F::mask;
+
+	/// The value, in place.
+	static constexpr std::uint32_t	bits = F::encode(VALUE);
+};
+
+/// Register bits of the given field values, the other bits zero.
+template <typename... VALUES>
+constexpr std::uint32_t bitsOf()
+{
+	return (VALUES::bits | ... | 0u);
+}
+
+/// Bits covered by the given field values.
+template <typename... VALUES>
+constexpr std::uint32_t maskOf()
+{
+	return (VALUES::mask | ... | 0u);
+}
+
+/// Registers of one IP core in a memory mapping.
+/// \tparam NWORDS	Size of the register file, in 32-bit words. Every register index has to be below.
+template <std::uint32_t NWORDS>
+class Block {
+private:
+	volatile std::uint32_t*	m_base;
+
+	template <typename V, typename... VALUES>
+	static constexpr bool _sameRegister()
+	{
+		return (std::is_same_v<typename V::Register, typename VALUES::Register> && ...);
+	}
+public:
+	/// Number of 32-bit words in the register file.
+	static constexpr std::uint32_t	size32 = NWORDS;
+
+	/// Access the registers at the start of the mapping.
+	/// \param map	Mapping of the register file, at least NWORDS words.
+	explicit Block(MappedFile* map)
+	: m_base(reinterpret_cast<volatile std::uint32_t*>(map->data()))
+	{
+		if (map->size32() < NWORDS) {
+			throw std::runtime_error(ssprintf("RegisterMap::Block: %zu words mapped, %u required", map->size32(), NWORDS));
+		}
+	}
+
+	/// Read a register.
+	template <typename R>
+	std::uint32_t read() const
+	{
+		static_assert(R::index < NWORDS, "Block::read: register outside of the block");
+		static_assert(R::Access::readable, "Block::read: register is write-only");
+		return m_base[R::index];
+	}
+
+	/// Write a register.
+	template <typename R>
+	void write(const std::uint32_t value)
+	{
+		static_assert(R::index < NWORDS, "Block::write: register outside of the block");
+		static_assert(R::Access::writable, "Block::write: register is read-only");
+		m_base[R::index] = value;
+	}
+
+	/// Read a field.
+	template <typename F>
+	std::uint32_t get() const
+	{
+		return F::decode(read<typename F::Register>());
+	}
+
+	/// Read-modify-write of one field with a run-time value.
+	template <typename F>
+	void set(const std::uint32_t value)
+	{
+		typedef typename F::Register	R;
+		write<R>((read<R>() & ~F::mask) | F::encode(value));
+	}
+
+	/// Read-modify-write of fields of one register with constant values; the other bits are kept.
+	/// Masks and bits fold into constants: one load and one store, and no load when the fields cover the register.
+	template <typename V, typename... VALUES>
+	void modify()
+	{
+		static_assert(_sameRegister<V, VALUES...>(), "Block::modify: fields of different registers");
+		typedef typename V::Register	R;
+		constexpr std::uint32_t			mask = maskOf<V, VALUES...>();
+		constexpr std::uint32_t			bits = bitsOf<V, VALUES...>();
+		if constexpr (mask == 0xFFFFFFFFu) {
+			write<R>(bits);
+		} else {
+			write<R>((read<R>() & ~mask) | bits);
+		}
+	}
+
+	/// Write fields of one register with constant values, the other bits zero. No load.
+	template <typename V, typename... VALUES>
+	void assign()
+	{
+		static_assert(_sameRegister<V, VALUES...>(), "Block::assign: fields of different registers");
+		write<typename V::Register>(bitsOf<V, VALUES...>());
+	}
+
+	/// Are all bits of the field set?
+	template <typename F>
+	bool isSet() const
+	{
+		return (read<typename F::Register>() & F::mask) == F::mask;
+	}
+};
+
+} // namespace RegisterMap
+} // namespace smart
@@ -0,0 +1,312 @@
+/// \file  SharedCircularBuffer.cpp
+/// \brief	Implementation of the class SharedCircularBuffer.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#include <cerrno>			// errno
+#include <cstring>			// strerror
+#include <stdexcept>		// std::runtime_error
+
+#include <fcntl.h>			// open, fcntl
+#include <signal.h>			// kill
+#include <sys/file.h>		// flock
+#include <sys/mman.h>		// mmap
+#include <sys/stat.h>		// fstat
+#include <unistd.h>			// close, ftruncate, getpid, pread
+
+#include "futex.h"			// futex_wait, futex_wake
+#include "string.h"			// ssprintf
+
+#include "SharedCircularBuffer.h"	// ourselves.
+
+namespace smart {
+
+static_assert(sizeof(std::atomic_uint) == sizeof(int) && std::atomic_uint::is_always_lock_free,
+	"the indices double as futex words");
+static_assert(sizeof(SharedCircularBufferBase::Header) == 3u * SharedCircularBufferBase::CACHE_LINE_SIZE,
+	"the header layout is fixed");
+
+/// The plain fields at the start of the Header, as read from the file.
+struct HeaderPrefix {
+	std::uint32_t	magic;
+	std::uint32_t	version;
+	std::uint32_t	element_size;
+	std::uint32_t	size;
+	std::uint64_t	data_offset;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+static const char* role_name(const SharedCircularBufferBase::Role role)
+{
+	return role == SharedCircularBufferBase::Role::PRODUCER ? "producer" : "consumer";
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Is the process alive? A process we may not signal is alive, too.
+static bool process_alive(const int pid)
+{
+	return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+SharedCircularBufferBase::SharedCircularBufferBase(const int fd, const std::string& name, const std::size_t element_size,
+	const std::size_t element_alignment, const unsigned int size, const Role role)
+: header_(nullptr),
+  data_(nullptr),
+  slots_(0),
+  fd_(fcntl(fd, F_DUPFD_CLOEXEC, 0)),
+  name_(name),
+  role_(role),
+  mapping_size_(0)
+{
+	if (fd_ < 0) {
+		throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: %s", name_.c_str(), strerror(errno)));
+	}
+	try {
+		open(element_size, element_alignment, size);
+	} catch (...) {
+		close();
+		throw;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+SharedCircularBufferBase::SharedCircularBufferBase(const std::string& path, const std::size_t element_size,
+	const std::size_t element_alignment, const unsigned int size, const Role role)
+: header_(nullptr),
+  data_(nullptr),
+  slots_(0),
+  fd_(::open(path.c_str(), size == 0 ? O_RDWR|O_CLOEXEC : O_RDWR|O_CREAT|O_CLOEXEC, 0600)),
+  name_(path),
+  role_(role),
+  mapping_size_(0)
+{
+	if (fd_ < 0) {
+		throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: %s", name_.c_str(), strerror(errno)));
+	}
+	try {
+		open(element_size, element_alignment, size);
+	} catch (...) {
+		close();
+		throw;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+SharedCircularBufferBase::~SharedCircularBufferBase()
+{
+	std::atomic_int&	pid = role_ == Role::PRODUCER ? header_->producer_pid : header_->consumer_pid;
+	int					me = getpid();
+	(role_ == Role::PRODUCER ? header_->producer_parked : header_->consumer_parked).store(0u);
+	pid.compare_exchange_strong(me, 0);
+	close();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void SharedCircularBufferBase::open(const std::size_t element_size, const std::size_t element_alignment, const unsigned int size)
+{
+	if (element_size == 0 || element_alignment > CACHE_LINE_SIZE) {
+		throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: unsupported element size %zu, alignment %zu",
+			name_.c_str(), element_size, element_alignment));
+	}
+	if (size == 1) {
+		throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: size 1", name_.c_str()));
+	}
+
+	// Exclusive while initializing; the lock goes away with a crashed process, too.
+	if (flock(fd_, LOCK_EX) != 0) {
+		throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: flock: %s", name_.c_str(), strerror(errno)));
+	}
+	try {
+		struct stat		st;
+		HeaderPrefix	prefix = {};
+		if (fstat(fd_, &st) != 0) {
+			throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: fstat: %s", name_.c_str(), strerror(errno)));
+		}
+		const std::uint64_t	file_size = st.st_size;
+		if (file_size >= sizeof(Header) && pread(fd_, &prefix, sizeof(prefix), 0) != sizeof(prefix)) {
+			throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: read: %s", name_.c_str(), strerror(errno)));
+		}
+
+		// An initializer that died before writing the magic leaves it 0.
+		const bool	initialize = file_size == 0 || (file_size >= sizeof(Header) && prefix.magic == 0);
+		if (initialize) {
+			if (size == 0) {
+				throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: not initialized", name_.c_str()));
+			}
+			prefix.size = size;
+			prefix.element_size = element_size;
+			prefix.data_offset = sizeof(Header);
+		} else if (file_size < sizeof(Header) || prefix.magic != MAGIC) {
+			throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: not a shared circular buffer", name_.c_str()));
+		} else if (prefix.version != VERSION) {
+			throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: version %u, expected %u",
+				name_.c_str(), prefix.version, VERSION));
+		} else if (prefix.element_size != element_size) {
+			throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: element size %u, expected %zu",
+				name_.c_str(), prefix.element_size, element_size));
+		} else if (size != 0 && prefix.size != size) {
+			throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: size %u, expected %u",
+				name_.c_str(), prefix.size, size));
+		} else if (prefix.size < 2 || prefix.data_offset % CACHE_LINE_SIZE != 0 || prefix.data_offset < sizeof(Header)
+			|| file_size < prefix.data_offset + std::uint64_t(prefix.size) * element_size) {
+			throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: corrupt header", name_.c_str()));
+		}
+
+		const std::uint64_t	total = prefix.data_offset + std::uint64_t(prefix.size) * element_size;
+		if (initialize && ftruncate(fd_, total) != 0) {
+			throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: ftruncate: %s", name_.c_str(), strerror(errno)));
+		}
+		void*	p = mmap(nullptr, total, PROT_READ|PROT_WRITE, MAP_SHARED, fd_, 0);
+		if (p == MAP_FAILED) {
+			throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: mmap: %s", name_.c_str(), strerror(errno)));
+		}
+		mapping_size_ = total;
+		header_ = static_cast<Header*>(p);
+		data_ = static_cast<unsigned char*>(p) + prefix.data_offset;
+		slots_ = prefix.size;
+
+		if (initialize) {
+			header_->version = VERSION;
+			header_->element_size = prefix.element_size;
+			header_->size = prefix.size;
+			header_->data_offset = prefix.data_offset;
+			header_->push_index.store(0u, std::memory_order_relaxed);
+			header_->consumer_parked.store(0u, std::memory_order_relaxed);
+			header_->producer_pid.store(0, std::memory_order_relaxed);
+			header_->pop_index.store(0u, std::memory_order_relaxed);
+			header_->producer_parked.store(0u, std::memory_order_relaxed);
+			header_->consumer_pid.store(0, std::memory_order_relaxed);
+			header_->magic.store(MAGIC, std::memory_order_release);
+		}
+	} catch (...) {
+		flock(fd_, LOCK_UN);
+		throw;
+	}
+	flock(fd_, LOCK_UN);
+
+	// Attach, taking over from a dead process.
+	std::atomic_int&	pid = role_ == Role::PRODUCER ? header_->producer_pid : header_->consumer_pid;
+	const int			me = getpid();
+	int					current = 0;
+	while (!pid.compare_exchange_strong(current, me)) {
+		if (current == me || process_alive(current)) {
+			throw std::runtime_error(ssprintf("SharedCircularBuffer: %s: %s is attached by process %d",
+				name_.c_str(), role_name(role_), current));
+		}
+	}
+	(role_ == Role::PRODUCER ? header_->producer_parked : header_->consumer_parked).store(0u);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void SharedCircularBufferBase::close()
+{
+	if (header_ != nullptr) {
+		munmap(header_, mapping_size_);
+		header_ = nullptr;
+		data_ = nullptr;
+	}
+	if (fd_ >= 0) {
+		::close(fd_);
+		fd_ = -1;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+unsigned int SharedCircularBufferBase::size() const
+{
+	const unsigned int	push_index = header_->push_index.load(std::memory_order_acquire);
+	const unsigned int	pop_index = header_->pop_index.load(std::memory_order_acquire);
+	return (push_index + slots_ - pop_index) % slots_;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+unsigned int SharedCircularBufferBase::available() const
+{
+	const unsigned int	push_index = header_->push_index.load(std::memory_order_acquire);
+	const unsigned int	pop_index = header_->pop_index.load(std::memory_order_acquire);
+	return (slots_ - 1u + pop_index - push_index) % slots_;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+unsigned int SharedCircularBufferBase::capacity() const
+{
+	return slots_ - 1u;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void SharedCircularBufferBase::commit(const unsigned int n)
+{
+	const unsigned int	push_index = header_->push_index.load(std::memory_order_relaxed);
+	publish_push_index((push_index + n) % slots_);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void SharedCircularBufferBase::consume(const unsigned int n)
+{
+	const unsigned int	pop_index = header_->pop_index.load(std::memory_order_relaxed);
+	publish_pop_index((pop_index + n) % slots_);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+int SharedCircularBufferBase::peer() const
+{
+	const int	pid = (role_ == Role::PRODUCER ? header_->consumer_pid : header_->producer_pid).load();
+	return pid != 0 && process_alive(pid) ? pid : 0;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void SharedCircularBufferBase::publish_push_index(const unsigned int push_index)
+{
+	// Sequentially consistent, thus either the consumer sees the new index or we see it parked.
+	header_->push_index.store(push_index, std::memory_order_seq_cst);
+	if (header_->consumer_parked.load(std::memory_order_seq_cst) != 0u) {
+		futex_wake(header_->push_index, true);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void SharedCircularBufferBase::publish_pop_index(const unsigned int pop_index)
+{
+	header_->pop_index.store(pop_index, std::memory_order_seq_cst);
+	if (header_->producer_parked.load(std::memory_order_seq_cst) != 0u) {
+		futex_wake(header_->pop_index, true);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+bool SharedCircularBufferBase::wait(const Role role, const unsigned int n, const std::chrono::nanoseconds timeout)
+{
+	// The consumer parks on the push index, the producer on the pop index.
+	std::atomic_uint&	index = role == Role::CONSUMER ? header_->push_index : header_->pop_index;
+	std::atomic_uint&	parked = role == Role::CONSUMER ? header_->consumer_parked : header_->producer_parked;
+	auto				ready = [this, role, n] { return (role == Role::CONSUMER ? size() : available()) >= n; };
+
+	if (ready()) {
+		return true;
+	}
+	if (n > capacity()) {
+		return false;
+	}
+	const auto	deadline = std::chrono::steady_clock::now() + timeout;
+	for (;;) {
+		const unsigned int	seen = index.load(std::memory_order_acquire);
+		if (ready()) {
+			return true;
+		}
+		const auto	remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+		if (remaining.count() <= 0) {
+			return false;
+		}
+		parked.store(1u, std::memory_order_seq_cst);
+		// The other side can't bring the index back to seen without us moving ours.
+		if (index.load(std::memory_order_seq_cst) == seen) {
+			futex_wait(index, seen, remaining, true);
+		}
+		parked.store(0u, std::memory_order_relaxed);
+	}
+}
+
+} // namespace smart
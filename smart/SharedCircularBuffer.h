@@ -0,0 +1,304 @@
+/// \file  SharedCircularBuffer.h
+/// \brief	Interface of the class SharedCircularBuffer.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#pragma once
+
+#include <algorithm>		// std::copy_n
+#include <atomic>			// std::atomic
+#include <chrono>			// std::chrono::duration
+#include <cstddef>			// std::size_t
+#include <cstdint>			// std::uint32_t
+#include <span>				// std::span
+#include <string>			// std::string
+#include <type_traits>		// std::is_trivially_copyable_v
+
+#include "CircularBuffer.h"	// CircularBuffer::Region
+
+
+namespace smart {
+
+/// Untyped part of SharedCircularBuffer: the mapping, the header and the indices.
+class SharedCircularBufferBase {
+public:
+	/// Side of the ring a process attaches to; one process at a time per side.
+	enum class Role {
+		PRODUCER,
+		CONSUMER
+	};
+
+	/// "SCB1", marks an initialized ring.
+	static constexpr std::uint32_t	MAGIC = 0x31424353u;
+
+	/// Layout version of the Header.
+	static constexpr std::uint32_t	VERSION = 1u;
+
+	/// Size of the cache line the sides are kept apart by.
+	static constexpr std::size_t	CACHE_LINE_SIZE = 64u;
+
+	/// Fixed layout at the start of the mapping, the same for 32-bit and 64-bit processes.
+	/// Holds indices only, no pointers, thus the mapping can live at any address in every process.
+	struct Header {
+		/// MAGIC once initialized; written last.
+		std::atomic<std::uint32_t>	magic;
+
+		/// VERSION.
+		std::uint32_t				version;
+
+		/// Size of an element in bytes.
+		std::uint32_t				element_size;
+
+		/// Number of slots; the capacity is one less, like in CircularBuffer.
+		std::uint32_t				size;
+
+		/// Offset of the first slot from the start of the mapping.
+		std::uint64_t				data_offset;
+
+		/// Written by the producer: index of the next slot to be written.
+		alignas(CACHE_LINE_SIZE) std::atomic_uint	push_index;
+
+		/// Nonzero while the consumer is parked on push_index.
+		std::atomic_uint			consumer_parked;
+
+		/// Process ID of the attached producer, 0 when none.
+		std::atomic_int				producer_pid;
+
+		/// Written by the consumer: index of the next slot to be read.
+		alignas(CACHE_LINE_SIZE) std::atomic_uint	pop_index;
+
+		/// Nonzero while the producer is parked on pop_index.
+		std::atomic_uint			producer_parked;
+
+		/// Process ID of the attached consumer, 0 when none.
+		std::atomic_int				consumer_pid;
+	};
+
+	SharedCircularBufferBase(const SharedCircularBufferBase&) = delete;
+	SharedCircularBufferBase& operator=(const SharedCircularBufferBase&) = delete;
+
+	/// Detach, unmap and close; the ring itself stays for the other side.
+	~SharedCircularBufferBase();
+
+	/// Number of elements currently stored.
+	unsigned int size() const;
+
+	/// Number of locations available.
+	unsigned int available() const;
+
+	/// Total capacity.
+	unsigned int capacity() const;
+
+	/// Is the ring empty?
+	bool empty() const
+	{
+		return size() == 0u;
+	}
+
+	/// Producer: publish n elements written in place; doesn't check n.
+	void commit(const unsigned int n);
+
+	/// Consumer: drop the first n elements; doesn't check n.
+	void consume(const unsigned int n);
+
+	/// Consumer: wait until at least n elements are stored, or the timeout expires.
+	/// \return true if there are n elements, false on timeout or when n exceeds the capacity.
+	template <class Rep, class Period>
+	bool wait_for_data(const unsigned int n, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return wait(Role::CONSUMER, n, std::chrono::duration_cast<std::chrono::nanoseconds>(timeout));
+	}
+
+	/// Producer: wait until at least n locations are free, or the timeout expires.
+	/// \return true if there is room for n elements, false on timeout or when n exceeds the capacity.
+	template <class Rep, class Period>
+	bool wait_for_space(const unsigned int n, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return wait(Role::PRODUCER, n, std::chrono::duration_cast<std::chrono::nanoseconds>(timeout));
+	}
+
+	/// Process ID of the process attached to the other side, 0 when none or when it has died.
+	int peer() const;
+
+	/// Our side.
+	Role role() const
+	{
+		return role_;
+	}
+
+	/// File descriptor of the mapping, e.g. to be passed to another process.
+	int fd() const
+	{
+		return fd_;
+	}
+protected:
+	/// Open or create the ring in the file, and attach to it.
+	/// Under an exclusive lock on the file, an empty or half-initialized file is initialized with size slots;
+	/// otherwise the header is validated against element_size, and against size unless that is 0.
+	/// \param fd			Open file, e.g. in /dev/shm or from memfd_create; duplicated.
+	/// \param name			Name of the file, for the error messages.
+	/// \param size			Number of slots, at least 2; 0 to attach to an existing ring only.
+	/// \param role			Side to attach to. A side held by a dead process is taken over.
+	SharedCircularBufferBase(const int fd, const std::string& name, const std::size_t element_size,
+		const std::size_t element_alignment, const unsigned int size, const Role role);
+
+	/// Open or create the file at the path, then as above.
+	SharedCircularBufferBase(const std::string& path, const std::size_t element_size,
+		const std::size_t element_alignment, const unsigned int size, const Role role);
+
+	/// Store a new push index, waking the consumer if it is parked.
+	void publish_push_index(const unsigned int push_index);
+
+	/// Store a new pop index, waking the producer if it is parked.
+	void publish_pop_index(const unsigned int pop_index);
+
+	/// The header, in the mapping.
+	Header*			header_;
+
+	/// The first slot, in the mapping.
+	unsigned char*	data_;
+
+	/// header_->size.
+	unsigned int	slots_;
+private:
+	/// Park until the other side has made room for n, or the timeout expires.
+	bool wait(const Role role, const unsigned int n, const std::chrono::nanoseconds timeout);
+
+	/// Validate or initialize the header, map the file and attach.
+	void open(const std::size_t element_size, const std::size_t element_alignment, const unsigned int size);
+
+	/// Unmap and close.
+	void close();
+
+	/// File descriptor, owned.
+	int				fd_;
+
+	/// Name of the file, for the error messages.
+	std::string		name_;
+
+	/// Our side.
+	const Role		role_;
+
+	/// Bytes mapped.
+	std::size_t		mapping_size_;
+}; // class SharedCircularBufferBase
+
+/// Circular buffer shared between processes, in a memfd or a file in /dev/shm.
+///
+/// The ring has the index semantics of CircularBuffer: one producer and one consumer, indices in [0, size),
+/// capacity size - 1. The indices and the elements live in a shared mapping with a fixed-layout Header,
+/// so that the producer writes an element once and the consumer reads it in place, e.g. via #readable.
+///
+/// Each side is attached by one process at a time; its process ID is kept in the header. When a process dies
+/// without detaching, the next process to attach to the same side takes over, continuing at the index left.
+/// Elements reserved but not committed by the dead process are lost, committed ones are not.
+/// The check uses kill(pid, 0), thus a reused process ID keeps the side busy until that process ends.
+///
+/// Example:
+/// @code
+///	// Capture process.
+///	SharedCircularBuffer<std::int16_t>	ring("/dev/shm/capture", 1u << 20, SharedCircularBuffer<std::int16_t>::Role::PRODUCER);
+///	auto	region = ring.reserve(4096);
+///	...
+///	ring.commit(region.size());
+///
+///	// Recording process.
+///	SharedCircularBuffer<std::int16_t>	ring("/dev/shm/capture", 0, SharedCircularBuffer<std::int16_t>::Role::CONSUMER);
+///	if (ring.wait_for_data(4096, std::chrono::seconds(1))) {
+///		const auto	region = ring.readable();
+///		...
+///		ring.consume(region.size());
+///	}
+/// @endcode
+template <class E>
+class SharedCircularBuffer : public SharedCircularBufferBase {
+	static_assert(std::is_trivially_copyable_v<E>, "elements are shared as bytes");
+public:
+	/// Up to two pieces of the ring, as in CircularBuffer.
+	template <class T>
+	using Region = typename CircularBuffer<E>::template Region<T>;
+
+	/// Open or create the ring in the file at the path, e.g. in /dev/shm, and attach to it.
+	/// \param size		Number of slots; 0 to attach to an existing ring only.
+	SharedCircularBuffer(const std::string& path, const unsigned int size, const Role role)
+	: SharedCircularBufferBase(path, sizeof(E), alignof(E), size, role)
+	{
+	}
+
+	/// Open or create the ring in an open file, e.g. from memfd_create, and attach to it.
+	/// \param size		Number of slots; 0 to attach to an existing ring only.
+	SharedCircularBuffer(const int fd, const unsigned int size, const Role role)
+	: SharedCircularBufferBase(fd, "fd", sizeof(E), alignof(E), size, role)
+	{
+	}
+
+	/// Producer: push element \c e.
+	/// \return true on success, false when full.
+	bool push(const E& e)
+	{
+		return push(&e, &e + 1);
+	}
+
+	/// Producer: push a range of elements, all or none.
+	/// \return true on success, false when there is not enough room.
+	bool push(const E* first, const E* last)
+	{
+		const unsigned int	n = last - first;
+		if (available() < n) {
+			return false;
+		}
+		const Region<E>	r = reserve(n);
+		std::copy_n(first, r.first.size(), r.first.data());
+		std::copy_n(first + r.first.size(), r.second.size(), r.second.data());
+		commit(n);
+		return true;
+	}
+
+	/// Consumer: pop an element.
+	/// \return true if popped, false if the ring was empty.
+	bool pop(E& e)
+	{
+		return pop_n(&e, 1u) == 1u;
+	}
+
+	/// Consumer: pop as many elements as available, up to n_max.
+	/// \return Number of elements popped.
+	unsigned int pop_n(E* dst, const unsigned int n_max)
+	{
+		const Region<const E>	r = readable();
+		const unsigned int		n1 = std::min<unsigned int>(n_max, r.first.size());
+		const unsigned int		n2 = std::min<unsigned int>(n_max - n1, r.second.size());
+		std::copy_n(r.first.data(), n1, dst);
+		std::copy_n(r.second.data(), n2, dst + n1);
+		consume(n1 + n2);
+		return n1 + n2;
+	}
+
+	/// Producer: free locations to be written in place, up to n of them; make them visible with #commit.
+	/// \return The locations, fewer than n when the ring is short of room.
+	Region<E> reserve(const unsigned int n)
+	{
+		const unsigned int	push_index = header_->push_index.load(std::memory_order_relaxed);
+		return region<E>(push_index, std::min(n, available()));
+	}
+
+	/// Consumer: all elements stored, in place; free them with #consume.
+	Region<const E> readable() const
+	{
+		const unsigned int	pop_index = header_->pop_index.load(std::memory_order_relaxed);
+		return region<const E>(pop_index, size());
+	}
+private:
+	/// n elements starting at the index, split at the end of the ring.
+	template <class T>
+	Region<T> region(const unsigned int index, const unsigned int n) const
+	{
+		T*					data = reinterpret_cast<T*>(data_);
+		const unsigned int	n1 = std::min<unsigned int>(slots_ - index, n);
+		return Region<T>{ std::span<T>(data + index, n1), std::span<T>(data, n - n1) };
+	}
+}; // class SharedCircularBuffer
+
+} // namespace smart
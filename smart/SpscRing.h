@@ -0,0 +1,182 @@
+/// \file  SpscRing.h
+/// \brief	Interface and implementation of the class SpscRing.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#pragma once
+
+#include <algorithm>	// std::min
+#include <atomic>		// std::atomic
+#include <cstddef>		// std::size_t
+#include <vector>		// std::vector
+
+
+namespace smart {
+
+/// Lock-free ring for exactly one producer thread and one consumer thread.
+///
+/// Unlike CircularBuffer, the two indices live on cache lines of their own, and each side keeps a private copy of
+/// the other side's index, which it reloads only when the ring looks full or empty. Thus in the steady state
+/// a push or a pop touches no cache line written by the other thread except the element itself.
+/// The capacity is a power of 2 and the indices run freely, so that masking replaces the modulo and all
+/// capacity slots are usable.
+template <class E>
+class SpscRing {
+public:
+	/// Size of the cache line the indices are kept apart by.
+	static constexpr std::size_t	CACHE_LINE_SIZE = 64u;
+
+	/// Initialize the ring to empty state.
+	/// \param capacity	Minimum number of elements, rounded up to a power of 2.
+	explicit SpscRing(const std::size_t capacity)
+	: buffer_(round_up_pow2(capacity)),
+	  mask_(buffer_.size() - 1u)
+	{
+		producer_.index.store(0u, std::memory_order_relaxed);
+		producer_.cached_pop_index = 0u;
+		consumer_.index.store(0u, std::memory_order_relaxed);
+		consumer_.cached_push_index = 0u;
+	}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	/// Producer: push element \c e into the ring.
+	/// \return true on success, false when full.
+	bool push(const E& e)
+	{
+		const std::size_t	push_index = producer_.index.load(std::memory_order_relaxed);
+		if (push_index - producer_.cached_pop_index == buffer_.size()) {
+			producer_.cached_pop_index = consumer_.index.load(std::memory_order_acquire);
+			if (push_index - producer_.cached_pop_index == buffer_.size()) {
+				return false;
+			}
+		}
+		buffer_[push_index & mask_] = e;
+		producer_.index.store(push_index + 1u, std::memory_order_release);
+		return true;
+	}
+
+	/// Producer: push a range of elements, all or none.
+	/// \return true on success, false when there is not enough room.
+	bool push(const E* first, const E* last)
+	{
+		const std::size_t	n = last - first;
+		const std::size_t	push_index = producer_.index.load(std::memory_order_relaxed);
+		if (buffer_.size() - (push_index - producer_.cached_pop_index) < n) {
+			producer_.cached_pop_index = consumer_.index.load(std::memory_order_acquire);
+			if (buffer_.size() - (push_index - producer_.cached_pop_index) < n) {
+				return false;
+			}
+		}
+		const std::size_t	start = push_index & mask_;
+		const std::size_t	n1 = std::min(n, buffer_.size() - start);
+		std::copy_n(first, n1, &buffer_[start]);
+		std::copy_n(first + n1, n - n1, &buffer_[0]);
+		producer_.index.store(push_index + n, std::memory_order_release);
+		return true;
+	}
+
+	/// Consumer: pop an element.
+	/// \return true if popped, false if the ring was empty.
+	bool pop(E& e)
+	{
+		const std::size_t	pop_index = consumer_.index.load(std::memory_order_relaxed);
+		if (pop_index == consumer_.cached_push_index) {
+			consumer_.cached_push_index = producer_.index.load(std::memory_order_acquire);
+			if (pop_index == consumer_.cached_push_index) {
+				return false;
+			}
+		}
+		e = buffer_[pop_index & mask_];
+		consumer_.index.store(pop_index + 1u, std::memory_order_release);
+		return true;
+	}
+
+	/// Consumer: pop as many elements as available, up to n_max.
+	/// \return Number of elements popped.
+	std::size_t pop_n(E* dst, const std::size_t n_max)
+	{
+		const std::size_t	pop_index = consumer_.index.load(std::memory_order_relaxed);
+		if (consumer_.cached_push_index - pop_index < n_max) {
+			consumer_.cached_push_index = producer_.index.load(std::memory_order_acquire);
+		}
+		const std::size_t	n = std::min(n_max, consumer_.cached_push_index - pop_index);
+		const std::size_t	start = pop_index & mask_;
+		const std::size_t	n1 = std::min(n, buffer_.size() - start);
+		std::copy_n(&buffer_[start], n1, dst);
+		std::copy_n(&buffer_[0], n - n1, dst + n1);
+		consumer_.index.store(pop_index + n, std::memory_order_release);
+		return n;
+	}
+
+	/// Consumer: drop all elements.
+	void clear()
+	{
+		consumer_.cached_push_index = producer_.index.load(std::memory_order_acquire);
+		consumer_.index.store(consumer_.cached_push_index, std::memory_order_release);
+	}
+
+	/// Number of elements stored; exact only on the consumer or the producer side.
+	std::size_t size() const
+	{
+		const std::size_t	pop_index = consumer_.index.load(std::memory_order_acquire);
+		const std::size_t	push_index = producer_.index.load(std::memory_order_acquire);
+		return push_index - pop_index;
+	}
+
+	/// Is the ring empty?
+	bool empty() const
+	{
+		return size() == 0u;
+	}
+
+	/// Number of elements that can be pushed.
+	std::size_t available() const
+	{
+		return buffer_.size() - size();
+	}
+
+	/// Total capacity of the ring.
+	std::size_t capacity() const
+	{
+		return buffer_.size();
+	}
+private:
+	static std::size_t round_up_pow2(const std::size_t n)
+	{
+		std::size_t	r = 1u;
+		while (r < n) {
+			r <<= 1;
+		}
+		return r;
+	}
+
+	/// Elements; the size is a power of 2.
+	std::vector<E>			buffer_;
+
+	/// buffer_.size() - 1.
+	const std::size_t		mask_;
+
+	/// Written by the producer only.
+	struct alignas(CACHE_LINE_SIZE) Producer {
+		/// Number of elements pushed so far.
+		std::atomic<std::size_t>	index;
+
+		/// Consumer index as last seen.
+		std::size_t					cached_pop_index;
+	} producer_;
+
+	/// Written by the consumer only.
+	struct alignas(CACHE_LINE_SIZE) Consumer {
+		/// Number of elements popped so far.
+		std::atomic<std::size_t>	index;
+
+		/// Producer index as last seen.
+		std::size_t					cached_push_index;
+	} consumer_;
+}; // class SpscRing
+
+} // namespace smart
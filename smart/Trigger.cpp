@@ -0,0 +1,422 @@
+/// \file  Trigger.cpp
+/// \brief	Definitions of the trigger condition search functions.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#include <algorithm>	// std::clamp
+#include <cstdint>		// std::int16_t
+#include <limits>		// std::numeric_limits
+
+#if defined(__AVX2__)
+#include <immintrin.h>	// AVX2
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>	// SSE2
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>	// NEON
+#endif
+
+#include "Trigger.h"	// ourselves.
+
+namespace smart {
+namespace Trigger {
+
+// --------------------------------------------------------------------------------------------------------------------
+// Vector kernels.
+//
+// Each condition is built from two signed comparisons per sample, x > high and low > x, and for the edges the same
+// comparison on the preceding sample, loaded from one sample earlier. The lane mask locates the first hit.
+// Traits per instruction set and sample type provide the comparison and the lane mask; in the mask, lane i
+// occupies BITS_PER_LANE bits starting at bit i*BITS_PER_LANE.
+
+#if defined(__AVX2__)
+/// AVX2 operations common to all sample types.
+struct Avx2Base {
+	typedef __m256i	Vector;
+
+	static Vector load(const void* p)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	}
+
+	static Vector or_(const Vector a, const Vector b)
+	{
+		return _mm256_or_si256(a, b);
+	}
+
+	/// ~a & b
+	static Vector andnot(const Vector a, const Vector b)
+	{
+		return _mm256_andnot_si256(a, b);
+	}
+
+	static Vector ones()
+	{
+		return _mm256_set1_epi32(-1);
+	}
+
+	static std::uint64_t mask(const Vector v)
+	{
+		return static_cast<std::uint32_t>(_mm256_movemask_epi8(v));
+	}
+};
+
+template <typename T> struct Avx2;
+
+template <> struct Avx2<std::int16_t> : Avx2Base {
+	static constexpr unsigned int LANES = 16;
+	static constexpr unsigned int BITS_PER_LANE = 2;
+
+	static Vector set1(const std::int16_t x)
+	{
+		return _mm256_set1_epi16(x);
+	}
+
+	static Vector gt(const Vector a, const Vector b)
+	{
+		return _mm256_cmpgt_epi16(a, b);
+	}
+};
+
+template <> struct Avx2<std::int32_t> : Avx2Base {
+	static constexpr unsigned int LANES = 8;
+	static constexpr unsigned int BITS_PER_LANE = 4;
+
+	static Vector set1(const std::int32_t x)
+	{
+		return _mm256_set1_epi32(x);
+	}
+
+	static Vector gt(const Vector a, const Vector b)
+	{
+		return _mm256_cmpgt_epi32(a, b);
+	}
+};
+
+template <typename T> using Simd = Avx2<T>;
+static const char* const	SIMD_NAME = "AVX2";
+
+#elif defined(__SSE2__)
+/// SSE2 operations common to all sample types.
+struct Sse2Base {
+	typedef __m128i	Vector;
+
+	static Vector load(const void* p)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	}
+
+	static Vector or_(const Vector a, const Vector b)
+	{
+		return _mm_or_si128(a, b);
+	}
+
+	/// ~a & b
+	static Vector andnot(const Vector a, const Vector b)
+	{
+		return _mm_andnot_si128(a, b);
+	}
+
+	static Vector ones()
+	{
+		return _mm_set1_epi32(-1);
+	}
+
+	static std::uint64_t mask(const Vector v)
+	{
+		return static_cast<std::uint32_t>(_mm_movemask_epi8(v));
+	}
+};
+
+template <typename T> struct Sse2;
+
+template <> struct Sse2<std::int16_t> : Sse2Base {
+	static constexpr unsigned int LANES = 8;
+	static constexpr unsigned int BITS_PER_LANE = 2;
+
+	static Vector set1(const std::int16_t x)
+	{
+		return _mm_set1_epi16(x);
+	}
+
+	static Vector gt(const Vector a, const Vector b)
+	{
+		return _mm_cmpgt_epi16(a, b);
+	}
+};
+
+template <> struct Sse2<std::int32_t> : Sse2Base {
+	static constexpr unsigned int LANES = 4;
+	static constexpr unsigned int BITS_PER_LANE = 4;
+
+	static Vector set1(const std::int32_t x)
+	{
+		return _mm_set1_epi32(x);
+	}
+
+	static Vector gt(const Vector a, const Vector b)
+	{
+		return _mm_cmpgt_epi32(a, b);
+	}
+};
+
+template <typename T> using Simd = Sse2<T>;
+static const char* const	SIMD_NAME = "SSE2";
+
+#elif defined(__ARM_NEON)
+/// NEON operations common to all sample types. Comparison results are kept as uint8x16_t.
+struct NeonBase {
+	typedef uint8x16_t	Vector;
+
+	static Vector or_(const Vector a, const Vector b)
+	{
+		return vorrq_u8(a, b);
+	}
+
+	/// ~a & b
+	static Vector andnot(const Vector a, const Vector b)
+	{
+		return vbicq_u8(b, a);
+	}
+
+	static Vector ones()
+	{
+		return vdupq_n_u8(0xFF);
+	}
+};
+
+template <typename T> struct Neon;
+
+template <> struct Neon<std::int16_t> : NeonBase {
+	static constexpr unsigned int LANES = 8;
+	static constexpr unsigned int BITS_PER_LANE = 8;
+
+	static Vector load(const void* p)
+	{
+		return vreinterpretq_u8_s16(vld1q_s16(reinterpret_cast<const std::int16_t*>(p)));
+	}
+
+	static Vector set1(const std::int16_t x)
+	{
+		return vreinterpretq_u8_s16(vdupq_n_s16(x));
+	}
+
+	static Vector gt(const Vector a, const Vector b)
+	{
+		return vreinterpretq_u8_u16(vcgtq_s16(vreinterpretq_s16_u8(a), vreinterpretq_s16_u8(b)));
+	}
+
+	/// No movemask on NEON: narrow every 16-bit lane to a byte.
+	static std::uint64_t mask(const Vector v)
+	{
+		return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+	}
+};
+
+template <> struct Neon<std::int32_t> : NeonBase {
+	static constexpr unsigned int LANES = 4;
+	static constexpr unsigned int BITS_PER_LANE = 16;
+
+	static Vector load(const void* p)
+	{
+		return vreinterpretq_u8_s32(vld1q_s32(reinterpret_cast<const std::int32_t*>(p)));
+	}
+
+	static Vector set1(const std::int32_t x)
+	{
+		return vreinterpretq_u8_s32(vdupq_n_s32(x));
+	}
+
+	static Vector gt(const Vector a, const Vector b)
+	{
+		return vreinterpretq_u8_u32(vcgtq_s32(vreinterpretq_s32_u8(a), vreinterpretq_s32_u8(b)));
+	}
+
+	/// Narrow every 32-bit lane to 16 bits.
+	static std::uint64_t mask(const Vector v)
+	{
+		return vget_lane_u64(vreinterpret_u64_u16(vmovn_u32(vreinterpretq_u32_u8(v))), 0);
+	}
+};
+
+template <typename T> using Simd = Neon<T>;
+static const char* const	SIMD_NAME = "NEON";
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(__ARM_NEON)
+#define SMART_TRIGGER_SIMD 1
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Scan whole vectors from the index 1 on, samples[i-1] being the preceding sample of samples[i].
+/// \return Index of the vector holding the first hit plus the lane, or the first index not scanned.
+template <typename T, Kind K>
+static std::size_t _find_first_simd(const T* samples, const std::size_t nsamples, const T low, const T high)
+{
+	typedef Simd<T>	S;
+	const typename S::Vector	v_low = S::set1(low);
+	const typename S::Vector	v_high = S::set1(high);
+	std::size_t					i = 1;
+
+	for (; i + S::LANES <= nsamples; i += S::LANES) {
+		const typename S::Vector	v = S::load(&samples[i]);
+		typename S::Vector			hit;
+		if constexpr (K == Kind::ABOVE) {
+			hit = S::gt(v, v_high);
+		} else if constexpr (K == Kind::BELOW) {
+			hit = S::gt(v_low, v);
+		} else if constexpr (K == Kind::RISING) {
+			hit = S::andnot(S::gt(S::load(&samples[i - 1]), v_high), S::gt(v, v_high));
+		} else if constexpr (K == Kind::FALLING) {
+			hit = S::andnot(S::gt(v_low, S::load(&samples[i - 1])), S::gt(v_low, v));
+		} else if constexpr (K == Kind::INSIDE) {
+			hit = S::andnot(S::or_(S::gt(v, v_high), S::gt(v_low, v)), S::ones());
+		} else {
+			hit = S::or_(S::gt(v, v_high), S::gt(v_low, v));
+		}
+		const std::uint64_t	m = S::mask(hit);
+		if (m != 0) {
+			return i + __builtin_ctzll(m) / S::BITS_PER_LANE;
+		}
+	}
+	return i;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template <typename T>
+static std::size_t _find_first_simd(const T* samples, const std::size_t nsamples, const Kind kind, const T low, const T high)
+{
+	switch (kind) {
+	case Kind::ABOVE:	return _find_first_simd<T, Kind::ABOVE>(samples, nsamples, low, high);
+	case Kind::BELOW:	return _find_first_simd<T, Kind::BELOW>(samples, nsamples, low, high);
+	case Kind::RISING:	return _find_first_simd<T, Kind::RISING>(samples, nsamples, low, high);
+	case Kind::FALLING:	return _find_first_simd<T, Kind::FALLING>(samples, nsamples, low, high);
+	case Kind::INSIDE:	return _find_first_simd<T, Kind::INSIDE>(samples, nsamples, low, high);
+	case Kind::OUTSIDE:	return _find_first_simd<T, Kind::OUTSIDE>(samples, nsamples, low, high);
+	}
+	return 1;
+}
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+template <typename T>
+static bool _is_hit(const T x, const T previous, const Kind kind, const T low, const T high)
+{
+	switch (kind) {
+	case Kind::ABOVE:	return x > high;
+	case Kind::BELOW:	return x < low;
+	case Kind::RISING:	return x > high && !(previous > high);
+	case Kind::FALLING:	return x < low && !(previous < low);
+	case Kind::INSIDE:	return x >= low && x <= high;
+	case Kind::OUTSIDE:	return x < low || x > high;
+	}
+	return false;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// How a condition behaves on samples of type T.
+enum class Range {
+	/// Every sample hits.
+	ALWAYS,
+	/// No sample hits.
+	NEVER,
+	/// The levels clamped to the range of T give the same hits.
+	CLAMP
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+template <typename T>
+static Range _resolve_range(const Condition& condition)
+{
+	const std::int64_t	min = std::numeric_limits<T>::min();
+	const std::int64_t	max = std::numeric_limits<T>::max();
+	const bool			low_in = condition.low >= min && condition.low <= max;
+	const bool			high_in = condition.high >= min && condition.high <= max;
+	switch (condition.kind) {
+	case Kind::ABOVE:
+		return high_in ? Range::CLAMP : condition.high < min ? Range::ALWAYS : Range::NEVER;
+	case Kind::BELOW:
+		return low_in ? Range::CLAMP : condition.low > max ? Range::ALWAYS : Range::NEVER;
+	case Kind::RISING:
+		// Either every sample or none is above the level, thus no edge.
+		return high_in ? Range::CLAMP : Range::NEVER;
+	case Kind::FALLING:
+		return low_in ? Range::CLAMP : Range::NEVER;
+	case Kind::INSIDE:
+		return condition.low > max || condition.high < min ? Range::NEVER : Range::CLAMP;
+	case Kind::OUTSIDE:
+		return condition.low > max || condition.high < min ? Range::ALWAYS : Range::CLAMP;
+	}
+	return Range::CLAMP;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template <typename T>
+static std::size_t _find_first(const T* samples, const std::size_t nsamples, const T previous, const Condition& condition, const bool simd)
+{
+	if (nsamples == 0) {
+		return 0;
+	}
+	// Levels beyond the sample range hit every sample or none; the rest compare exactly after clamping.
+	switch (_resolve_range<T>(condition)) {
+	case Range::ALWAYS:	return 0;
+	case Range::NEVER:	return nsamples;
+	case Range::CLAMP:	break;
+	}
+	const T		low = static_cast<T>(std::clamp<std::int64_t>(condition.low, std::numeric_limits<T>::min(), std::numeric_limits<T>::max()));
+	const T		high = static_cast<T>(std::clamp<std::int64_t>(condition.high, std::numeric_limits<T>::min(), std::numeric_limits<T>::max()));
+	if (_is_hit(samples[0], previous, condition.kind, low, high)) {
+		return 0;
+	}
+
+	std::size_t	i = 1;
+#if defined(SMART_TRIGGER_SIMD)
+	if (simd) {
+		i = _find_first_simd<T>(samples, nsamples, condition.kind, low, high);
+	}
+#endif
+	for (; i < nsamples; ++i) {
+		if (_is_hit(samples[i], samples[i - 1], condition.kind, low, high)) {
+			return i;
+		}
+	}
+	return nsamples;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t findFirst(const std::int16_t* samples, const std::size_t nsamples, const std::int16_t previous, const Condition& condition)
+{
+	return _find_first(samples, nsamples, previous, condition, true);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t findFirst(const std::int32_t* samples, const std::size_t nsamples, const std::int32_t previous, const Condition& condition)
+{
+	return _find_first(samples, nsamples, previous, condition, true);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t findFirstScalar(const std::int16_t* samples, const std::size_t nsamples, const std::int16_t previous, const Condition& condition)
+{
+	return _find_first(samples, nsamples, previous, condition, false);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t findFirstScalar(const std::int32_t* samples, const std::size_t nsamples, const std::int32_t previous, const Condition& condition)
+{
+	return _find_first(samples, nsamples, previous, condition, false);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+const char* implementation()
+{
+#if defined(SMART_TRIGGER_SIMD)
+	return SIMD_NAME;
+#else
+	return "scalar";
+#endif
+}
+
+} // namespace Trigger
+} // namespace smart
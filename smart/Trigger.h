@@ -0,0 +1,100 @@
+/// \file  Trigger.h
+/// \brief	Declarations of the trigger condition search functions.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#pragma once
+
+#include <cstddef>	// std::size_t
+#include <cstdint>	// std::int16_t
+
+namespace smart {
+
+/// Search of trigger conditions in the samples of one channel.
+///
+/// The samples are signed integers, one channel per buffer, as delivered by Interleave::deinterleave.
+/// 16 and 32-bit samples are scanned with NEON, AVX2 or SSE2, whichever the compiler targets.
+namespace Trigger {
+
+/// Kind of a trigger condition.
+enum class Kind {
+	/// Sample above Condition::high.
+	ABOVE,
+	/// Sample below Condition::low.
+	BELOW,
+	/// Previous sample not above Condition::high, this one above.
+	RISING,
+	/// Previous sample not below Condition::low, this one below.
+	FALLING,
+	/// Sample within [Condition::low, Condition::high].
+	INSIDE,
+	/// Sample outside of [Condition::low, Condition::high].
+	OUTSIDE,
+};
+
+/// Trigger condition on one channel.
+struct Condition {
+	/// Kind of the condition.
+	Kind			kind;
+
+	/// Lower level, used by BELOW, FALLING and the windows.
+	std::int32_t	low;
+
+	/// Upper level, used by ABOVE, RISING and the windows.
+	std::int32_t	high;
+
+	static Condition above(const std::int32_t level)
+	{
+		return Condition{ Kind::ABOVE, level, level };
+	}
+
+	static Condition below(const std::int32_t level)
+	{
+		return Condition{ Kind::BELOW, level, level };
+	}
+
+	static Condition rising(const std::int32_t level)
+	{
+		return Condition{ Kind::RISING, level, level };
+	}
+
+	static Condition falling(const std::int32_t level)
+	{
+		return Condition{ Kind::FALLING, level, level };
+	}
+
+	static Condition inside(const std::int32_t low, const std::int32_t high)
+	{
+		return Condition{ Kind::INSIDE, low, high };
+	}
+
+	static Condition outside(const std::int32_t low, const std::int32_t high)
+	{
+		return Condition{ Kind::OUTSIDE, low, high };
+	}
+};
+
+/// Find the first sample meeting the condition.
+/// \param samples		Samples of one channel.
+/// \param nsamples		Number of samples.
+/// \param previous		Sample preceding samples[0], for the edge conditions.
+/// \param condition	Condition.
+/// \return Index of the first sample meeting the condition, \c nsamples if none.
+std::size_t findFirst(const std::int16_t* samples, const std::size_t nsamples, const std::int16_t previous, const Condition& condition);
+
+/// Find the first sample meeting the condition, 32-bit samples.
+std::size_t findFirst(const std::int32_t* samples, const std::size_t nsamples, const std::int32_t previous, const Condition& condition);
+
+/// Scalar reference implementation of #findFirst.
+std::size_t findFirstScalar(const std::int16_t* samples, const std::size_t nsamples, const std::int16_t previous, const Condition& condition);
+
+/// Scalar reference implementation of #findFirst, 32-bit samples.
+std::size_t findFirstScalar(const std::int32_t* samples, const std::size_t nsamples, const std::int32_t previous, const Condition& condition);
+
+/// Name of the vector instruction set used: "NEON", "AVX2", "SSE2" or "scalar".
+const char* implementation();
+
+} // namespace Trigger
+} // namespace smart
@@ -8,9 +8,11 @@
 #include "UioDevice.h"
 
 
+#include <algorithm>		// std::sort
 #include <cstdint>		// std::uintptr_t
 #include <memory>		// std::shared_ptr
 #include <limits>		// std::limits
+#include <set>			// std::set
 #include <stdexcept>	// std::runtime_error
 #include <string>		// std::string
 #include <vector>		// std::vector
@@ -104,10 +106,8 @@ static const char* const device_tree_roots[] = {
 	};
 
 // --------------------------------------------------------------------------------------------------------------------
-static void getIpCoreConfiguration(
-	std::map<std::string, std::vector<std::uint8_t>>&	configuration,
-	const std::string&									ipCoreName,
-	const std::uintptr_t								hwAddress)
+/// \return Directory of the device tree node of the IP core, empty when not found.
+static std::string findDeviceTreeNode(const std::uintptr_t hwAddress)
 {
 	const std::string	s_addr = ssprintf("@%08x", hwAddress);
 	for (unsigned int root_index=0; device_tree_roots[root_index]; ++root_index) {
@@ -116,20 +116,35 @@ static void getIpCoreConfiguration(
 			const auto dirs = Directory::getFiles(dtr);
 			for (const auto& sdir : dirs) {
 				if (ends_with(sdir, s_addr)) {
-					const auto ip_core_directory = Path::combine(dtr, sdir);
-					auto files = Directory::getFiles(ip_core_directory);
-					for (const auto& s : files) {
-						const std::string	filename = Path::combine(ip_core_directory, s);
-
-						std::vector<std::uint8_t>	bytes;
-						File::readAllBytes(bytes, filename);
-						configuration.insert(std::pair<std::string, std::vector<std::uint8_t>>(s, bytes));
-					}
-					return;
+					return Path::combine(dtr, sdir);
 				}
 			}
 		}
 	}
+	return std::string();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioDevice::readDeviceTreeNode(IpCoreConfigurationMap& configuration, const std::string& nodeDirectory)
+{
+	auto files = Directory::getFiles(nodeDirectory);
+	for (const auto& s : files) {
+		const std::string	filename = Path::combine(nodeDirectory, s);
+
+		std::vector<std::uint8_t>	bytes;
+		File::readAllBytes(bytes, filename);
+		configuration.insert(std::pair<std::string, std::vector<std::uint8_t>>(s, bytes));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::vector<std::string> UioDevice::deviceTreeRoots()
+{
+	std::vector<std::string>	r;
+	for (unsigned int root_index=0; device_tree_roots[root_index]; ++root_index) {
+		r.push_back(device_tree_roots[root_index]);
+	}
+	return r;
 }
 
 // -------------------------------------------------------------------------------------
@@ -200,7 +215,13 @@ MappedFile*
 UioDevice::getRequiredMap(unsigned int mapIndex)
 {
 	if (mapIndex < maps.size()) {
-		return maps[mapIndex].map;
+		UioMap&	map = maps[mapIndex];
+		if (map.map == nullptr) {
+			// Map N is at the offset N*pageSize() of the device file.
+			File&	file = _memoryFile ? *_memoryFile : *_file;
+			map.map = file.createMapping(mapIndex * MappedFile::pageSize(), map.size);
+		}
+		return map.map;
 	} else {
 		const auto n = maps.size();
 		switch (n) {
@@ -304,6 +325,50 @@ UioDevice::UioDevice(const char* device_name)
 	}
 }
 
+// -------------------------------------------------------------------------------------
+UioDevice::UioDevice(
+	const std::string&				device_name,
+	std::shared_ptr<File>			irq_file,
+	std::shared_ptr<File>			memory_file,
+	const std::vector<UioMap>&		device_maps,
+	const IpCoreConfigurationMap&	configuration)
+: index(UINT32_MAX),
+  name(device_name),
+  version("emulated"),
+  maps(device_maps),
+  ipCoreConfiguration(configuration),
+  _file(irq_file),
+  _memoryFile(memory_file),
+  _syncFd(-1),
+  _propertiesListed(false)
+{
+#if defined(WIN32)
+	throw std::runtime_error("UioDevice: Not implemented on WIN32");
+#else
+	for (auto& map : maps) {
+		map.map = nullptr;
+	}
+#endif
+}
+
+// -------------------------------------------------------------------------------------
+UioDevice::UioDevice(
+	const unsigned int				device_index,
+	const std::string&				device_name,
+	const std::string&				device_version,
+	const std::vector<UioMap>&		device_maps,
+	const std::string&				device_tree_node)
+: index(device_index),
+  name(device_name),
+  version(device_version),
+  maps(device_maps),
+  _syncFd(-1),
+  _deviceTreeNode(device_tree_node),
+  _propertiesListed(false)
+{
+	_open();
+}
+
 // -------------------------------------------------------------------------------------
 void UioDevice::_init(const unsigned int device_index, const char* device_name)
 {
@@ -313,8 +378,6 @@ void UioDevice::_init(const unsigned int device_index, const char* device_name)
 	char		device_dir[200];
 	char		maps_dir[256];
 	index = device_index;
-	_syncFd = -1;
-	_file = std::make_shared<File>(ssprintf("/dev/uio%u", device_index));
 
 	snprintf(device_dir, sizeof(device_dir), UIO_PATH_PREFIX "%u", device_index);
 	snprintf(maps_dir, sizeof(maps_dir), "%s/maps", device_dir);
@@ -330,7 +393,6 @@ void UioDevice::_init(const unsigned int device_index, const char* device_name)
 		if (dir2 == dir) {
 			UioMap	map;
 			read_map(map, device_dir, map_index);
-			map.map = _file->createMapping(map_index * MappedFile::pageSize(), map.size);
 			maps.push_back(map);
 			++map_index;
 		}
@@ -338,7 +400,23 @@ void UioDevice::_init(const unsigned int device_index, const char* device_name)
 			throw std::runtime_error(ssprintf("UioDevice %u: Expected map '%s', got map '%s'", map_index, dir2.c_str(), dir.c_str()));
 		}
 	}
-	getIpCoreConfiguration(ipCoreConfiguration, name, maps.size()==0 ? 0 : maps[0].addr);
+	_deviceTreeNode = findDeviceTreeNode(maps.size()==0 ? 0 : maps[0].addr);
+	_propertiesListed = false;
+	_open();
+#endif
+}
+
+// -------------------------------------------------------------------------------------
+void UioDevice::_open()
+{
+#if defined(WIN32)
+	throw std::runtime_error("UioDevice::_open: Not implemented on WIN32");
+#else
+	_syncFd = -1;
+	_file = std::make_shared<File>(ssprintf("/dev/uio%u", index));
+	for (auto& map : maps) {
+		map.map = nullptr;
+	}
 
 	// Check for non-coherent sync device name in device tree config
 	auto it = _find_config("sync-name");
@@ -377,6 +455,7 @@ void
 UioDevice::debug_print()
 {
 #if !defined(WIN32)
+	loadConfiguration();
 	fprintf(stderr, "uio%u: name=%s, version=%s\n", index, name.c_str(), version.c_str());
 	for (unsigned int i=0; i<maps.size(); ++i) {
 		const auto& map = maps[i];
@@ -402,24 +481,67 @@ UioDevice::UioDevice(const unsigned int device_index, const char* device_name)
 	_init(device_index, device_name);
 }
 
+// -------------------------------------------------------------------------------------
+void UioDevice::_listProperties()
+{
+	if (_propertiesListed) {
+		return;
+	}
+	_propertiesListed = true;
+	if (!_deviceTreeNode.empty()) {
+		for (const auto& s : Directory::getFiles(_deviceTreeNode)) {
+			_propertyFiles.insert(s);
+		}
+	}
+
+	// Sorted, so that the first "vendor,name" in the order of ipCoreConfiguration wins, as it always did.
+	std::set<std::string>	all_names(_propertyFiles.begin(), _propertyFiles.end());
+	for (const auto& kv : ipCoreConfiguration) {
+		all_names.insert(kv.first);
+	}
+	for (const auto& s : all_names) {
+		const auto comma_pos = s.find(',');
+		if (comma_pos != std::string::npos) {
+			_propertyAliases.emplace(s.substr(comma_pos+1), s);
+		}
+	}
+}
+
+// -------------------------------------------------------------------------------------
+void UioDevice::loadConfiguration()
+{
+	_listProperties();
+	for (const auto& s : _propertyFiles) {
+		_find_config(s);
+	}
+}
+
 // -------------------------------------------------------------------------------------
 UioDevice::IpCoreConfigurationMap::const_iterator
 UioDevice::_find_config(const std::string& name)
 {
 	auto it = ipCoreConfiguration.find(name);
-	if (it == ipCoreConfiguration.end()) {
-		for (auto ii=ipCoreConfiguration.begin(); ii!=ipCoreConfiguration.end(); ++ii) {
-			const auto comma_pos = ii->first.find(',');
-			if (comma_pos != std::string::npos) {
-				const auto name2 = ii->first.substr(comma_pos+1);
-				if (name2 == name) {
-					it = ii;
-					break;
-				}
-			}
+	if (it != ipCoreConfiguration.end()) {
+		return it;
+	}
+	_listProperties();
+
+	std::string	key = name;
+	if (_propertyFiles.count(key) == 0) {
+		const auto alias = _propertyAliases.find(name);
+		if (alias == _propertyAliases.end()) {
+			return ipCoreConfiguration.end();
+		}
+		key = alias->second;
+		it = ipCoreConfiguration.find(key);
+		if (it != ipCoreConfiguration.end() || _propertyFiles.count(key) == 0) {
+			return it;
 		}
 	}
-	return it;
+
+	std::vector<std::uint8_t>	bytes;
+	File::readAllBytes(bytes, Path::combine(_deviceTreeNode, key));
+	return ipCoreConfiguration.emplace(key, std::move(bytes)).first;
 }
 
 // -------------------------------------------------------------------------------------
@@ -477,6 +599,30 @@ bool UioDevice::syncBufferForCpu(std::uint64_t offset, std::uint64_t size)
 #endif
 }
 
+// -------------------------------------------------------------------------------------
+bool UioDevice::syncBufferRangesForCpu(SyncRange* ranges, const unsigned int count)
+{
+	if (!isNonCoherent()) {
+		return false;
+	}
+
+	// Invalidating a gap of less than a page is cheaper than an extra system call.
+	const std::uint64_t	max_gap = MappedFile::pageSize();
+	std::sort(ranges, ranges + count, [](const SyncRange& a, const SyncRange& b) { return a.offset < b.offset; });
+	unsigned int	i = 0;
+	while (i < count) {
+		std::uint64_t	begin = ranges[i].offset;
+		std::uint64_t	end = begin + ranges[i].size;
+		for (++i; i < count && ranges[i].offset <= end + max_gap; ++i) {
+			end = std::max(end, ranges[i].offset + ranges[i].size);
+		}
+		if (end > begin) {
+			syncBufferForCpu(begin, end - begin);
+		}
+	}
+	return true;
+}
+
 // -------------------------------------------------------------------------------------
 bool UioDevice::isNonCoherent() const
 {
@@ -11,6 +11,8 @@
 #include <map>				// std::map
 #include <memory>			// shared_ptr
 #include <string>			// std::string
+#include <unordered_map>	// std::unordered_map
+#include <unordered_set>	// std::unordered_set
 #include <vector>			// std::vector
 
 #include "File.h"			// File
@@ -32,11 +34,14 @@ public:
 	/// Size of the memory area.
 	std::uintptr_t	size;
 
-	/// Memory-mapped file.
+	/// Memory-mapped file; null until created by UioDevice::getRequiredMap.
 	MappedFile*	map;
 };
 
 /// Userspace IO device.
+///
+/// Maps are created on the first UioDevice::getRequiredMap and device tree properties are read on their first use,
+/// thus opening a device to access a single register reads neither all properties nor maps all memory.
 class UioDevice {
 public:
 	typedef std::map<std::string, std::vector<std::uint8_t>>	IpCoreConfigurationMap;
@@ -54,8 +59,12 @@ public:
 	std::vector<UioMap>	maps;
 
 	/// Configuration of the device as described in the device tree.
+	/// Holds the properties used so far; #loadConfiguration reads all of them.
 	IpCoreConfigurationMap	ipCoreConfiguration;
 
+	/// Read all properties of the device tree node into #ipCoreConfiguration.
+	void loadConfiguration();
+
 	/// Get a 32-bit unsigned integer from the IP Core configuration.
 	/// Throws an exception when not found.
 	std::uint32_t getConfigurationUInt32(const std::string& name);
@@ -73,7 +82,7 @@ public:
 	/// Get a string. Throws an exception when not found.
 	std::string getConfigurationString(const std::string& name);
 
-	/// Get map. Throw error if not found.
+	/// Get map, mapping it on first use. Throw error if not found.
 	MappedFile* getRequiredMap(unsigned int mapIndex);
 
 	/// Get the device filehandle for handling IRQ-s.
@@ -86,6 +95,22 @@ public:
 	/// @return true if sync was performed, false if not needed (coherent buffer)
 	bool syncBufferForCpu(std::uint64_t offset = 0, std::uint64_t size = 0);
 
+	/// Byte range of the DMA buffer.
+	struct SyncRange {
+		/// Offset within the buffer.
+		std::uint64_t	offset;
+		/// Size of the range, in bytes.
+		std::uint64_t	size;
+	};
+
+	/// Synchronize several ranges of the buffer for CPU access.
+	/// The ranges are sorted, and ranges that overlap, touch or are separated by less than a page are merged,
+	/// so that e.g. many small pieces of newly arrived data cost a single ioctl.
+	/// @param ranges Ranges to be synchronized; reordered in place.
+	/// @param count Number of ranges.
+	/// @return true if sync was performed, false if not needed (coherent buffer)
+	bool syncBufferRangesForCpu(SyncRange* ranges, const unsigned int count);
+
 	/// Check if this device uses non-coherent DMA.
 	bool isNonCoherent() const;
 public:
@@ -95,12 +120,48 @@ public:
 	/// Open an UIO device of a given name.
 	UioDevice(const char* device_name);
 
+	/// Create a device that is not backed by the UIO driver, e.g. an emulated IP core.
+	/// \param device_name		Name of the device.
+	/// \param irq_file			File following the UIO interrupt protocol: writing a 32-bit 1 enables the interrupt,
+	///							reading returns the 32-bit interrupt count. Null when there is no interrupt.
+	/// \param memory_file		File holding the memory of the maps; map N is mapped from the offset N*pageSize(),
+	///							the same way as with the UIO driver.
+	/// \param device_maps		Maps of the device; the fields map are filled in on use.
+	/// \param configuration	Configuration, as if read from the device tree.
+	UioDevice(
+		const std::string&				device_name,
+		std::shared_ptr<File>			irq_file,
+		std::shared_ptr<File>			memory_file,
+		const std::vector<UioMap>&		device_maps,
+		const IpCoreConfigurationMap&	configuration);
+
+	/// Open an UIO device described beforehand, e.g. by UioRegistry; sysfs and the device tree are not read.
+	/// \param device_index	Index N of the device file /dev/uioN.
+	/// \param device_name		Name of the device.
+	/// \param device_version	Version of the device.
+	/// \param device_maps		Maps of the device; the fields map are filled in on use.
+	/// \param device_tree_node	Directory of the device tree node, empty when there is none.
+	UioDevice(
+		const unsigned int				device_index,
+		const std::string&				device_name,
+		const std::string&				device_version,
+		const std::vector<UioMap>&		device_maps,
+		const std::string&				device_tree_node);
+
 	/// Destructor.
 	~UioDevice();
 
 	/// Is the device present?
 	static bool isDevicePresent(const unsigned int device_index);
 
+	/// Directories searched for the device tree node of a device, whose name ends with @<address of map 0>.
+	static std::vector<std::string> deviceTreeRoots();
+
+	/// Read all properties of a device tree node.
+	/// \param configuration	Properties are added here.
+	/// \param nodeDirectory	Directory of the node.
+	static void readDeviceTreeNode(IpCoreConfigurationMap& configuration, const std::string& nodeDirectory);
+
 	/// Print device information to stderr.
 	void debug_print();
 
@@ -111,11 +172,24 @@ private:
 	/// Initialize the UIO device.
 	void _init(const unsigned int device_index, const char* device_name);
 
+	/// Open the device file; index, maps and the device tree node are set.
+	void _open();
+
+	/// List the properties of the device tree node and index them by name without vendor prefix, once.
+	void _listProperties();
+
 	std::shared_ptr<File>	_file;
+	std::shared_ptr<File>	_memoryFile;	///< Memory of the maps when not the same as _file.
 	int			_syncFd;	///< File descriptor for /dev/<sync-name>, -1 if not available
 
-	/// Get the iterator to the configuration of the device as described in the device tree.
-	/// Note: this doesn't throw exceptions.
+	std::string		_deviceTreeNode;	///< Directory of the device tree node, empty when there is none.
+	bool			_propertiesListed;	///< Have _propertyFiles and _propertyAliases been filled?
+	std::unordered_set<std::string>					_propertyFiles;		///< Properties in the device tree node.
+	std::unordered_map<std::string, std::string>	_propertyAliases;	///< "name" to "vendor,name".
+
+	/// Get the iterator to the configuration of the device as described in the device tree,
+	/// reading the property on first use; "name" also finds "vendor,name".
+	/// Note: this throws only when a property file cannot be read.
 	IpCoreConfigurationMap::const_iterator	_find_config(const std::string& name);
 
 	/// Get a 32-bit unsigned integer from the IP Core configuration.
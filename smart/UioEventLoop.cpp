@@ -0,0 +1,231 @@
+/// \file  UioEventLoop.cpp
+/// \brief	Implementation of the class UioEventLoop.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#include <stdexcept>		// std::runtime_error
+
+#include <errno.h>			// errno
+#include <pthread.h>		// pthread_setaffinity_np
+#include <sched.h>			// cpu_set_t
+#include <string.h>			// strerror
+#include <sys/epoll.h>		// epoll_create1
+#include <sys/eventfd.h>	// eventfd
+#include <unistd.h>			// read, write, close
+
+#include "string.h"			// ssprintf
+
+#include "UioEventLoop.h"	// ourselves.
+
+namespace smart {
+
+/// Events handled per epoll_wait call.
+static constexpr int	MAX_EVENTS = 16;
+
+// --------------------------------------------------------------------------------------------------------------------
+UioEventLoop::UioEventLoop()
+: _epollFd(-1),
+  _stopFd(-1),
+  _cpu(-1),
+  _stopping(false),
+  _interrupts(0),
+  _missed(0)
+{
+	_epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (_epollFd < 0) {
+		throw std::runtime_error(ssprintf("UioEventLoop: epoll_create1 failed: %s", strerror(errno)));
+	}
+	_stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (_stopFd < 0) {
+		close(_epollFd);
+		throw std::runtime_error(ssprintf("UioEventLoop: eventfd failed: %s", strerror(errno)));
+	}
+	struct epoll_event	ev = {};
+	ev.events = EPOLLIN;
+	ev.data.fd = _stopFd;
+	if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, _stopFd, &ev) != 0) {
+		close(_stopFd);
+		close(_epollFd);
+		throw std::runtime_error(ssprintf("UioEventLoop: epoll_ctl failed: %s", strerror(errno)));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+UioEventLoop::~UioEventLoop()
+{
+	close(_stopFd);
+	close(_epollFd);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioEventLoop::_register(const int fd, std::shared_ptr<Source> source, const std::uint32_t events)
+{
+	if (fd < 0) {
+		throw std::runtime_error("UioEventLoop: invalid file descriptor");
+	}
+	if (_sources.count(fd) > 0) {
+		throw std::runtime_error(ssprintf("UioEventLoop: file descriptor %d already registered", fd));
+	}
+	struct epoll_event	ev = {};
+	ev.events = events;
+	ev.data.fd = fd;
+	if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+		throw std::runtime_error(ssprintf("UioEventLoop: epoll_ctl(%d) failed: %s", fd, strerror(errno)));
+	}
+	_sources[fd] = source;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioEventLoop::add(UioDevice& device, InterruptHandler handler)
+{
+	const int	fd = device.getFileHandle();
+	if (fd == File::NullHandle) {
+		throw std::runtime_error(ssprintf("UioEventLoop: device %s has no interrupt", device.name.c_str()));
+	}
+	auto	source = std::make_shared<Source>();
+	source->device = &device;
+	source->interrupt_handler = handler;
+	source->has_count = false;
+	source->last_count = 0;
+	_register(fd, source, EPOLLIN);
+	_unmask(fd);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioEventLoop::addFile(const int fd, FileHandler handler, const std::uint32_t events)
+{
+	auto	source = std::make_shared<Source>();
+	source->device = nullptr;
+	source->file_handler = handler;
+	source->has_count = false;
+	source->last_count = 0;
+	_register(fd, source, events);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioEventLoop::addFile(const int fd, FileHandler handler)
+{
+	addFile(fd, handler, EPOLLIN);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioEventLoop::remove(UioDevice& device)
+{
+	removeFile(device.getFileHandle());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioEventLoop::removeFile(const int fd)
+{
+	if (_sources.erase(fd) > 0) {
+		epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioEventLoop::_unmask(const int fd)
+{
+	const std::uint32_t	unmask = 1;
+	if (write(fd, &unmask, sizeof(unmask)) != sizeof(unmask)) {
+		throw std::runtime_error(ssprintf("UioEventLoop: cannot enable the interrupt: %s", strerror(errno)));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioEventLoop::_dispatchInterrupt(const int fd, Source& source)
+{
+	std::uint32_t	count;
+	if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+		if (errno == EAGAIN || errno == EINTR) {
+			return;
+		}
+		throw std::runtime_error(ssprintf("UioEventLoop: cannot read the interrupt count of %s: %s", source.device->name.c_str(), strerror(errno)));
+	}
+
+	// The counter wraps around, the difference doesn't.
+	const std::uint32_t	delta = source.has_count ? count - source.last_count : 1u;
+	const std::uint32_t	missed = delta > 1 ? delta - 1 : 0;
+	source.has_count = true;
+	source.last_count = count;
+	_interrupts.fetch_add(1, std::memory_order_relaxed);
+	_missed.fetch_add(missed, std::memory_order_relaxed);
+
+	// Keep a reference: the handler may remove the device.
+	const InterruptHandler	handler = source.interrupt_handler;
+	try {
+		handler(Interrupt{ source.device, count, missed });
+	} catch (...) {
+		_unmask(fd);
+		throw;
+	}
+	_unmask(fd);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+unsigned int UioEventLoop::runOnce(const int timeout_ms)
+{
+	struct epoll_event	events[MAX_EVENTS];
+	const int	nevents = epoll_wait(_epollFd, events, MAX_EVENTS, timeout_ms);
+	if (nevents < 0) {
+		if (errno == EINTR) {
+			return 0;
+		}
+		throw std::runtime_error(ssprintf("UioEventLoop: epoll_wait failed: %s", strerror(errno)));
+	}
+
+	unsigned int	ndispatched = 0;
+	for (int i=0; i<nevents; ++i) {
+		const int	fd = events[i].data.fd;
+		if (fd == _stopFd) {
+			std::uint64_t	n;
+			if (read(_stopFd, &n, sizeof(n)) < 0) {
+				// Already drained.
+			}
+			continue;
+		}
+		// A handler may have removed a source reported in the same round.
+		const auto	it = _sources.find(fd);
+		if (it == _sources.end()) {
+			continue;
+		}
+		const std::shared_ptr<Source>	source = it->second;
+		if (source->device != nullptr) {
+			_dispatchInterrupt(fd, *source);
+		} else {
+			source->file_handler(events[i].events);
+		}
+		++ndispatched;
+	}
+	return ndispatched;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioEventLoop::run()
+{
+	if (_cpu >= 0) {
+		cpu_set_t	cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(_cpu, &cpus);
+		const int	r = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+		if (r != 0) {
+			throw std::runtime_error(ssprintf("UioEventLoop: cannot pin to CPU %d: %s", _cpu, strerror(r)));
+		}
+	}
+	while (!_stopping.exchange(false)) {
+		runOnce(-1);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioEventLoop::stop()
+{
+	_stopping = true;
+	const std::uint64_t	one = 1;
+	if (write(_stopFd, &one, sizeof(one)) != sizeof(one)) {
+		throw std::runtime_error(ssprintf("UioEventLoop::stop: write failed: %s", strerror(errno)));
+	}
+}
+
+} // namespace smart
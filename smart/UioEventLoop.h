@@ -0,0 +1,142 @@
+/// \file  UioEventLoop.h
+/// \brief	Interface of the class UioEventLoop.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#pragma once
+
+#include <atomic>			// std::atomic
+#include <cstdint>			// std::uint32_t
+#include <functional>		// std::function
+#include <map>				// std::map
+#include <memory>			// std::shared_ptr
+
+#include "UioDevice.h"		// UioDevice
+
+namespace smart {
+
+/// Interrupt dispatcher for any number of UIO devices, on a single epoll file descriptor.
+///
+/// For every interrupt the loop reads the interrupt count, calls the handler of the device and then
+/// enables the interrupt again. The handler runs while the interrupt is still disabled, thus a level-triggered
+/// source serviced by the handler cannot fire again in between, and an interrupt arriving after the enable
+/// wakes up the loop. Counts advancing by more than one are reported as missed interrupts.
+///
+/// Other file descriptors, e.g. sockets or the standard input, can be served by the same loop.
+///
+/// Example:
+/// @code
+///	UioEventLoop	loop;
+///	loop.add(uart, [&](const UioEventLoop::Interrupt& irq) { drain_rx(uart); });
+///	loop.add(capture, [&](const UioEventLoop::Interrupt& irq) { fetch(capture); });
+///	loop.run();
+/// @endcode
+class UioEventLoop {
+public:
+	/// Interrupt delivered to a handler.
+	struct Interrupt {
+		/// The device.
+		UioDevice*		device;
+
+		/// Interrupt count reported by the driver.
+		std::uint32_t	count;
+
+		/// Interrupts since the previous delivery that were not delivered on their own.
+		std::uint32_t	missed;
+	};
+
+	typedef std::function<void(const Interrupt&)>	InterruptHandler;
+
+	/// Handler of a file descriptor, gets the epoll events.
+	typedef std::function<void(std::uint32_t)>		FileHandler;
+
+	/// Create an empty loop.
+	UioEventLoop();
+
+	/// Destructor. The devices are left as they are.
+	~UioEventLoop();
+
+	UioEventLoop(const UioEventLoop&) = delete;
+	UioEventLoop& operator=(const UioEventLoop&) = delete;
+
+	/// Serve the interrupts of a device, which is not owned and has to outlive its registration.
+	/// The interrupt is enabled right away.
+	void add(UioDevice& device, InterruptHandler handler);
+
+	/// Serve a file descriptor when it is readable.
+	/// \param fd		File descriptor, not owned.
+	/// \param handler	Handler.
+	/// \param events	epoll events to wait for.
+	void addFile(const int fd, FileHandler handler, const std::uint32_t events);
+
+	/// Serve a file descriptor when it is readable.
+	void addFile(const int fd, FileHandler handler);
+
+	/// Stop serving a device.
+	void remove(UioDevice& device);
+
+	/// Stop serving a file descriptor.
+	void removeFile(const int fd);
+
+	/// Pin the thread calling #run to a CPU core; -1, the default, leaves the affinity alone.
+	void setCpu(const int cpu)
+	{
+		_cpu = cpu;
+	}
+
+	/// Wait for events and dispatch them.
+	/// \param timeout_ms	Maximum time to wait, -1 for no limit.
+	/// \return Number of events dispatched.
+	unsigned int runOnce(const int timeout_ms);
+
+	/// Dispatch events until #stop is called.
+	void run();
+
+	/// Make #run return. Can be called from any thread and from the handlers.
+	void stop();
+
+	/// Interrupts delivered so far.
+	std::uint64_t getInterruptCount() const
+	{
+		return _interrupts.load(std::memory_order_relaxed);
+	}
+
+	/// Missed interrupts so far, see Interrupt::missed.
+	std::uint64_t getMissedCount() const
+	{
+		return _missed.load(std::memory_order_relaxed);
+	}
+private:
+	/// Registered file descriptor.
+	struct Source {
+		/// Device, null for plain files.
+		UioDevice*			device;
+		InterruptHandler	interrupt_handler;
+		FileHandler			file_handler;
+
+		/// Has the interrupt count been read yet?
+		bool				has_count;
+		std::uint32_t		last_count;
+	};
+
+	int									_epollFd;
+	int									_stopFd;
+	int									_cpu;
+	std::atomic<bool>					_stopping;
+	std::map<int, std::shared_ptr<Source>>	_sources;
+
+	std::atomic<std::uint64_t>			_interrupts;
+	std::atomic<std::uint64_t>			_missed;
+
+	void _register(const int fd, std::shared_ptr<Source> source, const std::uint32_t events);
+
+	/// Read the count, call the handler and enable the interrupt again.
+	void _dispatchInterrupt(const int fd, Source& source);
+
+	/// Enable the interrupt of a device.
+	static void _unmask(const int fd);
+}; // class UioEventLoop
+
+} // namespace smart
@@ -0,0 +1,275 @@
+/// \file  UioRegistry.cpp
+/// \brief	Implementation of the class UioRegistry.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#include <cstdlib>			// strtoull
+#include <stdexcept>		// std::runtime_error
+
+#include <ctype.h>			// isspace, tolower
+#include <errno.h>			// errno
+#include <limits.h>			// NAME_MAX
+#include <string.h>			// strerror, strncmp
+#include <sys/inotify.h>	// inotify_init1
+#include <unistd.h>			// read, close
+
+#include "Directory.h"		// Directory::getFiles
+#include "File.h"			// File::readAllText
+#include "Path.h"			// Path::combine
+#include "string.h"			// ssprintf
+
+#include "UioRegistry.h"	// ourselves.
+
+namespace smart {
+
+// --------------------------------------------------------------------------------------------------------------------
+static std::string read_text(const std::string& directory, const char* filename)
+{
+	auto	s = File::readAllText(Path::combine(directory, filename));
+	while (s.size()>0 && isspace(s[s.size()-1])) {
+		s.resize(s.size()-1);
+	}
+	return s;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+static std::string lowercase(const std::string& s)
+{
+	std::string	r(s);
+	for (auto& c : r) {
+		c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+	}
+	return r;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Index N of a name uioN.
+static bool index_of_uio(const char* s, unsigned int& device_index)
+{
+	return strncmp(s, "uio", 3) == 0 && s[3] != 0 && uint_of(s + 3, device_index);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+UioRegistry::UioRegistry()
+: UioRegistry(Options())
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+UioRegistry::UioRegistry(const Options& options)
+: _options(options),
+  _watchFd(-1)
+{
+	refresh();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+UioRegistry::~UioRegistry()
+{
+	if (_watchFd >= 0) {
+		close(_watchFd);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void UioRegistry::refresh()
+{
+	// Device tree nodes by address; the first root wins, as in UioDevice.
+	std::map<std::uintptr_t, std::string>	nodes;
+	for (const auto& root : _options.device_tree_roots) {
+		if (!File::exists(root.c_str())) {
+			continue;
+		}
+		for (const auto& node : Directory::getFiles(root)) {
+			const auto	at = node.rfind('@');
+			if (at == std::string::npos || at + 1 == node.size()) {
+				continue;
+			}
+			char*					end = nullptr;
+			const std::uintptr_t	address = std::strtoull(node.c_str() + at + 1, &end, 16);
+			if (*end == 0) {
+				nodes.insert(std::make_pair(address, Path::combine(root, node)));
+			}
+		}
+	}
+
+	std::map<unsigned int, std::shared_ptr<const Entry>>	by_index;
+	std::unordered_map<std::string, std::shared_ptr<const Entry>>	by_name;
+	std::unordered_map<std::uintptr_t, std::shared_ptr<const Entry>>	by_address;
+	if (File::exists(_options.sysfs_directory.c_str())) {
+		for (const auto& device : Directory::getFiles(_options.sysfs_directory)) {
+			unsigned int	device_index;
+			if (!index_of_uio(device.c_str(), device_index)) {
+				continue;
+			}
+			const std::string	device_dir = Path::combine(_options.sysfs_directory, device);
+			auto	entry = std::make_shared<Entry>();
+			entry->index = device_index;
+			entry->name = read_text(device_dir, "name");
+			entry->version = read_text(device_dir, "version");
+
+			// Maps are numbered from 0 without gaps.
+			const std::string	maps_dir = Path::combine(device_dir, "maps");
+			for (unsigned int map_index=0; ; ++map_index) {
+				const std::string	map_dir = Path::combine(maps_dir, ssprintf("map%u", map_index));
+				if (!File::exists(map_dir.c_str())) {
+					break;
+				}
+				UioMap	map;
+				map.addr = uint_of(read_text(map_dir, "addr"));
+				map.name = read_text(map_dir, "name");
+				map.offset = uint_of(read_text(map_dir, "offset"));
+				map.size = uint_of(read_text(map_dir, "size"));
+				map.map = nullptr;
+				entry->maps.push_back(map);
+			}
+
+			if (entry->maps.size() > 0) {
+				const auto	node = nodes.find(entry->maps[0].addr);
+				if (node != nodes.end()) {
+					entry->device_tree_node = node->second;
+				}
+			}
+
+			by_index[device_index] = entry;
+			// The lowest index wins on duplicate names, as in UioDevice(const char*).
+			by_name.insert(std::make_pair(lowercase(entry->name), entry));
+			for (const auto& map : entry->maps) {
+				by_address.insert(std::make_pair(map.addr, entry));
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex>	lock(_mutex);
+	_byIndex.swap(by_index);
+	_byName.swap(by_name);
+	_byAddress.swap(by_address);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<const UioRegistry::Entry> UioRegistry::find(const char* device_name) const
+{
+	unsigned int	device_index;
+	if (uint_of(device_name, device_index)) {
+		return findByIndex(device_index);
+	}
+	if (strncmp(device_name, "/dev/", 5) == 0 && index_of_uio(device_name + 5, device_index)) {
+		return findByIndex(device_index);
+	}
+	if (index_of_uio(device_name, device_index)) {
+		return findByIndex(device_index);
+	}
+	return findByName(device_name);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<const UioRegistry::Entry> UioRegistry::findByName(const std::string& device_name) const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	const auto	it = _byName.find(lowercase(device_name));
+	return it == _byName.end() ? nullptr : it->second;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<const UioRegistry::Entry> UioRegistry::findByIndex(const unsigned int device_index) const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	const auto	it = _byIndex.find(device_index);
+	return it == _byIndex.end() ? nullptr : it->second;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<const UioRegistry::Entry> UioRegistry::findByAddress(const std::uintptr_t address) const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	const auto	it = _byAddress.find(address);
+	return it == _byAddress.end() ? nullptr : it->second;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::vector<std::shared_ptr<const UioRegistry::Entry>> UioRegistry::getEntries() const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	std::vector<std::shared_ptr<const Entry>>	r;
+	r.reserve(_byIndex.size());
+	for (const auto& it : _byIndex) {
+		r.push_back(it.second);
+	}
+	return r;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<UioDevice> UioRegistry::open(const char* device_name) const
+{
+	const auto	entry = find(device_name);
+	if (!entry) {
+		throw std::runtime_error(ssprintf("UioRegistry: Device '%s' not found", device_name));
+	}
+	return open(*entry);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<UioDevice> UioRegistry::open(const Entry& entry) const
+{
+	return std::make_shared<UioDevice>(entry.index, entry.name, entry.version, entry.maps, entry.device_tree_node);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+int UioRegistry::watch()
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	if (_watchFd >= 0) {
+		return _watchFd;
+	}
+	// sysfs does not report changes through inotify; devtmpfs does.
+	const int	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0) {
+		throw std::runtime_error(ssprintf("UioRegistry: inotify_init1 failed: %s", strerror(errno)));
+	}
+	if (inotify_add_watch(fd, _options.dev_directory.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) < 0) {
+		const int	error = errno;
+		close(fd);
+		throw std::runtime_error(ssprintf("UioRegistry: cannot watch %s: %s", _options.dev_directory.c_str(), strerror(error)));
+	}
+	_watchFd = fd;
+	return fd;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+bool UioRegistry::update()
+{
+	bool	changed = false;
+	{
+		// Not held by refresh(), which takes the lock itself.
+		std::lock_guard<std::mutex>	lock(_mutex);
+		if (_watchFd < 0) {
+			return false;
+		}
+		alignas(struct inotify_event) char	buffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+		for (;;) {
+			const ssize_t	n = read(_watchFd, buffer, sizeof(buffer));
+			if (n <= 0) {
+				if (n < 0 && errno == EINTR) {
+					continue;
+				}
+				break;
+			}
+			for (ssize_t pos = 0; pos < n; ) {
+				const auto*		ev = reinterpret_cast<const struct inotify_event*>(buffer + pos);
+				unsigned int	device_index;
+				if (ev->len > 0 && index_of_uio(ev->name, device_index)) {
+					changed = true;
+				}
+				pos += sizeof(struct inotify_event) + ev->len;
+			}
+		}
+	}
+	if (changed) {
+		refresh();
+	}
+	return changed;
+}
+
+} // namespace smart
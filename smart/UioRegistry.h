@@ -0,0 +1,129 @@
+/// \file  UioRegistry.h
+/// \brief	Interface of the class UioRegistry.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#pragma once
+
+#include <cstdint>			// std::uintptr_t
+#include <map>				// std::map
+#include <memory>			// std::shared_ptr
+#include <mutex>			// std::mutex
+#include <string>			// std::string
+#include <unordered_map>	// std::unordered_map
+#include <vector>			// std::vector
+
+#include "UioDevice.h"		// UioDevice
+
+namespace smart {
+
+/// Index of all UIO devices, built in one pass over sysfs and the device tree.
+///
+/// Opening a device by name with UioDevice(const char*) reads the name of every device up to the one wanted
+/// and lists the device tree roots again for every device. The registry reads every device and its maps once,
+/// lists each device tree root once and then looks devices up by name, index or address without touching
+/// the file system. Devices are opened from the index and read their device tree properties on use.
+///
+/// The index is refreshed on demand by #refresh, or by #update when device nodes appear or vanish in /dev,
+/// see #watch. All methods can be called from any thread.
+///
+/// Example:
+/// @code
+///	UioRegistry		registry;
+///	auto			capture = registry.open("AXI-Data-Capture");
+///	auto			gpio = registry.open("gpio");
+/// @endcode
+class UioRegistry {
+public:
+	/// Where to look for the devices.
+	struct Options {
+		/// sysfs class directory of the UIO devices.
+		std::string					sysfs_directory = "/sys/class/uio";
+
+		/// Directories holding the device tree nodes, searched in this order.
+		std::vector<std::string>	device_tree_roots = UioDevice::deviceTreeRoots();
+
+		/// Directory of the device files, watched by #watch.
+		std::string					dev_directory = "/dev";
+	};
+
+	/// Indexed device.
+	struct Entry {
+		/// Index N of /dev/uioN.
+		unsigned int			index;
+
+		/// Name of the device.
+		std::string				name;
+
+		/// Version of the device.
+		std::string				version;
+
+		/// Maps of the device; the fields map are null.
+		std::vector<UioMap>		maps;
+
+		/// Directory of the device tree node, empty when there is none.
+		std::string				device_tree_node;
+	};
+
+	/// Index the devices at the default locations.
+	UioRegistry();
+
+	/// Index the devices at the given locations.
+	explicit UioRegistry(const Options& options);
+
+	/// Destructor.
+	~UioRegistry();
+
+	UioRegistry(const UioRegistry&) = delete;
+	UioRegistry& operator=(const UioRegistry&) = delete;
+
+	/// Scan sysfs and the device tree again.
+	void refresh();
+
+	/// Find a device the way UioDevice(const char*) does: by index N, uioN, /dev/uioN or name, ignoring case.
+	/// \return The device, null when not found.
+	std::shared_ptr<const Entry> find(const char* device_name) const;
+
+	/// Find a device by name, ignoring case.
+	std::shared_ptr<const Entry> findByName(const std::string& device_name) const;
+
+	/// Find a device by index.
+	std::shared_ptr<const Entry> findByIndex(const unsigned int device_index) const;
+
+	/// Find a device by the hardware address of one of its maps.
+	std::shared_ptr<const Entry> findByAddress(const std::uintptr_t address) const;
+
+	/// All devices, by index.
+	std::vector<std::shared_ptr<const Entry>> getEntries() const;
+
+	/// Open a device found by #find. Throws when not found.
+	std::shared_ptr<UioDevice> open(const char* device_name) const;
+
+	/// Open an indexed device.
+	std::shared_ptr<UioDevice> open(const Entry& entry) const;
+
+	/// Watch the device directory for UIO devices appearing or vanishing.
+	/// \return File descriptor that becomes readable on changes, e.g. for UioEventLoop::addFile; owned by the registry.
+	int watch();
+
+	/// Consume the pending changes reported by #watch, without blocking; refresh when a UIO device changed.
+	/// \return true when the index was refreshed.
+	bool update();
+private:
+	const Options												_options;
+
+	/// Guards the index and _watchFd.
+	mutable std::mutex											_mutex;
+
+	/// The index.
+	std::map<unsigned int, std::shared_ptr<const Entry>>		_byIndex;
+	std::unordered_map<std::string, std::shared_ptr<const Entry>>	_byName;
+	std::unordered_map<std::uintptr_t, std::shared_ptr<const Entry>>	_byAddress;
+
+	/// inotify file descriptor, -1 when not watching.
+	int															_watchFd;
+}; // class UioRegistry
+
+} // namespace smart
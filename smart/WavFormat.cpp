@@ -231,5 +231,71 @@ void makeHeader(
 	memcpy(&buffer[0], &header, sizeof(header));
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+/// Append a little-endian integer of the given size to the buffer.
+static void _put_le(std::vector<uint8_t>& buffer, const uint64_t value, const unsigned int size)
+{
+	for (unsigned int i=0; i<size; ++i) {
+		buffer.push_back(static_cast<uint8_t>(value >> (8 * i)));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Append a chunk header to the buffer.
+static void _put_chunk_header(std::vector<uint8_t>& buffer, const char* magic, const uint32_t size)
+{
+	_put_le(buffer, UINT32_OF_TEXT(magic), sizeof(uint32_t));
+	_put_le(buffer, size, sizeof(uint32_t));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void makeStreamHeader(
+		std::vector<uint8_t> &buffer,
+		const unsigned int	nchannels,
+		const unsigned int	bits_per_sample,
+		const unsigned int	sample_rate,
+		const std::uint64_t	data_block_size,
+		const unsigned int	header_size)
+{
+	// RIFF layout: RIFF/WAVE, fmt, JUNK, data.
+	// RF64 layout: RF64/WAVE, ds64, fmt, JUNK, data; the JUNK chunk shrinks by the size of the ds64 chunk.
+	constexpr unsigned int	DS64_CHUNK_SIZE = sizeof(RiffFieldHeader) + 28;
+	const uint64_t			pad = data_block_size & 1u;
+	const uint64_t			riff_size = header_size - 8u + data_block_size + pad;
+	const bool				rf64 = riff_size > UINT32_MAX;
+
+	if (header_size < STREAM_HEADER_MIN_SIZE) {
+		throw std::runtime_error(ssprintf("makeStreamHeader: header size %u is less than %u", header_size, STREAM_HEADER_MIN_SIZE));
+	}
+	const unsigned int	junk_size = header_size - sizeof(RiffHeader) - sizeof(WaveFormatEx) - sizeof(RiffDataHeader) - (rf64 ? DS64_CHUNK_SIZE : 0u);
+	if (junk_size > 0u && junk_size < sizeof(RiffFieldHeader)) {
+		throw std::runtime_error(ssprintf("makeStreamHeader: header size %u leaves no room for padding", header_size));
+	}
+
+	WavFileHeader		header;
+	fillHeader(header, nchannels, bits_per_sample, sample_rate, 0);
+
+	buffer.clear();
+	buffer.reserve(header_size);
+	_put_chunk_header(buffer, rf64 ? "RF64" : "RIFF", rf64 ? UINT32_MAX : static_cast<uint32_t>(riff_size));
+	_put_le(buffer, UINT32_OF_TEXT("WAVE"), sizeof(uint32_t));
+	if (rf64) {
+		const unsigned int	bytes_per_frame = header.fmt.nBlockAlign;
+		_put_chunk_header(buffer, "ds64", DS64_CHUNK_SIZE - sizeof(RiffFieldHeader));
+		_put_le(buffer, riff_size, sizeof(uint64_t));
+		_put_le(buffer, data_block_size, sizeof(uint64_t));
+		_put_le(buffer, bytes_per_frame > 0 ? data_block_size / bytes_per_frame : 0, sizeof(uint64_t));
+		_put_le(buffer, 0, sizeof(uint32_t));	// No table.
+	}
+	_put_chunk_header(buffer, "fmt ", sizeof(WaveFormatEx));
+	const uint8_t*	fmt = reinterpret_cast<const uint8_t*>(&header.fmt);
+	buffer.insert(buffer.end(), fmt, fmt + sizeof(WaveFormatEx));
+	if (junk_size > 0u) {
+		_put_chunk_header(buffer, "JUNK", junk_size - sizeof(RiffFieldHeader));
+		buffer.resize(buffer.size() + junk_size - sizeof(RiffFieldHeader), 0u);
+	}
+	_put_chunk_header(buffer, "data", rf64 ? UINT32_MAX : static_cast<uint32_t>(data_block_size));
+}
+
 } // namespace WavFormat
 } // namesapce smart
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstdint>	// std::uint64_t
 #include <string>	// std::string
 #include <stdio.h>	// FILE*
 #include <vector>		// std::vector
@@ -66,5 +67,26 @@ void makeHeader(
 	const unsigned int	sample_rate,
 	const unsigned int	data_block_size);
 
+/// Smallest header produced by makeStreamHeader, in bytes.
+constexpr unsigned int STREAM_HEADER_MIN_SIZE = 80;
+
+/// Write a fixed-size WAV header for a file that is written while the data size is not known yet.
+/// The header is padded with a JUNK chunk to exactly \c header_size bytes, so that the sample data
+/// starts at an aligned file offset and the header can be rewritten in place with the final size.
+/// When the file would exceed 4 GiB the header is an RF64 header with a ds64 chunk instead.
+/// @param buffer Output buffer, resized to \c header_size.
+/// @param nchannels Number of channels.
+/// @param bits_per_sample Bits per sample.
+/// @param sample_rate Sample rate, in Hz.
+/// @param data_block_size Total number of bytes of the samples, 0 if not known yet.
+/// @param header_size Size of the header, at least #STREAM_HEADER_MIN_SIZE.
+void makeStreamHeader(
+	std::vector<uint8_t> &buffer,
+	const unsigned int	nchannels,
+	const unsigned int	bits_per_sample,
+	const unsigned int	sample_rate,
+	const std::uint64_t	data_block_size,
+	const unsigned int	header_size);
+
 } // namespace WavFormat
 } // namespace smart
@@ -0,0 +1,56 @@
+/// \file  futex.cpp
+/// \brief	Definitions of the futex functions.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#include <algorithm>		// std::min
+#include <thread>			// std::this_thread::sleep_for
+
+#if defined(__linux__)
+#include <linux/futex.h>	// FUTEX_WAIT, FUTEX_WAKE
+#include <sys/syscall.h>	// SYS_futex
+#include <time.h>			// struct timespec
+#include <unistd.h>			// syscall
+#endif
+
+#include "futex.h"			// ourselves.
+
+namespace smart {
+
+static_assert(sizeof(std::atomic_uint) == sizeof(int) && std::atomic_uint::is_always_lock_free,
+	"the words double as futex words");
+
+// --------------------------------------------------------------------------------------------------------------------
+void futex_wait(std::atomic_uint& word, const unsigned int expected, const std::chrono::nanoseconds timeout,
+	const bool shared)
+{
+#if defined(__linux__)
+	struct timespec	ts;
+	ts.tv_sec = timeout.count() / 1000000000;
+	ts.tv_nsec = timeout.count() % 1000000000;
+	syscall(SYS_futex, reinterpret_cast<unsigned int*>(&word), shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE,
+		expected, &ts, nullptr, 0);
+#else
+	(void)shared;
+	if (word.load(std::memory_order_acquire) == expected) {
+		std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(timeout, std::chrono::milliseconds(1)));
+	}
+#endif
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void futex_wake(std::atomic_uint& word, const bool shared)
+{
+#if defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<unsigned int*>(&word), shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE,
+		1, nullptr, nullptr, 0);
+#else
+	// The sleepers poll.
+	(void)word;
+	(void)shared;
+#endif
+}
+
+} // namespace smart
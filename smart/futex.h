@@ -0,0 +1,25 @@
+/// \file  futex.h
+/// \brief	Declarations of the futex functions.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#pragma once
+
+#include <atomic>		// std::atomic_uint
+#include <chrono>		// std::chrono::nanoseconds
+
+namespace smart {
+
+/// Sleep while the word still holds expected, at most for timeout. May return early, thus check again.
+/// Linux only; elsewhere it sleeps for a millisecond at most, turning the callers' loops into polling.
+/// \param shared	The word may be in memory shared with other processes.
+void futex_wait(std::atomic_uint& word, const unsigned int expected, const std::chrono::nanoseconds timeout,
+	const bool shared = false);
+
+/// Wake one thread sleeping on the word in #futex_wait.
+/// \param shared	As given to #futex_wait.
+void futex_wake(std::atomic_uint& word, const bool shared = false);
+
+} // namespace smart
@@ -4,47 +4,35 @@
 /// \version 	1.0
 /// \date		2017
 /// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#include <algorithm>			// std::min
+#include <stdexcept>		// std::runtime_error
+
 #include <inttypes.h>		// PRIx64, etc.
 #include <string.h>			// memcpys
+#include <errno.h>			// errno
+#include <poll.h>			// ppoll
+#include <unistd.h>			// read, write, close
+#include <time.h>			// clock_gettime
+#include <sys/eventfd.h>	// eventfd
 
 #include "AxiDataCapture.h"
+#include "AxiDataCaptureRegisters.h"
 
 
 #include "../time.h"
 #include "../File.h"
+#include "../string.h"
 
 
 
 namespace smart {
 namespace hw {
 
-enum class Register : unsigned int {
-	CONTROL=0,
-	START_ADDRESS=1,
-	BLOCKS_PER_TRANSFER=2,
-	BLOCK_SIZE=3,
-	BLOCKS_PER_RING=4,
-	BLOCKS_TRANSFERRED=5,
-	CURRENT_BLOCK=6,
-	CURRENT_ADDRESS=7,
-	BURST_ERROR_COUNT=8,
-	BURST_SUCCESS_COUNT=9,
-};
+using namespace AxiDataCaptureRegisters;
 
-/// Block size, in bytes.
-/// For the Zynq 32-bit the maximum value is 128.
-static constexpr unsigned int BLOCK_SIZE = 128u;
-
-static void write_reg(MappedFile* regs, const Register index, const uint32_t v)
-{
-	regs->write32(static_cast<unsigned int>(index), v);
-}
-
-static unsigned int read_reg(MappedFile* regs, const Register index)
-{
-	const unsigned int r = regs->read32(static_cast<unsigned int>(index));
-	return r;
-}
+/// Granularity of the cache maintenance, in bytes.
+/// Cortex-A9 has 32-byte cache lines, Cortex-A53 64-byte lines.
+static constexpr unsigned int CACHE_LINE_SIZE = 64u;
 
 // --------------------------------------------------------------------------------------------------------------------
 const char*		AxiDataCapture::DEFAULT_UIO_NAME = "AXI-Data-Capture";
@@ -61,38 +49,91 @@ static const std::string	DEVICETREE_CHANNELS("channels");
 /// Sample rate of the data capture.
 static const std::string	DEVICETREE_SAMPLE_RATE("sample-rate");
 
+// --------------------------------------------------------------------------------------------------------------------
+/// Monotonic clock, in nanoseconds. time_us() is too coarse for high sample rates.
+static std::uint64_t monotonic_ns()
+{
+	struct timespec	ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Convert nanoseconds to sample periods without overflowing 64 bits.
+static std::uint64_t adc_ticks_of_ns(const std::uint64_t ns, const unsigned int sample_rate)
+{
+	return (ns / 1000000000u) * sample_rate + ((ns % 1000000000u) * sample_rate) / 1000000000u;
+}
 
-enum {
-	/// 0=>1 triggers.
-	BV_CONTROL_SOFTTRIGGER = 1 << 0,
 
-	/// Tell the internal FIFO to hold the data instead of just ignoring it.
-	/// This has to be set for the duration of the data transfer.
-	BV_CONTROL_DATAHOLD = 1 << 1,
-};
+// --------------------------------------------------------------------------------------------------------------------
+/// All of map 1.
+static DmaArena::Block whole_buffer(UioDevice& device)
+{
+	MappedFile*	map = device.getRequiredMap(1);
+	return DmaArena::Block{ map->data(), device.maps[1].addr, 0u, map->size() };
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// \return The buffer, when usable as a ring.
+static const DmaArena::Block& checked_buffer(const DmaArena::Block& buffer)
+{
+	if (buffer.size < 2u * BLOCK_SIZE || buffer.size % BLOCK_SIZE != 0 || buffer.size > UINT32_MAX) {
+		throw std::runtime_error(ssprintf("AxiDataCapture: buffer of %zu bytes is not a ring of %u-byte blocks", buffer.size, BLOCK_SIZE));
+	}
+	if (buffer.physical % BLOCK_SIZE != 0 || buffer.physical + buffer.size - 1u > UINT32_MAX) {
+		throw std::runtime_error(ssprintf("AxiDataCapture: buffer address 0x%zx not usable", static_cast<std::size_t>(buffer.physical)));
+	}
+	return buffer;
+}
 
 // --------------------------------------------------------------------------------------------------------------------
 AxiDataCapture::AxiDataCapture(std::shared_ptr<smart::UioDevice>	pDevice)
+: AxiDataCapture(pDevice, whole_buffer(*pDevice))
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+AxiDataCapture::AxiDataCapture(std::shared_ptr<smart::UioDevice> pDevice, const DmaArena::Block& buffer)
 : m_device(pDevice),
   m_registers(m_device->getRequiredMap(0)),
-  m_buffer_file(m_device->getRequiredMap(1)),
-  m_buffer(m_buffer_file->data()),
-  m_buffer_size(m_buffer_file->size()),
-  m_physical_start_addr(m_device->maps[1].addr),
+  m_buffer(checked_buffer(buffer).data),
+  m_buffer_size(buffer.size),
+  m_physical_start_addr(buffer.physical),
+  m_sync_offset(buffer.offset),
   m_offset_tail(0u),
+  m_reserved_size(0u),
+  m_offset_synced(0u),
+  m_offset_head(0u),
+  m_head_caching(false),
+  m_non_coherent(m_device->isNonCoherent()),
+  m_irq_threshold(BLOCK_SIZE),
+  m_irq_count(0u),
+  m_irq_enabled(m_device->getFileHandle() != File::NullHandle),
+  m_cancel_fd(-1),
   m_start_time_adc(0),
   m_last_transfer_count(0),
+  m_blocks_transferred(0),
+  m_bytes_produced(0),
+  m_bytes_consumed(0),
+  m_overrun_policy(OverrunPolicy::RESYNC),
+  m_telemetry{},
   nchannels(m_device->getConfigurationUInt32(DEVICETREE_CHANNELS)),
   sample_width(m_device->getConfigurationUInt32(DEVICETREE_CDATA_WIDTH)),
   sample_rate(m_device->getConfigurationUInt32(DEVICETREE_SAMPLE_RATE))
 {
 	const unsigned int block_count = m_buffer_size / BLOCK_SIZE;
-	write_reg(m_registers, Register::CONTROL, 0);
-	write_reg(m_registers, Register::START_ADDRESS, m_device->maps[1].addr);
-	write_reg(m_registers, Register::BLOCKS_PER_TRANSFER, block_count);
-	write_reg(m_registers, Register::BLOCK_SIZE, BLOCK_SIZE);
-	write_reg(m_registers, Register::BLOCKS_PER_RING, block_count); // the buffer in blocks
-	m_last_transfer_count = read_reg(m_registers, Register::BLOCKS_TRANSFERRED);
+	m_registers.write<Register::CONTROL>(0);
+	m_registers.write<Register::START_ADDRESS>(m_physical_start_addr);
+	m_registers.write<Register::BLOCKS_PER_TRANSFER>(block_count);
+	m_registers.write<Register::BLOCK_SIZE>(BLOCK_SIZE);
+	m_registers.write<Register::BLOCKS_PER_RING>(block_count); // the buffer in blocks
+	m_last_transfer_count = m_registers.read<Register::BLOCKS_TRANSFERRED>();
+
+	m_cancel_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (m_cancel_fd < 0) {
+		throw std::runtime_error(ssprintf("AxiDataCapture: eventfd failed, errno=%d", errno));
+	}
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -104,71 +145,221 @@ AxiDataCapture::AxiDataCapture(const char* uio_name)
 // --------------------------------------------------------------------------------------------------------------------
 AxiDataCapture::~AxiDataCapture()
 {
-	if (m_registers) {
-		write_reg(m_registers, Register::CONTROL, 0);
+	m_registers.write<Register::CONTROL>(0);
+	if (m_cancel_fd >= 0) {
+		close(m_cancel_fd);
 	}
 }
 
 // --------------------------------------------------------------------------------------------------------------------
 unsigned int AxiDataCapture::startCapture(const unsigned int transfer_size)
 {
-	unsigned int capture_time_us;
-
-	write_reg(m_registers, Register::CONTROL, 0); // Transfer has to be disabled for a moment, otherwise the trigger won't work.
 	if (transfer_size == CAPTURE_STREAMING) {
-		capture_time_us = 0;
-
-		// Setup IP-core.
-		write_reg(m_registers, Register::BLOCKS_PER_TRANSFER, 0);  // 0: Streaming mode !!!
+		armCapture();
+		triggerCapture();
+		return 0;
 	}
-	else {
-		const unsigned int	bytes_per_sample = (sample_width * nchannels) / 8u;
-		const unsigned int	nsamples = transfer_size / bytes_per_sample;
 
-		capture_time_us = (nsamples * static_cast<uint64_t>(1000U * 1000U)) / sample_rate;
-		write_reg(m_registers, Register::CONTROL, BV_CONTROL_DATAHOLD);
-		write_reg(m_registers, Register::BLOCKS_PER_TRANSFER, nsamples * bytes_per_sample);
-		m_last_transfer_count = read_reg(m_registers, Register::BLOCKS_TRANSFERRED); // Record the transfer count so far.
-	}
-	write_reg(m_registers, Register::CONTROL, BV_CONTROL_SOFTTRIGGER | BV_CONTROL_DATAHOLD); // Start the trigger sequence.
-	m_offset_tail = read_reg(m_registers, Register::CURRENT_ADDRESS) - m_physical_start_addr;
+	const unsigned int	bytes_per_sample = (sample_width * nchannels) / 8u;
+	const unsigned int	nsamples = transfer_size / bytes_per_sample;
+	const unsigned int	capture_time_us = (nsamples * static_cast<uint64_t>(1000U * 1000U)) / sample_rate;
+
+	m_registers.write<Register::CONTROL>(0); // Transfer has to be disabled for a moment, otherwise the trigger won't work.
+	m_registers.assign<Control::DATAHOLD::Set>();
+	m_registers.write<Register::BLOCKS_PER_TRANSFER>(nsamples * bytes_per_sample);
+	m_last_transfer_count = m_registers.read<Register::BLOCKS_TRANSFERRED>(); // Record the transfer count so far.
+	m_registers.assign<Control::SOFTTRIGGER::Set, Control::DATAHOLD::Set>(); // Start the trigger sequence.
+	m_start_time_adc = adc_ticks_of_ns(monotonic_ns(), sample_rate);
+	_resetStreamState();
 
 	return capture_time_us;
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCapture::armCapture()
+{
+	m_registers.write<Register::CONTROL>(0); // Transfer has to be disabled for a moment, otherwise the trigger won't work.
+	m_registers.write<Register::BLOCKS_PER_TRANSFER>(0);  // 0: Streaming mode !!!
+
+	// The core is stopped, thus the data starts exactly at the current address.
+	_resetStreamState();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCapture::triggerCapture()
+{
+	// Take the time on both sides of the register write, the write may be delayed on the bus.
+	const std::uint64_t	t_before = monotonic_ns();
+	m_registers.assign<Control::SOFTTRIGGER::Set, Control::DATAHOLD::Set>(); // Start the trigger sequence.
+	const std::uint64_t	t_after = monotonic_ns();
+	m_start_time_adc = adc_ticks_of_ns(t_before + (t_after - t_before) / 2u, sample_rate);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCapture::_resetStreamState()
+{
+	m_blocks_transferred = m_registers.read<Register::BLOCKS_TRANSFERRED>();
+	// Outside of the ring when the ring has just been moved: the core starts over at START_ADDRESS.
+	const std::uint32_t	current = m_registers.read<Register::CURRENT_ADDRESS>() - m_physical_start_addr;
+	m_offset_tail = current < m_buffer_size ? current : 0u;
+	m_reserved_size = 0;
+	m_offset_synced = m_offset_tail;
+	m_offset_head = m_offset_tail;
+	m_bytes_produced = 0;
+	m_bytes_consumed = 0;
+
+	const std::uint64_t	now = time_us();
+	m_telemetry.start_time_us = now;
+	m_telemetry.last_fetch_us = now;
+	m_telemetry.max_fetch_latency_us = 0;
+	m_telemetry.fetches = 0;
+	m_telemetry.fill_bytes = 0;
+	m_telemetry.max_fill_bytes = 0;
+	m_telemetry.blocks_transferred = m_blocks_transferred;
+	m_telemetry.bytes_produced = 0;
+	m_telemetry.bytes_consumed = 0;
+	m_telemetry.overruns = 0;
+	m_telemetry.bytes_lost = 0;
+	for (auto& bucket : m_telemetry.fill_histogram) {
+		bucket = 0;
+	}
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 bool AxiDataCapture::isCaptureInProgress()
 {
-	const uint32_t	new_transfer_count = read_reg(m_registers, Register::BLOCKS_TRANSFERRED);
+	const uint32_t	new_transfer_count = m_registers.read<Register::BLOCKS_TRANSFERRED>();
 	if (new_transfer_count == m_last_transfer_count) {
-		const uint32_t	control = read_reg(m_registers, Register::CONTROL);
-		if ((control & BV_CONTROL_SOFTTRIGGER) != 0u) {
+		if (m_registers.isSet<Control::SOFTTRIGGER>()) {
 			return true;
 		}
 	}
 	else {
 		/// Completed.
-		if (read_reg(m_registers, Register::BLOCKS_PER_TRANSFER)>0u) {
-			write_reg(m_registers, Register::CONTROL, 0);
+		if (m_registers.read<Register::BLOCKS_PER_TRANSFER>()>0u) {
+			m_registers.write<Register::CONTROL>(0);
 		}
 	}
 	return false;
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+/// Number of bytes between the tail and the head of the ring.
+static unsigned int ring_available(const unsigned int head, const unsigned int tail, const unsigned int buffer_size)
+{
+	return head < tail ? (head + buffer_size - tail) : (head - tail);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+unsigned int AxiDataCapture::_readHead()
+{
+	const std::uint32_t	blocks = m_registers.read<Register::BLOCKS_TRANSFERRED>();
+	const unsigned int	head = m_registers.read<Register::CURRENT_ADDRESS>() - m_physical_start_addr;
+
+	// The counter wraps around, the difference doesn't.
+	m_bytes_produced += static_cast<std::uint64_t>(static_cast<std::uint32_t>(blocks - m_blocks_transferred)) * BLOCK_SIZE;
+	m_blocks_transferred = blocks;
+
+	// The head address alone cannot tell a full lap from an empty ring, the block counter can.
+	// The block count lags the head by less than one block.
+	if (m_bytes_produced > m_bytes_consumed + m_buffer_size - BLOCK_SIZE) {
+		// Only the oldest data is overwritten; the last ring, less the block being written, is intact.
+		const std::uint64_t	lost = m_bytes_produced - m_bytes_consumed - (m_buffer_size - BLOCK_SIZE);
+		m_telemetry.overruns.fetch_add(1, std::memory_order_relaxed);
+		m_telemetry.bytes_lost.fetch_add(lost, std::memory_order_relaxed);
+		if (m_overrun_policy == OverrunPolicy::THROW) {
+			throw std::runtime_error(ssprintf("AxiDataCapture: DMA ring overrun, %" PRIu64 " bytes lost", lost));
+		}
+		m_offset_tail = head;
+		m_offset_synced = head;
+		m_reserved_size = 0;
+		m_bytes_consumed = m_bytes_produced;
+		m_telemetry.bytes_consumed.store(m_bytes_consumed, std::memory_order_relaxed);
+	}
+	m_telemetry.blocks_transferred.store(blocks, std::memory_order_relaxed);
+	m_telemetry.bytes_produced.store(m_bytes_produced, std::memory_order_relaxed);
+	m_offset_head = head;
+	return head;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+unsigned int AxiDataCapture::_fetchHead(const std::size_t size)
+{
+	// The cached head may come from waitForData(), which does not sync.
+	// Served from the cache, the fetch costs no register read and no clock read.
+	if (!m_head_caching || ring_available(m_offset_head, m_offset_tail, m_buffer_size) < size) {
+		_readHead();
+		_recordFetch();
+	}
+	_syncForCpu(m_offset_head);
+	return m_offset_head;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCapture::_recordFetch()
+{
+	const std::uint64_t	now = time_us();
+	const std::uint64_t	last = m_telemetry.last_fetch_us.load(std::memory_order_relaxed);
+	const std::uint64_t	latency = last == 0 ? 0 : now - last;
+	// The consumer may be ahead of the block count, by the part of the block in progress.
+	const std::uint64_t	fill = m_bytes_produced > m_bytes_consumed ? m_bytes_produced - m_bytes_consumed : 0;
+	const unsigned int	bucket = std::min<std::uint64_t>(fill * FILL_HISTOGRAM_BUCKETS / m_buffer_size, FILL_HISTOGRAM_BUCKETS - 1u);
+
+	// Only this thread writes, thus no read-modify-write is needed.
+	m_telemetry.last_fetch_us.store(now, std::memory_order_relaxed);
+	if (latency > m_telemetry.max_fetch_latency_us.load(std::memory_order_relaxed)) {
+		m_telemetry.max_fetch_latency_us.store(latency, std::memory_order_relaxed);
+	}
+	m_telemetry.fetches.store(m_telemetry.fetches.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	m_telemetry.fill_bytes.store(fill, std::memory_order_relaxed);
+	if (fill > m_telemetry.max_fill_bytes.load(std::memory_order_relaxed)) {
+		m_telemetry.max_fill_bytes.store(fill, std::memory_order_relaxed);
+	}
+	std::atomic<std::uint64_t>&	count = m_telemetry.fill_histogram[bucket];
+	count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCapture::_syncForCpu(const unsigned int head)
+{
+	const unsigned int	synced = m_offset_synced;
+	if (!m_non_coherent || head == synced) {
+		return;
+	}
+
+	// The line holding the previous head may have been cached while the DMA was still writing it, thus round down.
+	const unsigned int	begin = synced & ~(CACHE_LINE_SIZE - 1u);
+	const unsigned int	end = std::min((head + CACHE_LINE_SIZE - 1u) & ~(CACHE_LINE_SIZE - 1u), m_buffer_size);
+	UioDevice::SyncRange	ranges[2];
+	unsigned int			nranges = 0;
+	if (head > synced) {
+		ranges[nranges++] = UioDevice::SyncRange{ m_sync_offset + begin, end - begin };
+	} else {
+		// Split at the end of the ring.
+		ranges[nranges++] = UioDevice::SyncRange{ m_sync_offset + begin, m_buffer_size - begin };
+		if (end > 0) {
+			ranges[nranges++] = UioDevice::SyncRange{ m_sync_offset, end };
+		}
+	}
+	m_device->syncBufferRangesForCpu(ranges, nranges);
+	m_offset_synced = head;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
 void* AxiDataCapture::fetchPacket(void* packetBuffer, const size_t packet_size)
 {
-	const unsigned int	head_addr = read_reg(m_registers, Register::CURRENT_ADDRESS);
-	const unsigned int	head = head_addr - m_physical_start_addr;
+	const unsigned int	head = _fetchHead(packet_size);
 	const unsigned int	tail = m_offset_tail;
-	const bool			split_read = head < tail;
 
 	// How much is to be written this round?
-	const unsigned int	total_available = split_read ? (head + m_buffer_size - tail) : (head - tail);
+	const unsigned int	total_available = ring_available(head, tail, m_buffer_size);
 	if (total_available < packet_size) {
 		return nullptr;
 	}
 
 	unsigned int	next_tail = tail + packet_size;
+	m_bytes_consumed += packet_size;
+	m_telemetry.bytes_consumed.store(m_bytes_consumed, std::memory_order_relaxed);
 	// Easy case.
 	if (next_tail <= m_buffer_size) {
 		m_offset_tail = next_tail % m_buffer_size;
@@ -186,10 +377,190 @@ void* AxiDataCapture::fetchPacket(void* packetBuffer, const size_t packet_size)
 	return packet_buffer;
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t AxiDataCapture::fetchPackets(void* packets, const std::size_t packet_size, const std::size_t max_packets)
+{
+	if (packet_size == 0) {
+		throw std::runtime_error("AxiDataCapture::fetchPackets: packet size 0");
+	}
+	const unsigned int	head = _fetchHead(packet_size);
+	const unsigned int	tail = m_offset_tail;
+
+	const std::size_t	npackets = std::min<std::size_t>(ring_available(head, tail, m_buffer_size) / packet_size, max_packets);
+	const std::size_t	total = npackets * packet_size;
+	const std::size_t	size1 = std::min<std::size_t>(total, m_buffer_size - tail);
+	const uint8_t*		dma_buffer = reinterpret_cast<const uint8_t*>(m_buffer);
+	uint8_t*			dst = reinterpret_cast<uint8_t*>(packets);
+	if (total > 0) {
+		memcpy(&dst[0], &dma_buffer[tail], size1);
+		memcpy(&dst[size1], &dma_buffer[0], total - size1);
+	}
+
+	m_offset_tail = (tail + total) % m_buffer_size;
+	m_bytes_consumed += total;
+	m_telemetry.bytes_consumed.store(m_bytes_consumed, std::memory_order_relaxed);
+	return npackets;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+AxiDataCapture::Region AxiDataCapture::reserve(const std::size_t max_size)
+{
+	const unsigned int	head = _readHead();
+	const unsigned int	tail = m_offset_tail;
+	_syncForCpu(head);
+	_recordFetch();
+	const std::size_t	total = std::min<std::size_t>(ring_available(head, tail, m_buffer_size), max_size);
+	const std::size_t	size1 = std::min<std::size_t>(total, m_buffer_size - tail);
+	const uint8_t*		dma_buffer = reinterpret_cast<const uint8_t*>(m_buffer);
+
+	Region	r;
+	r.first = std::span<const std::uint8_t>(&dma_buffer[tail], size1);
+	r.second = std::span<const std::uint8_t>(&dma_buffer[0], total - size1);
+	m_reserved_size = total;
+	return r;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCapture::release(const std::size_t size)
+{
+	if (size > m_reserved_size) {
+		throw std::runtime_error(ssprintf("AxiDataCapture::release: %zu bytes released, only %zu reserved", size, m_reserved_size));
+	}
+	m_reserved_size -= size;
+	m_offset_tail = (m_offset_tail + size) % m_buffer_size;
+	m_bytes_consumed += size;
+	m_telemetry.bytes_consumed.store(m_bytes_consumed, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t AxiDataCapture::waitForData(const std::size_t size, const unsigned int timeout_us)
+{
+	const File::Handle	irq_fd = m_device->getFileHandle();
+	const std::size_t	wanted = std::min<std::size_t>(std::max(size, m_irq_threshold), m_buffer_size - BLOCK_SIZE);
+	const std::uint64_t	bytes_per_second = static_cast<std::uint64_t>(sample_rate) * ((sample_width * nchannels) / 8u);
+	const std::uint64_t	deadline = time_us() + timeout_us;
+
+	for (;;) {
+		// Unmask first: an interrupt arriving after the check below will then wake up the poll.
+		if (m_irq_enabled) {
+			const std::uint32_t	unmask = 1;
+			if (write(irq_fd, &unmask, sizeof(unmask)) != sizeof(unmask)) {
+				m_irq_enabled = false;	// No interrupt configured for the device.
+			}
+		}
+
+		const std::size_t	available = ring_available(_readHead(), m_offset_tail, m_buffer_size);
+		const std::uint64_t	now = time_us();
+		if (available >= wanted || now >= deadline) {
+			return available;
+		}
+
+		// Without interrupts, sleep until the data is expected to be there.
+		std::uint64_t	sleep_us = deadline - now;
+		if (!m_irq_enabled && bytes_per_second > 0) {
+			const std::uint64_t	fill_us = ((wanted - available) * 1000000u + bytes_per_second - 1) / bytes_per_second;
+			sleep_us = std::min<std::uint64_t>(sleep_us, std::max<std::uint64_t>(fill_us, 100u));
+		}
+		struct timespec	ts;
+		ts.tv_sec = sleep_us / 1000000u;
+		ts.tv_nsec = (sleep_us % 1000000u) * 1000u;
+
+		struct pollfd	fds[2] = {
+			{ m_cancel_fd, POLLIN, 0 },
+			{ irq_fd, POLLIN, 0 },
+		};
+		const int	r_poll = ppoll(fds, m_irq_enabled ? 2 : 1, &ts, nullptr);
+		if (r_poll < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(ssprintf("AxiDataCapture::waitForData: poll failed, errno=%d", errno));
+		}
+		if ((fds[0].revents & POLLIN) != 0) {
+			std::uint64_t	cancel_count;
+			if (read(m_cancel_fd, &cancel_count, sizeof(cancel_count)) < 0) {
+				// Already drained by someone else.
+			}
+			return ring_available(_readHead(), m_offset_tail, m_buffer_size);
+		}
+		if ((fds[1].revents & POLLIN) != 0) {
+			std::uint32_t	irq_count;
+			if (read(irq_fd, &irq_count, sizeof(irq_count)) == sizeof(irq_count)) {
+				m_irq_count = irq_count;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCapture::cancelWait()
+{
+	const std::uint64_t	one = 1;
+	if (write(m_cancel_fd, &one, sizeof(one)) != sizeof(one)) {
+		throw std::runtime_error(ssprintf("AxiDataCapture::cancelWait: write failed, errno=%d", errno));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCapture::setIrqThreshold(const std::size_t bytes)
+{
+	const std::size_t	blocks = std::max<std::size_t>((bytes + BLOCK_SIZE - 1) / BLOCK_SIZE, 1u);
+	m_irq_threshold = std::min<std::size_t>(blocks * BLOCK_SIZE, m_buffer_size - BLOCK_SIZE);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+AxiDataCapture::LossCounters AxiDataCapture::getLossCounters() const
+{
+	return LossCounters{ m_telemetry.overruns.load(std::memory_order_relaxed), m_telemetry.bytes_lost.load(std::memory_order_relaxed) };
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+AxiDataCapture::Telemetry AxiDataCapture::getTelemetry() const
+{
+	Telemetry	r;
+	r.timestamp_us = time_us();
+	r.burst_errors = m_registers.read<Register::BURST_ERROR_COUNT>();
+	r.burst_successes = m_registers.read<Register::BURST_SUCCESS_COUNT>();
+	r.blocks_transferred = m_registers.read<Register::BLOCKS_TRANSFERRED>();
+	r.current_block = m_registers.read<Register::CURRENT_BLOCK>();
+
+	r.buffer_size = m_buffer_size;
+	r.fill_bytes = m_telemetry.fill_bytes.load(std::memory_order_relaxed);
+	r.max_fill_bytes = m_telemetry.max_fill_bytes.load(std::memory_order_relaxed);
+	r.bytes_consumed = m_telemetry.bytes_consumed.load(std::memory_order_relaxed);
+	r.fetches = m_telemetry.fetches.load(std::memory_order_relaxed);
+	r.max_fetch_latency_us = m_telemetry.max_fetch_latency_us.load(std::memory_order_relaxed);
+	r.loss = getLossCounters();
+	for (unsigned int i=0; i<FILL_HISTOGRAM_BUCKETS; ++i) {
+		r.fill_histogram[i] = m_telemetry.fill_histogram[i].load(std::memory_order_relaxed);
+	}
+
+	// Blocks transferred since the last fetch are not in bytes_produced yet.
+	// The difference is negative when the consumer has published a newer count in the meantime.
+	const std::int32_t	blocks_since = static_cast<std::int32_t>(r.blocks_transferred - m_telemetry.blocks_transferred.load(std::memory_order_relaxed));
+	const std::uint64_t	produced = m_telemetry.bytes_produced.load(std::memory_order_relaxed) + static_cast<std::uint64_t>(std::max(blocks_since, 0)) * BLOCK_SIZE;
+	r.lag_bytes = produced > r.bytes_consumed ? produced - r.bytes_consumed : 0;
+	const std::uint64_t	nominal_rate = static_cast<std::uint64_t>(sample_rate) * ((sample_width * nchannels) / 8u);
+	r.lag_us = nominal_rate > 0 ? r.lag_bytes * 1000000u / nominal_rate : 0;
+
+	const std::uint64_t	start_time = m_telemetry.start_time_us.load(std::memory_order_relaxed);
+	r.bytes_per_second = start_time == 0 || r.timestamp_us <= start_time ? 0.0 : r.bytes_consumed * 1e6 / (r.timestamp_us - start_time);
+	return r;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCapture::haltCapture()
+{
+	m_registers.write<Register::CONTROL>(0);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
 void AxiDataCapture::stopCapture()
 {
-	write_reg(m_registers, Register::CONTROL, 0); // Transfer has to be disabled for a moment, otherwise the trigger won't work.
+	m_registers.write<Register::CONTROL>(0); // Transfer has to be disabled for a moment, otherwise the trigger won't work.
 	m_offset_tail = 0;
+	m_offset_head = 0;
+	m_reserved_size = 0;
 }
 
 void AxiDataCapture::clearBuffer()
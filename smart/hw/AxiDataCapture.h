@@ -6,11 +6,17 @@
 /// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
 #pragma once
 
+#include <atomic>	// std::atomic
+#include <cstddef>	// std::size_t
+#include <cstdint>	// SIZE_MAX
 #include <memory>	// std::shared_ptr
 #include <functional>	// std::function
+#include <span>		// std::span
 
+#include "../DmaArena.h"
 #include "../MappedFile.h"
 #include "../UioDevice.h"
+#include "AxiDataCaptureRegisters.h"
 
 namespace smart {
 namespace hw {
@@ -73,10 +79,7 @@ private:
 	std::shared_ptr<smart::UioDevice>	m_device;
 
 	/// Registers.
-	smart::MappedFile*					m_registers;
-
-	/// Data buffer.
-	smart::MappedFile*					m_buffer_file;
+	AxiDataCaptureRegisters::Registers	m_registers;
 
 	/// Buffer for the DMA operation.
 	void*								m_buffer;
@@ -87,10 +90,40 @@ private:
 	/// Start address of the buffer.
 	const uint32_t						m_physical_start_addr;
 
+	/// Offset of the buffer in map 1, for the cache maintenance of non-coherent DMA.
+	const std::size_t					m_sync_offset;
+
 	/// Offset of the tail.
 	uint32_t							m_offset_tail;
 
-	/// Start time of the capture, in ADC units.
+	/// Number of bytes handed out by the last reserve() call.
+	std::size_t							m_reserved_size;
+
+	/// Non-coherent DMA only: offset up to which the CPU caches have been invalidated.
+	uint32_t							m_offset_synced;
+
+	/// Offset of the head as of the last register read.
+	uint32_t							m_offset_head;
+
+	/// Head caching: the packet fetches read the head register only when the cached head is exhausted.
+	bool								m_head_caching;
+
+	/// Does the DMA buffer need cache maintenance?
+	const bool							m_non_coherent;
+
+	/// Minimum number of bytes a waitForData() call waits for.
+	std::size_t							m_irq_threshold;
+
+	/// Interrupt count as last reported by the UIO device.
+	std::uint32_t						m_irq_count;
+
+	/// Is the UIO interrupt usable? Cleared when the unmask write fails.
+	bool								m_irq_enabled;
+
+	/// eventfd used by cancelWait() to wake up waitForData().
+	int									m_cancel_fd;
+
+	/// Trigger time of the capture, in ADC units (sample periods) of the monotonic clock.
 	std::uint64_t						m_start_time_adc;
 
 	/// Last transfer count before current capture.
@@ -98,6 +131,129 @@ private:
 public:
 	static constexpr unsigned int CAPTURE_STREAMING = 0;
 
+	/// What to do when the DMA engine has overwritten data not yet consumed.
+	enum class OverrunPolicy {
+		/// Discard all unread data and continue from the current head.
+		RESYNC,
+		/// Throw std::runtime_error. The capture has to be restarted.
+		THROW
+	};
+
+	/// Data lost due to ring overruns since the start of the capture.
+	struct LossCounters {
+		/// Number of overruns detected.
+		std::uint64_t	overruns;
+
+		/// Number of bytes overwritten before they were consumed, including the block being written.
+		/// The unread data still intact, which OverrunPolicy::RESYNC skips as well, is not counted.
+		std::uint64_t	bytes_lost;
+	};
+
+	/// Number of buckets in Telemetry::fill_histogram.
+	static constexpr unsigned int FILL_HISTOGRAM_BUCKETS = 16;
+
+	/// Snapshot of the IP core counters and of the consumer side metrics, see #getTelemetry.
+	struct Telemetry {
+		/// Time of the snapshot, see time_us().
+		std::uint64_t	timestamp_us;
+
+		/// IP core: failed AXI bursts (BURST_ERROR_COUNT). Rising means bus contention.
+		std::uint32_t	burst_errors;
+
+		/// IP core: completed AXI bursts (BURST_SUCCESS_COUNT).
+		std::uint32_t	burst_successes;
+
+		/// IP core: free-running count of transferred blocks (BLOCKS_TRANSFERRED).
+		std::uint32_t	blocks_transferred;
+
+		/// IP core: index of the block being written (CURRENT_BLOCK).
+		std::uint32_t	current_block;
+
+		/// Size of the DMA ring, in bytes.
+		std::uint64_t	buffer_size;
+
+		/// Bytes in the ring not consumed yet, as seen by the last fetch reading the head.
+		std::uint64_t	fill_bytes;
+
+		/// Highest fill_bytes since the start of the capture.
+		std::uint64_t	max_fill_bytes;
+
+		/// Bytes the consumer is behind the DMA engine at the time of the snapshot.
+		std::uint64_t	lag_bytes;
+
+		/// lag_bytes at the nominal data rate, in microseconds.
+		std::uint64_t	lag_us;
+
+		/// Bytes consumed since the start of the capture.
+		std::uint64_t	bytes_consumed;
+
+		/// Average consumption rate since the start of the capture.
+		double			bytes_per_second;
+
+		/// Number of fetches reading the head register: every #reserve, and the #fetchPacket and
+		/// #fetchPackets calls not served from the cached head. Fetches served from the cache are not timed.
+		std::uint64_t	fetches;
+
+		/// Longest time between two fetches reading the head, in microseconds.
+		/// Has to stay well below the time to fill the ring.
+		std::uint64_t	max_fetch_latency_us;
+
+		/// Overruns since the start of the capture, as in #getLossCounters.
+		LossCounters	loss;
+
+		/// Fill level seen by the fetches reading the head. Bucket i counts the fetches that found
+		/// between i and i+1 sixteenths of the ring filled.
+		std::uint64_t	fill_histogram[FILL_HISTOGRAM_BUCKETS];
+	};
+private:
+	/// Consumer side metrics. Written by the consumer, read by #getTelemetry from any thread.
+	struct TelemetryCounters {
+		std::atomic<std::uint64_t>	start_time_us;
+		std::atomic<std::uint64_t>	last_fetch_us;
+		std::atomic<std::uint64_t>	max_fetch_latency_us;
+		std::atomic<std::uint64_t>	fetches;
+		std::atomic<std::uint64_t>	fill_bytes;
+		std::atomic<std::uint64_t>	max_fill_bytes;
+		std::atomic<std::uint32_t>	blocks_transferred;
+		std::atomic<std::uint64_t>	bytes_produced;
+		std::atomic<std::uint64_t>	bytes_consumed;
+		std::atomic<std::uint64_t>	overruns;
+		std::atomic<std::uint64_t>	bytes_lost;
+		std::atomic<std::uint64_t>	fill_histogram[FILL_HISTOGRAM_BUCKETS];
+	};
+
+	/// Value of BLOCKS_TRANSFERRED at the last head update.
+	std::uint32_t						m_blocks_transferred;
+
+	/// Bytes produced by the DMA engine since the start of the capture, counted in whole blocks.
+	std::uint64_t						m_bytes_produced;
+
+	/// Bytes consumed since the start of the capture.
+	std::uint64_t						m_bytes_consumed;
+
+	/// Overrun handling.
+	OverrunPolicy						m_overrun_policy;
+
+	/// Telemetry, including the overrun statistics.
+	TelemetryCounters					m_telemetry;
+
+	/// Read the head offset and check for ring overruns.
+	unsigned int _readHead();
+
+	/// Head offset for a packet fetch: the cached one when head caching is on and it covers the given size,
+	/// otherwise a fresh one. The data up to the head is synced for the CPU.
+	unsigned int _fetchHead(const std::size_t size);
+
+	/// Take the ring position of the stopped core as the start of the stream; reset the counters.
+	void _resetStreamState();
+
+	/// Update the fetch statistics of the telemetry; after a head register read only, off the cached path.
+	void _recordFetch();
+
+	/// Non-coherent DMA only: invalidate the CPU caches for the data that arrived since the last call.
+	void _syncForCpu(const unsigned int head);
+public:
+
 	/// Number of channels in the data capture.
 	const unsigned int		nchannels;
 
@@ -106,6 +262,22 @@ public:
 
 	/// Sample rate, samples per second.
 	unsigned int			sample_rate;
+
+	/// Readable part of the DMA ring, as at most two contiguous pieces.
+	/// The second piece is empty unless the data wraps around the end of the ring.
+	struct Region {
+		/// Data starting at the tail.
+		std::span<const std::uint8_t>	first;
+
+		/// Continuation at the start of the ring, if any.
+		std::span<const std::uint8_t>	second;
+
+		/// Total number of bytes in both pieces.
+		std::size_t size() const
+		{
+			return first.size() + second.size();
+		}
+	};
 public:
 
 	/// Default name for the data capture device, "AXI-Data-Capture".
@@ -115,6 +287,12 @@ public:
 	/// \param pDevice	UIO device to be used as the capture device.
 	AxiDataCapture(std::shared_ptr<smart::UioDevice>	pDevice);
 
+	/// Capture into a part of the DMA memory, e.g. to share one reserved memory region among several IP cores.
+	/// \param pDevice	UIO device to be used as the capture device.
+	/// \param buffer	The ring: whole blocks of BLOCK_SIZE bytes, aligned to BLOCK_SIZE. For non-coherent DMA,
+	///					a block of map 1 of this device, whose sync device covers that map.
+	AxiDataCapture(std::shared_ptr<smart::UioDevice> pDevice, const smart::DmaArena::Block& buffer);
+
 	/// constructor.
 	/// \param uio_name Name of the data capture UIO device. The constant #DEFAULT_UIO_NAME provides a name that should be used by default.
 	AxiDataCapture(const char* uio_name);
@@ -127,6 +305,27 @@ public:
 	/// \return Capture time, in microseconds.
 	unsigned int startCapture(const unsigned int size);
 
+	/// Streaming mode only, the first half of #startCapture: stop the core and set it up for streaming.
+	/// Together with #triggerCapture this lets AxiDataCaptureGroup start several cores close together.
+	void armCapture();
+
+	/// Streaming mode only, the second half of #startCapture: start an armed capture with a single register write.
+	/// The time of the write is recorded, see #getStartTimeAdc.
+	void triggerCapture();
+
+	/// Trigger time of the last capture, in sample periods of the monotonic clock (CLOCK_MONOTONIC).
+	/// The difference between two devices with the same sample rate is their start offset in samples.
+	std::uint64_t getStartTimeAdc() const
+	{
+		return m_start_time_adc;
+	}
+
+	/// Size of the DMA ring, in bytes.
+	std::size_t getBufferSize() const
+	{
+		return m_buffer_size;
+	}
+
 	/// Is capture in progress?
 	/// \return true when a capture is in progress, false otherwise.
 	bool isCaptureInProgress();
@@ -145,6 +344,91 @@ public:
 		return reinterpret_cast<volatile TP*>(fetchPacket(reinterpret_cast<void*>(packetBuffer), sizeof(TP)));
 	}
 
+	/// Streaming mode only: Copy as many whole packets as available, at most the given number.
+	/// The current address register is read once per call, or not at all in head caching mode while
+	/// the cached head still covers a packet. Packets split by the wrap of the ring are put together.
+	/// \param packets		Destination, room for max_packets packets.
+	/// \param packet_size	Size of one packet.
+	/// \param max_packets	Maximum number of packets to copy.
+	/// \return Number of packets copied.
+	std::size_t fetchPackets(void* packets, const std::size_t packet_size, const std::size_t max_packets);
+
+	/// Streaming mode only: Copy as many whole packets as available, at most max_packets.
+	/// \return Number of packets copied.
+	template <typename TP>
+	std::size_t fetchPackets(TP* packets, const std::size_t max_packets) {
+		return fetchPackets(reinterpret_cast<void*>(packets), sizeof(TP), max_packets);
+	}
+
+	/// Streaming mode only: Fill the span with as many whole packets as available.
+	/// \return The packets copied, a prefix of the span.
+	template <typename TP>
+	std::span<TP> fetchPackets(std::span<TP> packets) {
+		return packets.first(fetchPackets(reinterpret_cast<void*>(packets.data()), sizeof(TP), packets.size()));
+	}
+
+	/// Turn head caching on or off; off by default.
+	/// With head caching, #fetchPacket and #fetchPackets serve packets from the head seen by an earlier
+	/// register read and read the register again only when that data is used up. This saves one uncached
+	/// bus read per packet when packets are small; overruns are detected at the next register read.
+	void setHeadCaching(const bool enable)
+	{
+		m_head_caching = enable;
+	}
+
+	/// Streaming mode only: Get the data available in the DMA ring without copying it.
+	/// The current address register is read once per call.
+	/// On non-coherent DMA buffers the newly arrived data is invalidated in the CPU caches first.
+	/// The pieces point straight into the DMA buffer and stay valid until released by #release.
+	/// \param max_size	Maximum number of bytes to return.
+	/// \return Available data, empty when there is nothing to read.
+	Region reserve(const std::size_t max_size = SIZE_MAX);
+
+	/// Streaming mode only: Advance the tail by the given number of bytes.
+	/// \param size	Number of bytes consumed, at most the size of the last #reserve result.
+	void release(const std::size_t size);
+
+	/// Streaming mode only: Block until at least the given number of bytes is available in the DMA ring.
+	/// Sleeps on the UIO interrupt of the device; the interrupt is unmasked before the ring is checked, so no
+	/// interrupt can be lost in between. When the device has no interrupt, the wait wakes up at the time
+	/// the requested amount of data is expected according to the sample rate.
+	/// \param size		Number of bytes to wait for, at least the threshold set by #setIrqThreshold.
+	/// \param timeout_us	Maximum time to wait, in microseconds.
+	/// \return Number of bytes available; less than requested on timeout or after #cancelWait.
+	std::size_t waitForData(const std::size_t size, const unsigned int timeout_us);
+
+	/// Wake up a waitForData() call blocked in another thread.
+	void cancelWait();
+
+	/// Set the minimum amount of data to wait for in waitForData().
+	/// The IP core reports progress in blocks, thus the value is rounded up to whole blocks.
+	/// \param bytes	Bytes per wakeup.
+	void setIrqThreshold(const std::size_t bytes);
+
+	/// Interrupt count as last reported by the UIO device.
+	std::uint32_t getIrqCount() const
+	{
+		return m_irq_count;
+	}
+
+	/// Set the overrun policy; the default is OverrunPolicy::RESYNC.
+	void setOverrunPolicy(const OverrunPolicy policy)
+	{
+		m_overrun_policy = policy;
+	}
+
+	/// Data lost due to ring overruns since the start of the capture.
+	/// Can be called from any thread.
+	LossCounters getLossCounters() const;
+
+	/// Sample the IP core counters together with the consumer side metrics.
+	/// Can be called from any thread; costs four register reads and no locking.
+	Telemetry getTelemetry() const;
+
+	/// Stop the DMA engine, keeping the data not consumed yet:
+	/// #reserve, #fetchPacket and #fetchPackets return it until the ring is drained.
+	void haltCapture();
+
 	void stopCapture();
 
 	void clearBuffer();
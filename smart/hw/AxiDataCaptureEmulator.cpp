@@ -0,0 +1,301 @@
+/// \file  AxiDataCaptureEmulator.cpp
+/// \brief Implementation of the class AxiDataCaptureEmulator.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#include <algorithm>			// std::min
+#include <atomic>				// std::atomic_ref
+#include <stdexcept>			// std::runtime_error
+
+#include <errno.h>				// errno
+#include <string.h>				// memset, strerror
+#include <unistd.h>				// ftruncate, close
+#include <sys/mman.h>			// memfd_create, mmap
+#include <sys/socket.h>			// socketpair
+
+#include "AxiDataCaptureEmulator.h"
+#include "AxiDataCaptureRegisters.h"
+
+#include "../File.h"
+#include "../MappedFile.h"		// MappedFile::pageSize
+#include "../string.h"			// ssprintf
+#include "../time.h"			// time_us, usleep
+
+namespace smart {
+namespace hw {
+
+using namespace AxiDataCaptureRegisters;
+
+/// Longest sleep of the producer thread, in microseconds.
+static constexpr unsigned int PRODUCER_PERIOD_US = 1000u;
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Device tree property as stored in /proc/device-tree: big-endian.
+static std::vector<std::uint8_t> devicetree_uint32(const std::uint32_t value)
+{
+	return std::vector<std::uint8_t>{
+		static_cast<std::uint8_t>(value >> 24), static_cast<std::uint8_t>(value >> 16),
+		static_cast<std::uint8_t>(value >> 8), static_cast<std::uint8_t>(value) };
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+AxiDataCaptureEmulator::AxiDataCaptureEmulator(const Options& options)
+: m_options(options),
+  m_memory_fd(-1),
+  m_irq_fd(-1),
+  m_memory(nullptr),
+  m_memory_size(0),
+  m_offset(0),
+  m_partial(0),
+  m_start_address(options.buffer_address),
+  m_bytes_produced(0),
+  m_irq_enabled(false),
+  m_irq_count(0),
+  m_running(false)
+{
+	const std::size_t	page_size = MappedFile::pageSize();
+	m_options.buffer_size = std::max<std::size_t>((options.buffer_size + page_size - 1) / page_size, 1u) * page_size;
+	m_memory_size = page_size + m_options.buffer_size;
+
+	m_memory_fd = memfd_create("axi-data-capture", MFD_CLOEXEC);
+	if (m_memory_fd < 0) {
+		throw std::runtime_error(ssprintf("AxiDataCaptureEmulator: memfd_create failed: %s", strerror(errno)));
+	}
+	// Owned by the File from here on.
+	auto	memory_file = std::make_shared<File>(m_memory_fd);
+	if (ftruncate(m_memory_fd, m_memory_size) != 0) {
+		throw std::runtime_error(ssprintf("AxiDataCaptureEmulator: cannot allocate %zu bytes: %s", m_memory_size, strerror(errno)));
+	}
+	void*	memory = mmap(nullptr, m_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_memory_fd, 0);
+	if (memory == MAP_FAILED) {
+		throw std::runtime_error(ssprintf("AxiDataCaptureEmulator: mmap failed: %s", strerror(errno)));
+	}
+	m_memory = reinterpret_cast<std::uint8_t*>(memory);
+
+	// Datagrams keep the 32-bit messages of the UIO protocol apart.
+	std::shared_ptr<File>	irq_file;
+	if (m_options.irq) {
+		int	fds[2];
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+			munmap(m_memory, m_memory_size);
+			throw std::runtime_error(ssprintf("AxiDataCaptureEmulator: socketpair failed: %s", strerror(errno)));
+		}
+		m_irq_fd = fds[0];
+		irq_file = std::make_shared<File>(fds[1]);
+	}
+
+	// The state of the IP core after reset.
+	_writeRegister(Register::START_ADDRESS::index, m_options.buffer_address);
+	_writeRegister(Register::BLOCK_SIZE::index, BLOCK_SIZE);
+	_writeRegister(Register::BLOCKS_PER_RING::index, m_options.buffer_size / BLOCK_SIZE);
+	_writeRegister(Register::CURRENT_ADDRESS::index, m_options.buffer_address);
+
+	std::vector<UioMap>	maps(2);
+	maps[0].addr = m_options.register_address;
+	maps[0].name = "registers";
+	maps[0].offset = 0;
+	maps[0].size = page_size;
+	maps[1].addr = m_options.buffer_address;
+	maps[1].name = "buffer";
+	maps[1].offset = 0;
+	maps[1].size = m_options.buffer_size;
+
+	UioDevice::IpCoreConfigurationMap	configuration;
+	configuration["trenz.biz,channels"] = devicetree_uint32(m_options.nchannels);
+	configuration["trenz.biz,cdata-width"] = devicetree_uint32(m_options.sample_width);
+	configuration["trenz.biz,sample-rate"] = devicetree_uint32(m_options.sample_rate);
+	configuration["trenz.biz,buffer-size"] = devicetree_uint32(m_options.buffer_size);
+
+	m_device = std::make_shared<UioDevice>("AXI-Data-Capture", irq_file, memory_file, maps, configuration);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+AxiDataCaptureEmulator::AxiDataCaptureEmulator()
+	: AxiDataCaptureEmulator(Options())
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+AxiDataCaptureEmulator::~AxiDataCaptureEmulator()
+{
+	stopProducer();
+	if (m_irq_fd >= 0) {
+		close(m_irq_fd);
+	}
+	if (m_memory != nullptr) {
+		munmap(m_memory, m_memory_size);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::uint32_t AxiDataCaptureEmulator::_readRegister(const unsigned int index) const
+{
+	std::uint32_t*	reg = &reinterpret_cast<std::uint32_t*>(m_memory)[index];
+	return std::atomic_ref<std::uint32_t>(*reg).load(std::memory_order_acquire);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureEmulator::_writeRegister(const unsigned int index, const std::uint32_t value)
+{
+	// Release: the data written into the ring is visible before the register update.
+	std::uint32_t*	reg = &reinterpret_cast<std::uint32_t*>(m_memory)[index];
+	std::atomic_ref<std::uint32_t>(*reg).store(value, std::memory_order_release);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureEmulator::_fill(std::uint8_t* dst, const std::uint64_t stream_offset, const std::size_t size)
+{
+	switch (m_options.pattern) {
+	case Pattern::COUNTER:
+		{
+			// Byte by byte: pieces of advanceHead may start and end inside a word.
+			for (std::size_t i=0; i<size; ++i) {
+				const std::uint64_t	offset = stream_offset + i;
+				const std::uint32_t	word = static_cast<std::uint32_t>(offset / sizeof(std::uint32_t));
+				dst[i] = static_cast<std::uint8_t>(word >> (8u * (offset % sizeof(std::uint32_t))));
+			}
+		}
+		break;
+	case Pattern::ZERO:
+		memset(dst, 0, size);
+		break;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t AxiDataCaptureEmulator::advance(const std::size_t size)
+{
+	return _produce(size / BLOCK_SIZE * BLOCK_SIZE);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t AxiDataCaptureEmulator::advanceHead(const std::size_t size)
+{
+	return _produce(size);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t AxiDataCaptureEmulator::_produce(const std::size_t total)
+{
+	std::lock_guard<std::mutex>	guard(m_mutex);
+
+	const std::uint32_t	control = _readRegister(Register::CONTROL::index);
+	if ((control & BV_CONTROL_SOFTTRIGGER) == 0 || total == 0) {
+		return 0;
+	}
+
+	// The ring may be any part of the buffer, e.g. a block of a DmaArena.
+	const std::uint32_t	start_address = _readRegister(Register::START_ADDRESS::index);
+	const std::size_t	ring_start = start_address >= m_options.buffer_address && start_address - m_options.buffer_address < m_options.buffer_size
+		? start_address - m_options.buffer_address : 0u;
+	if (start_address != m_start_address) {
+		m_start_address = start_address;
+		m_offset = 0;
+		m_partial = 0;
+	}
+	const std::size_t	ring_blocks = _readRegister(Register::BLOCKS_PER_RING::index);
+	const std::size_t	max_size = m_options.buffer_size - ring_start;
+	const std::size_t	ring_size = ring_blocks == 0 ? max_size : std::min(ring_blocks * BLOCK_SIZE, max_size);
+	std::uint8_t*		ring = &m_memory[MappedFile::pageSize() + ring_start];
+	const std::size_t	nblocks = (m_partial + total) / BLOCK_SIZE;
+	m_partial = (m_partial + total) % BLOCK_SIZE;
+
+	m_offset %= ring_size;
+	for (std::size_t done = 0; done < total; ) {
+		const std::size_t	piece = std::min(total - done, ring_size - m_offset);
+		_fill(&ring[m_offset], m_bytes_produced + done, piece);
+		m_offset = (m_offset + piece) % ring_size;
+		done += piece;
+	}
+	m_bytes_produced += total;
+
+	// The address first: the driver reads the block count first, and the count must not run ahead of the address.
+	_writeRegister(Register::CURRENT_ADDRESS::index, start_address + m_offset);
+	_writeRegister(Register::CURRENT_BLOCK::index, m_offset / BLOCK_SIZE);
+	_writeRegister(Register::BLOCKS_TRANSFERRED::index, _readRegister(Register::BLOCKS_TRANSFERRED::index) + nblocks);
+	_writeRegister(Register::BURST_SUCCESS_COUNT::index, _readRegister(Register::BURST_SUCCESS_COUNT::index) + nblocks);
+
+	if (nblocks > 0) {
+		_raiseIrq();
+	}
+	return total;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureEmulator::injectBurstErrors(const std::uint32_t count)
+{
+	std::lock_guard<std::mutex>	guard(m_mutex);
+	_writeRegister(Register::BURST_ERROR_COUNT::index, _readRegister(Register::BURST_ERROR_COUNT::index) + count);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureEmulator::_raiseIrq()
+{
+	if (m_irq_fd < 0) {
+		return;
+	}
+
+	// Collect the enable/disable requests of the driver.
+	std::uint32_t	request;
+	while (recv(m_irq_fd, &request, sizeof(request), MSG_DONTWAIT) == sizeof(request)) {
+		m_irq_enabled = request != 0;
+	}
+
+	// Like uio_pdrv_genirq: the interrupt stays disabled until the driver enables it again.
+	if (m_irq_enabled) {
+		const std::uint32_t	count = ++m_irq_count;
+		if (send(m_irq_fd, &count, sizeof(count), MSG_DONTWAIT | MSG_NOSIGNAL) == sizeof(count)) {
+			m_irq_enabled = false;
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureEmulator::startProducer()
+{
+	if (m_producer.joinable()) {
+		throw std::runtime_error("AxiDataCaptureEmulator::startProducer: already running");
+	}
+	m_running = true;
+	m_producer = std::thread(&AxiDataCaptureEmulator::_producerMain, this);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureEmulator::stopProducer()
+{
+	m_running = false;
+	if (m_producer.joinable()) {
+		m_producer.join();
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureEmulator::_producerMain()
+{
+	const std::uint64_t	bytes_per_second = static_cast<std::uint64_t>(m_options.sample_rate) * ((m_options.sample_width * m_options.nchannels) / 8u);
+	if (bytes_per_second == 0) {
+		return;
+	}
+
+	// Keep the pieces well below the ring size, even at high data rates.
+	const std::uint64_t	ring_time_us = m_options.buffer_size * 1000000u / bytes_per_second;
+	const unsigned int	period_us = static_cast<unsigned int>(std::clamp<std::uint64_t>(ring_time_us / 16u, 10u, PRODUCER_PERIOD_US));
+	const std::uint64_t	t0 = time_us();
+	std::uint64_t		done = 0;
+
+	while (m_running) {
+		usleep(period_us);
+
+		// Time passes whether the capture is triggered or not.
+		const std::uint64_t	due = (time_us() - t0) * bytes_per_second / 1000000u;
+		const std::uint64_t	todo = (due - done) / BLOCK_SIZE * BLOCK_SIZE;
+		if (todo > 0) {
+			advance(todo);
+			done += todo;
+		}
+	}
+}
+
+} // namespace hw
+} // namespace smart
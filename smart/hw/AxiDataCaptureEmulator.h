@@ -0,0 +1,197 @@
+/// \file  AxiDataCaptureEmulator.h
+/// \brief Interface of the class AxiDataCaptureEmulator.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#pragma once
+
+#include <atomic>		// std::atomic
+#include <cstddef>		// std::size_t
+#include <cstdint>		// std::uint32_t
+#include <memory>		// std::shared_ptr
+#include <mutex>		// std::mutex
+#include <thread>		// std::thread
+
+#include "../UioDevice.h"
+
+namespace smart {
+namespace hw {
+
+/// \brief Software model of the AXI Data Capture IP core, for testing and benchmarking without hardware.
+///
+/// The register page and the DMA ring live in a memfd, the interrupt is a socket following the UIO
+/// interrupt protocol. #getDevice returns an UioDevice on top of them, which is passed to the constructor
+/// AxiDataCapture(std::shared_ptr<UioDevice>) in place of a real device.
+///
+/// The model reacts to the registers written by AxiDataCapture: while the bit BV_CONTROL_SOFTTRIGGER is set
+/// in CONTROL it writes whole blocks into the ring starting at START_ADDRESS, wraps after BLOCKS_PER_RING
+/// blocks and advances CURRENT_ADDRESS, CURRENT_BLOCK, BLOCKS_TRANSFERRED and BURST_SUCCESS_COUNT.
+/// Only the streaming mode is modelled; a transfer size in BLOCKS_PER_TRANSFER is ignored.
+///
+/// Data is produced either by #advance, for deterministic tests, or by a producer thread at the
+/// configured data rate, see #startProducer.
+///
+/// Example:
+/// @code
+///	AxiDataCaptureEmulator	emulator;
+///	AxiDataCapture			dev(emulator.getDevice());
+///	dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+///	emulator.advance(4096);
+///	const auto region = dev.reserve();
+/// @endcode
+class AxiDataCaptureEmulator {
+public:
+	/// Content of the produced data.
+	enum class Pattern {
+		/// Every 32-bit word holds its index in the data stream, little-endian.
+		COUNTER,
+		/// All zeros.
+		ZERO,
+	};
+
+	/// Configuration of the emulated IP core.
+	struct Options {
+		/// Number of channels.
+		unsigned int	nchannels = 2;
+
+		/// Bits per sample of one channel.
+		unsigned int	sample_width = 16;
+
+		/// Samples per second, of one channel.
+		unsigned int	sample_rate = 48000;
+
+		/// Size of the DMA ring, in bytes; rounded up to whole pages.
+		std::size_t		buffer_size = 1024u * 1024u;
+
+		/// Physical address reported for the register map.
+		std::uint32_t	register_address = 0x43C10000u;
+
+		/// Physical address reported for the DMA ring.
+		std::uint32_t	buffer_address = 0x1F000000u;
+
+		/// Data pattern.
+		Pattern			pattern = Pattern::COUNTER;
+
+		/// Provide an interrupt? Without it AxiDataCapture::waitForData falls back to sleeping.
+		bool			irq = true;
+	};
+
+	/// Create the emulated device.
+	AxiDataCaptureEmulator(const Options& options);
+
+	/// Create the emulated device with the default options.
+	AxiDataCaptureEmulator();
+
+	/// Stops the producer thread.
+	~AxiDataCaptureEmulator();
+
+	/// The emulated device.
+	std::shared_ptr<UioDevice> getDevice()
+	{
+		return m_device;
+	}
+
+	/// Configuration.
+	const Options& getOptions() const
+	{
+		return m_options;
+	}
+
+	/// Produce data as the IP core would, when triggered.
+	/// Safe to call while the producer thread runs.
+	/// \param size	Number of bytes; rounded down to whole blocks.
+	/// \return Number of bytes produced; 0 when the capture is not triggered.
+	std::size_t advance(const std::size_t size);
+
+	/// Produce data without rounding to whole blocks, as the IP core does between two blocks:
+	/// CURRENT_ADDRESS follows every byte, BLOCKS_TRANSFERRED counts completed blocks only.
+	/// \param size	Number of bytes.
+	/// \return Number of bytes produced; 0 when the capture is not triggered.
+	std::size_t advanceHead(const std::size_t size);
+
+	/// Start a thread producing data at the rate of nchannels * sample_width * sample_rate.
+	void startProducer();
+
+	/// Stop the producer thread.
+	void stopProducer();
+
+	/// Count burst errors, as the IP core does on AXI bus errors.
+	void injectBurstErrors(const std::uint32_t count);
+
+	/// Number of bytes produced since construction.
+	std::uint64_t getBytesProduced() const
+	{
+		return m_bytes_produced;
+	}
+
+	/// Number of interrupts delivered since construction.
+	std::uint32_t getIrqCount() const
+	{
+		return m_irq_count;
+	}
+private:
+	/// Configuration.
+	Options						m_options;
+
+	/// Register page followed by the DMA ring.
+	int							m_memory_fd;
+
+	/// Our end of the interrupt socket, -1 without interrupt.
+	int							m_irq_fd;
+
+	/// Mapping of m_memory_fd.
+	std::uint8_t*				m_memory;
+
+	/// Size of m_memory.
+	std::size_t					m_memory_size;
+
+	/// The device handed out to AxiDataCapture.
+	std::shared_ptr<UioDevice>	m_device;
+
+	/// Serializes #advance.
+	std::mutex					m_mutex;
+
+	/// Write offset in the ring.
+	std::size_t					m_offset;
+
+	/// Bytes written of the block in progress.
+	std::size_t					m_partial;
+
+	/// START_ADDRESS the write offset refers to; the ring restarts when the driver moves it.
+	std::uint32_t				m_start_address;
+
+	/// Bytes produced since construction.
+	std::atomic<std::uint64_t>	m_bytes_produced;
+
+	/// Is the interrupt enabled by the driver?
+	bool						m_irq_enabled;
+
+	/// Interrupts delivered.
+	std::atomic<std::uint32_t>	m_irq_count;
+
+	/// Producer thread.
+	std::thread					m_producer;
+
+	/// Keep the producer running?
+	std::atomic<bool>			m_running;
+
+	/// Write size bytes at the write offset and update the registers.
+	std::size_t _produce(const std::size_t size);
+
+	/// Register access.
+	std::uint32_t _readRegister(const unsigned int index) const;
+	void _writeRegister(const unsigned int index, const std::uint32_t value);
+
+	/// Fill a piece of the ring with the pattern.
+	void _fill(std::uint8_t* dst, const std::uint64_t stream_offset, const std::size_t size);
+
+	/// Deliver an interrupt if the driver has enabled it.
+	void _raiseIrq();
+
+	/// Body of the producer thread.
+	void _producerMain();
+};
+
+} // namespace hw
+} // namespace smart
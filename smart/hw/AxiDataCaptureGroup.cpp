@@ -0,0 +1,166 @@
+/// \file  AxiDataCaptureGroup.cpp
+/// \brief Implementation of the class AxiDataCaptureGroup.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#include <algorithm>		// std::min
+#include <stdexcept>		// std::runtime_error
+
+#include <time.h>			// clock_gettime
+
+#include "AxiDataCaptureGroup.h"
+
+#include "../string.h"		// ssprintf
+#include "../time.h"		// time_us
+
+namespace smart {
+namespace hw {
+
+// --------------------------------------------------------------------------------------------------------------------
+static std::uint64_t monotonic_ns()
+{
+	struct timespec	ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+/// Cut a region down to the given size.
+static void trim_region(AxiDataCapture::Region& region, const std::size_t size)
+{
+	if (region.first.size() >= size) {
+		region.first = region.first.first(size);
+		region.second = region.second.first(0);
+	} else {
+		region.second = region.second.first(size - region.first.size());
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+AxiDataCaptureGroup::AxiDataCaptureGroup(const std::vector<AxiDataCapture*>& devices)
+: m_devices(devices),
+  m_frame_sizes(devices.size(), 0u),
+  m_skip_bytes(devices.size(), 0u),
+  m_start_offsets(devices.size(), 0),
+  m_trigger_spread_ns(0)
+{
+	if (m_devices.empty()) {
+		throw std::runtime_error("AxiDataCaptureGroup: no devices");
+	}
+	for (std::size_t i=0; i<m_devices.size(); ++i) {
+		const AxiDataCapture&	dev = *m_devices[i];
+		if (dev.sample_rate != m_devices[0]->sample_rate) {
+			throw std::runtime_error(ssprintf("AxiDataCaptureGroup: device %zu samples at %u Hz, device 0 at %u Hz", i, dev.sample_rate, m_devices[0]->sample_rate));
+		}
+		m_frame_sizes[i] = (dev.nchannels * dev.sample_width) / 8u;
+		if (m_frame_sizes[i] == 0) {
+			throw std::runtime_error(ssprintf("AxiDataCaptureGroup: device %zu has an empty frame", i));
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureGroup::start()
+{
+	// Everything slow happens before the first trigger.
+	for (auto dev : m_devices) {
+		dev->armCapture();
+	}
+	const std::uint64_t	t_first = monotonic_ns();
+	for (auto dev : m_devices) {
+		dev->triggerCapture();
+	}
+	m_trigger_spread_ns = monotonic_ns() - t_first;
+
+	std::uint64_t	first = m_devices[0]->getStartTimeAdc();
+	std::uint64_t	last = first;
+	for (auto dev : m_devices) {
+		first = std::min(first, dev->getStartTimeAdc());
+		last = std::max(last, dev->getStartTimeAdc());
+	}
+	for (std::size_t i=0; i<m_devices.size(); ++i) {
+		const std::uint64_t	t = m_devices[i]->getStartTimeAdc();
+		m_start_offsets[i] = static_cast<std::int64_t>(t - first);
+		m_skip_bytes[i] = (last - t) * m_frame_sizes[i];
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureGroup::stop()
+{
+	for (auto dev : m_devices) {
+		dev->stopCapture();
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+bool AxiDataCaptureGroup::_skipLeadingFrames()
+{
+	bool	done = true;
+	for (std::size_t i=0; i<m_devices.size(); ++i) {
+		if (m_skip_bytes[i] > 0) {
+			const std::size_t	size = m_devices[i]->reserve(m_skip_bytes[i]).size();
+			m_devices[i]->release(size);
+			m_skip_bytes[i] -= size;
+			done = done && m_skip_bytes[i] == 0;
+		}
+	}
+	return done;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t AxiDataCaptureGroup::waitForData(const std::size_t nframes, const unsigned int timeout_us)
+{
+	const std::uint64_t	deadline = time_us() + timeout_us;
+	std::size_t			r = nframes;
+
+	// The slowest device determines the wait, the others are ready by then.
+	for (std::size_t i=0; i<m_devices.size(); ++i) {
+		const std::uint64_t	now = time_us();
+		const unsigned int	remaining = now < deadline ? static_cast<unsigned int>(deadline - now) : 0u;
+		const std::size_t	available = m_devices[i]->waitForData(m_skip_bytes[i] + nframes * m_frame_sizes[i], remaining);
+		r = std::min(r, available > m_skip_bytes[i] ? (available - m_skip_bytes[i]) / m_frame_sizes[i] : 0u);
+	}
+	return r;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureGroup::cancelWait()
+{
+	for (auto dev : m_devices) {
+		dev->cancelWait();
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t AxiDataCaptureGroup::reserve(std::vector<AxiDataCapture::Region>& regions, const std::size_t max_frames)
+{
+	regions.assign(m_devices.size(), AxiDataCapture::Region());
+	if (!_skipLeadingFrames()) {
+		return 0;
+	}
+
+	std::size_t	nframes = max_frames;
+	for (std::size_t i=0; i<m_devices.size(); ++i) {
+		const std::size_t	frame_size = m_frame_sizes[i];
+		const std::size_t	max_size = max_frames > SIZE_MAX / frame_size ? SIZE_MAX : max_frames * frame_size;
+		regions[i] = m_devices[i]->reserve(max_size);
+		nframes = std::min(nframes, regions[i].size() / frame_size);
+	}
+	for (std::size_t i=0; i<m_devices.size(); ++i) {
+		trim_region(regions[i], nframes * m_frame_sizes[i]);
+	}
+	return nframes;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void AxiDataCaptureGroup::release(const std::size_t nframes)
+{
+	for (std::size_t i=0; i<m_devices.size(); ++i) {
+		m_devices[i]->release(nframes * m_frame_sizes[i]);
+	}
+}
+
+} // namespace hw
+} // namespace smart
@@ -0,0 +1,115 @@
+/// \file  AxiDataCaptureGroup.h
+/// \brief Interface of the class AxiDataCaptureGroup.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#pragma once
+
+#include <cstddef>		// std::size_t
+#include <cstdint>		// std::int64_t
+#include <vector>		// std::vector
+
+#include "AxiDataCapture.h"
+
+namespace smart {
+namespace hw {
+
+/// \brief Several AXI Data Capture cores started together and read sample-aligned.
+///
+/// #start arms every device first and then triggers them back to back, one register write each.
+/// The trigger times are recorded in sample periods; the devices triggered earlier have a few extra
+/// frames at the start of their streams, which are skipped. From then on the read cursors of all
+/// devices stay aligned: #reserve returns the same number of frames for every device, and frame k
+/// of every region was sampled at the same time.
+///
+/// The alignment assumes that all cores sample with the same clock. It is exact as long as the
+/// trigger time can be measured to better than a sample period; #getTriggerSpreadNs tells how far
+/// apart the triggers were.
+///
+/// Example:
+/// @code
+///	AxiDataCapture		dev0("AXI-Data-Capture-0"), dev1("AXI-Data-Capture-1");
+///	AxiDataCaptureGroup	group({ &dev0, &dev1 });
+///	std::vector<AxiDataCapture::Region>	regions;
+///
+///	group.start();
+///	for (;;) {
+///		group.waitForData(1024, 100000);
+///		const std::size_t nframes = group.reserve(regions, 1024);
+///		process(regions, nframes);
+///		group.release(nframes);
+///	}
+/// @endcode
+class AxiDataCaptureGroup {
+public:
+	/// Create a group of devices. All of them must have the same sample rate.
+	/// \param devices	Devices, not owned; they have to outlive the group.
+	AxiDataCaptureGroup(const std::vector<AxiDataCapture*>& devices);
+
+	/// Number of devices.
+	std::size_t size() const
+	{
+		return m_devices.size();
+	}
+
+	/// Arm all devices, then trigger all of them as close together as possible.
+	void start();
+
+	/// Stop all devices.
+	void stop();
+
+	/// Start offset of every device relative to the first one triggered, in sample periods.
+	const std::vector<std::int64_t>& getStartOffsets() const
+	{
+		return m_start_offsets;
+	}
+
+	/// Time between the first and the last trigger of the last #start, in nanoseconds.
+	std::uint64_t getTriggerSpreadNs() const
+	{
+		return m_trigger_spread_ns;
+	}
+
+	/// Block until at least the given number of aligned frames is available on every device.
+	/// \param nframes		Number of frames to wait for.
+	/// \param timeout_us	Maximum time to wait, in microseconds.
+	/// \return Number of aligned frames available; less than requested on timeout or after #cancelWait.
+	std::size_t waitForData(const std::size_t nframes, const unsigned int timeout_us);
+
+	/// Wake up a waitForData() call blocked in another thread.
+	void cancelWait();
+
+	/// Get the aligned data available on all devices, without copying.
+	/// \param regions		Receives one region per device, in the order of the constructor argument;
+	///						every region holds \c nframes frames of its device.
+	/// \param max_frames	Maximum number of frames to return.
+	/// \return Number of frames, the same for all devices.
+	std::size_t reserve(std::vector<AxiDataCapture::Region>& regions, const std::size_t max_frames = SIZE_MAX);
+
+	/// Advance the read cursors of all devices.
+	/// \param nframes	Number of frames consumed, at most the result of the last #reserve.
+	void release(const std::size_t nframes);
+private:
+	/// Devices.
+	std::vector<AxiDataCapture*>	m_devices;
+
+	/// Bytes per frame, per device.
+	std::vector<std::size_t>		m_frame_sizes;
+
+	/// Bytes still to be skipped at the start of the stream, per device.
+	std::vector<std::size_t>		m_skip_bytes;
+
+	/// Start offsets, in sample periods.
+	std::vector<std::int64_t>		m_start_offsets;
+
+	/// Time between the first and the last trigger.
+	std::uint64_t					m_trigger_spread_ns;
+
+	/// Drop the leading frames of the devices triggered early.
+	/// \return true when all of them have been dropped.
+	bool _skipLeadingFrames();
+};
+
+} // namespace hw
+} // namespace smart
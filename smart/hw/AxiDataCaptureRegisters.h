@@ -0,0 +1,59 @@
+/// \file  AxiDataCaptureRegisters.h
+/// \brief Register map of the AXI Data Capture IP core.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#pragma once
+
+#include "../RegisterMap.h"
+
+namespace smart {
+namespace hw {
+
+/// Register map of the AXI Data Capture IP core, shared by the driver and the emulator.
+namespace AxiDataCaptureRegisters {
+
+/// Registers.
+struct Register {
+	typedef RegisterMap::Register<0>							CONTROL;
+	typedef RegisterMap::Register<1>							START_ADDRESS;
+	typedef RegisterMap::Register<2>							BLOCKS_PER_TRANSFER;
+	typedef RegisterMap::Register<3>							BLOCK_SIZE;
+	typedef RegisterMap::Register<4>							BLOCKS_PER_RING;
+	typedef RegisterMap::Register<5, RegisterMap::ReadOnly>	BLOCKS_TRANSFERRED;
+	typedef RegisterMap::Register<6, RegisterMap::ReadOnly>	CURRENT_BLOCK;
+	typedef RegisterMap::Register<7, RegisterMap::ReadOnly>	CURRENT_ADDRESS;
+	typedef RegisterMap::Register<8, RegisterMap::ReadOnly>	BURST_ERROR_COUNT;
+	typedef RegisterMap::Register<9, RegisterMap::ReadOnly>	BURST_SUCCESS_COUNT;
+};
+
+/// Size of the register file, in 32-bit words.
+constexpr std::uint32_t NREGISTERS = 10;
+
+/// Access to the register file.
+typedef RegisterMap::Block<NREGISTERS>	Registers;
+
+/// Block size, in bytes.
+/// For the Zynq 32-bit the maximum value is 128.
+constexpr unsigned int BLOCK_SIZE = 128u;
+
+/// Fields of the register CONTROL.
+struct Control {
+	/// 0=>1 triggers.
+	typedef RegisterMap::Field<Register::CONTROL, 0, 1>	SOFTTRIGGER;
+
+	/// Tell the internal FIFO to hold the data instead of just ignoring it.
+	/// This has to be set for the duration of the data transfer.
+	typedef RegisterMap::Field<Register::CONTROL, 1, 1>	DATAHOLD;
+};
+
+/// Bits of the register CONTROL.
+enum {
+	BV_CONTROL_SOFTTRIGGER = Control::SOFTTRIGGER::mask,
+	BV_CONTROL_DATAHOLD = Control::DATAHOLD::mask,
+};
+
+} // namespace AxiDataCaptureRegisters
+} // namespace hw
+} // namespace smart
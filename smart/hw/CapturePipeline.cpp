@@ -0,0 +1,332 @@
+/// \file  CapturePipeline.cpp
+/// \brief Implementation of the class CapturePipeline.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#include <algorithm>		// std::min
+#include <cstdlib>			// std::aligned_alloc
+#include <stdexcept>		// std::runtime_error
+
+#include <errno.h>			// errno
+#include <fcntl.h>			// open, O_DIRECT
+#include <string.h>			// memcpy, strerror
+#include <unistd.h>			// write, close
+
+#include "CapturePipeline.h"
+
+#include "../MappedFile.h"	// MappedFile::pageSize
+#include "../string.h"		// ssprintf
+#include "../WavFormat.h"	// WavFormat::makeStreamHeader
+#include "../time.h"		// time_us
+
+namespace smart {
+namespace hw {
+
+/// Maximum time the reader sleeps in one go, in microseconds.
+static constexpr unsigned int READER_WAIT_US = 100u * 1000u;
+
+// --------------------------------------------------------------------------------------------------------------------
+CapturePipeline::CapturePipeline(AxiDataCapture& capture, const std::string& filename, const Options& options)
+: m_capture(capture),
+  m_filename(filename),
+  m_options(options),
+  m_fd(-1),
+  m_header_size(0),
+  m_pool(nullptr),
+  m_fill(std::max(options.buffer_count, 2u), 0u),
+  m_free(std::max(options.buffer_count, 2u)),
+  m_full(std::max(options.buffer_count, 2u) + 1u),	// One more for the end marker.
+  m_free_count(0),
+  m_full_count(0),
+  m_running(false),
+  m_stopping(false),
+  m_bytes_captured(0),
+  m_bytes_written(0),
+  m_buffers_written(0),
+  m_reader_stalls(0),
+  m_max_buffers_queued(0),
+  m_direct_io(false),
+  m_start_time_us(0),
+  m_stop_time_us(0)
+{
+	const std::size_t	page_size = MappedFile::pageSize();
+	m_options.buffer_count = m_fill.size();
+	m_options.buffer_size = std::max<std::size_t>((options.buffer_size + page_size - 1) / page_size, 1u) * page_size;
+	m_pool = reinterpret_cast<std::uint8_t*>(std::aligned_alloc(page_size, m_options.buffer_size * m_options.buffer_count));
+	if (m_pool == nullptr) {
+		throw std::runtime_error(ssprintf("CapturePipeline: cannot allocate %u buffers of %zu bytes", m_options.buffer_count, m_options.buffer_size));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+CapturePipeline::CapturePipeline(AxiDataCapture& capture, const std::string& filename)
+	: CapturePipeline(capture, filename, Options())
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+CapturePipeline::~CapturePipeline()
+{
+	try {
+		stop();
+	} catch (...) {
+		// Nobody to report to.
+	}
+	std::free(m_pool);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void CapturePipeline::start()
+{
+	if (m_reader.joinable()) {
+		throw std::runtime_error("CapturePipeline::start: already running");
+	}
+
+	const int	flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+	m_direct_io = false;
+	if (m_options.direct_io) {
+		m_fd = open(m_filename.c_str(), flags | O_DIRECT, 0644);
+		m_direct_io = m_fd >= 0;
+	}
+	if (m_fd < 0) {
+		m_fd = open(m_filename.c_str(), flags, 0644);
+	}
+	if (m_fd < 0) {
+		throw std::runtime_error(ssprintf("CapturePipeline: cannot open '%s': %s", m_filename.c_str(), strerror(errno)));
+	}
+
+	// A header of one full page keeps the sample data aligned for O_DIRECT.
+	m_header_size = 0;
+	if (m_options.format == Format::WAV) {
+		m_header_size = MappedFile::pageSize();
+		try {
+			_writeWavHeader(0);
+			if (lseek(m_fd, m_header_size, SEEK_SET) < 0) {
+				throw std::runtime_error(ssprintf("CapturePipeline: cannot seek '%s': %s", m_filename.c_str(), strerror(errno)));
+			}
+		} catch (...) {
+			// Nothing runs yet, thus stop() would not close the file.
+			close(m_fd);
+			m_fd = -1;
+			throw;
+		}
+	}
+
+	m_free.clear();
+	m_full.clear();
+	for (unsigned int i=0; i<m_options.buffer_count; ++i) {
+		m_free.push(i);
+		m_free_count.release();
+	}
+	m_error = nullptr;
+	m_bytes_captured = 0;
+	m_bytes_written = 0;
+	m_buffers_written = 0;
+	m_reader_stalls = 0;
+	m_max_buffers_queued = 0;
+	m_stop_time_us = 0;
+	m_start_time_us = time_us();
+
+	m_running = true;
+	m_stopping = false;
+	m_capture.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+	m_writer = std::thread(&CapturePipeline::_writerMain, this);
+	m_reader = std::thread(&CapturePipeline::_readerMain, this);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void CapturePipeline::stop()
+{
+	if (!m_reader.joinable()) {
+		return;
+	}
+	// The reader halts the core and drains the ring; it owns the capture device until it has finished.
+	m_stopping = true;
+	m_capture.cancelWait();
+	m_reader.join();
+	m_running = false;
+	m_writer.join();
+	m_stop_time_us = time_us();
+
+	// Drain the semaphore of the free buffers for the next start().
+	while (m_free_count.try_acquire()) {
+	}
+
+	if (m_options.format == Format::WAV && !m_error) {
+		try {
+			_writeWavHeader(m_bytes_written);
+		} catch (...) {
+			m_error = std::current_exception();
+		}
+	}
+
+	const int	r_close = close(m_fd);
+	m_fd = -1;
+	if (m_error) {
+		std::rethrow_exception(m_error);
+	}
+	if (r_close != 0) {
+		throw std::runtime_error(ssprintf("CapturePipeline: cannot close '%s': %s", m_filename.c_str(), strerror(errno)));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+CapturePipeline::Statistics CapturePipeline::getStatistics() const
+{
+	const std::uint64_t	stop_time = m_stop_time_us.load();
+	Statistics			r;
+	r.bytes_captured = m_bytes_captured;
+	r.bytes_written = m_bytes_written;
+	r.buffers_written = m_buffers_written;
+	r.reader_stalls = m_reader_stalls;
+	r.max_buffers_queued = m_max_buffers_queued;
+	r.direct_io = m_direct_io;
+	r.elapsed_us = m_start_time_us == 0 ? 0 : (stop_time != 0 ? stop_time : time_us()) - m_start_time_us;
+	return r;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void CapturePipeline::_readerMain()
+{
+	// Drain in pieces small enough to keep the DMA ring from running over while a buffer is being filled.
+	const std::size_t	chunk_size = std::max<std::size_t>(m_capture.getBufferSize() / 4u, 1u);
+	const unsigned int	end_marker = m_options.buffer_count;
+	bool				halted = false;
+	bool				drained = false;
+
+	try {
+		while (m_running && !drained) {
+			if (!m_free_count.try_acquire()) {
+				++m_reader_stalls;
+				m_free_count.acquire();
+			}
+			unsigned int	index = 0;
+			m_free.pop(index);
+
+			std::uint8_t*	buffer = &m_pool[index * m_options.buffer_size];
+			std::size_t		fill = 0;
+			while (fill < m_options.buffer_size && m_running && !drained) {
+				// Once the core is halted, the ring holds all there is left.
+				if (m_stopping && !halted) {
+					m_capture.haltCapture();
+					halted = true;
+				}
+				const std::size_t	todo = std::min(m_options.buffer_size - fill, chunk_size);
+				if (!halted) {
+					m_capture.waitForData(todo, READER_WAIT_US);
+				}
+
+				const auto	region = m_capture.reserve(todo);
+				memcpy(&buffer[fill], region.first.data(), region.first.size());
+				memcpy(&buffer[fill + region.first.size()], region.second.data(), region.second.size());
+				m_capture.release(region.size());
+				fill += region.size();
+				m_bytes_captured += region.size();
+				drained = halted && region.size() < todo;
+			}
+
+			m_fill[index] = fill;
+			m_full.push(index);
+			m_full_count.release();
+			m_max_buffers_queued = std::max<unsigned int>(m_max_buffers_queued.load(), m_full.size());
+		}
+	} catch (...) {
+		_fail();
+	}
+	try {
+		m_capture.stopCapture();
+	} catch (...) {
+		_fail();
+	}
+	m_full.push(end_marker);
+	m_full_count.release();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void CapturePipeline::_writerMain()
+{
+	const unsigned int	end_marker = m_options.buffer_count;
+	bool				failed = false;
+
+	for (;;) {
+		m_full_count.acquire();
+		unsigned int	index = end_marker;
+		m_full.pop(index);
+		if (index == end_marker) {
+			break;
+		}
+
+		// After a failure keep on recycling the buffers, the reader would block otherwise.
+		if (!failed) {
+			try {
+				_writeAll(&m_pool[index * m_options.buffer_size], m_fill[index]);
+				m_bytes_written += m_fill[index];
+				++m_buffers_written;
+			} catch (...) {
+				failed = true;
+				_fail();
+			}
+		}
+		m_free.push(index);
+		m_free_count.release();
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void CapturePipeline::_writeAll(const std::uint8_t* data, std::size_t size)
+{
+	// O_DIRECT requires the size to be a multiple of the block size; only the last buffer can be short.
+	if (m_direct_io && size % MappedFile::pageSize() != 0) {
+		const int	flags = fcntl(m_fd, F_GETFL);
+		fcntl(m_fd, F_SETFL, flags & ~O_DIRECT);
+		m_direct_io = false;
+	}
+	while (size > 0) {
+		const ssize_t	r_write = write(m_fd, data, size);
+		if (r_write < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(ssprintf("CapturePipeline: cannot write '%s': %s", m_filename.c_str(), strerror(errno)));
+		}
+		data += r_write;
+		size -= r_write;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void CapturePipeline::_writeWavHeader(const std::uint64_t data_size)
+{
+	std::vector<std::uint8_t>	header;
+	WavFormat::makeStreamHeader(header, m_capture.nchannels, m_capture.sample_width, m_capture.sample_rate, data_size, m_header_size);
+
+	// Go through the pool memory, O_DIRECT needs an aligned buffer.
+	memcpy(m_pool, header.data(), m_header_size);
+	if (pwrite(m_fd, m_pool, m_header_size, 0) != static_cast<ssize_t>(m_header_size)) {
+		throw std::runtime_error(ssprintf("CapturePipeline: cannot write header of '%s': %s", m_filename.c_str(), strerror(errno)));
+	}
+
+	// RIFF chunks are word-aligned. An odd size means a short last buffer, thus O_DIRECT is off by now.
+	if ((data_size & 1u) != 0) {
+		const std::uint8_t	pad = 0;
+		if (pwrite(m_fd, &pad, 1, m_header_size + data_size) != 1) {
+			throw std::runtime_error(ssprintf("CapturePipeline: cannot write '%s': %s", m_filename.c_str(), strerror(errno)));
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void CapturePipeline::_fail()
+{
+	{
+		std::lock_guard<std::mutex>	guard(m_error_mutex);
+		if (!m_error) {
+			m_error = std::current_exception();
+		}
+	}
+	m_running = false;
+}
+
+} // namespace hw
+} // namespace smart
@@ -0,0 +1,193 @@
+/// \file  CapturePipeline.h
+/// \brief Interface of the class CapturePipeline.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#pragma once
+
+#include <atomic>		// std::atomic
+#include <cstddef>		// std::size_t
+#include <cstdint>		// std::uint64_t
+#include <exception>	// std::exception_ptr
+#include <mutex>		// std::mutex
+#include <semaphore>	// std::counting_semaphore
+#include <string>		// std::string
+#include <thread>		// std::thread
+#include <vector>		// std::vector
+
+#include "../SpscRing.h"
+#include "AxiDataCapture.h"
+
+namespace smart {
+namespace hw {
+
+/// \brief Streaming capture from an AxiDataCapture device to a file.
+///
+/// A reader thread drains the DMA ring into a pool of large, page-aligned buffers.
+/// A writer thread writes the filled buffers to the file with large sequential writes,
+/// optionally bypassing the page cache (O_DIRECT).
+/// The DMA ring is thus never blocked by the storage, as long as the pool does not run empty.
+///
+/// The output is either the raw sample stream or a WAV file. A WAV file gets a one-page header with the
+/// channel count, sample width and sample rate of the capture device; the sizes are filled in by #stop.
+/// Captures exceeding 4 GiB are stored as RF64.
+///
+/// Example:
+/// @code
+///	AxiDataCapture		dev(AxiDataCapture::DEFAULT_UIO_NAME);
+///	CapturePipeline		pipeline(dev, "capture.bin");
+///
+///	pipeline.start();
+///	msleep(10 * 1000);
+///	pipeline.stop();
+///	printf("%" PRIu64 " bytes written\n", pipeline.getStatistics().bytes_written);
+/// @endcode
+class CapturePipeline {
+public:
+	/// Output file format.
+	enum class Format {
+		/// Samples only.
+		RAW,
+		/// WAV file, RF64 when exceeding 4 GiB.
+		WAV
+	};
+
+	/// Pipeline configuration.
+	struct Options {
+		/// Output file format.
+		Format			format = Format::RAW;
+
+		/// Size of one buffer, in bytes. Rounded up to the memory page size.
+		std::size_t		buffer_size = 4u * 1024u * 1024u;
+
+		/// Number of buffers in the pool.
+		unsigned int	buffer_count = 8;
+
+		/// Open the output file with O_DIRECT. Falls back to buffered writes when the file system does not support it.
+		bool			direct_io = false;
+	};
+
+	/// Progress and throughput of the pipeline.
+	struct Statistics {
+		/// Bytes taken from the DMA ring.
+		std::uint64_t	bytes_captured;
+
+		/// Bytes written to the file.
+		std::uint64_t	bytes_written;
+
+		/// Number of buffers written.
+		std::uint64_t	buffers_written;
+
+		/// Number of times the reader had to wait for a free buffer, i.e. the storage was too slow.
+		std::uint64_t	reader_stalls;
+
+		/// Maximum number of filled buffers waiting for the writer.
+		unsigned int	max_buffers_queued;
+
+		/// Is the file written with O_DIRECT?
+		bool			direct_io;
+
+		/// Time since start, in microseconds.
+		std::uint64_t	elapsed_us;
+
+		/// Average write throughput, in bytes per second.
+		double write_rate() const
+		{
+			return elapsed_us > 0 ? bytes_written / (elapsed_us * 1e-6) : 0.0;
+		}
+	};
+
+	/// Create the pipeline; nothing is started yet.
+	/// \param capture	Capture device, must outlive the pipeline.
+	/// \param filename	Output file, created or truncated by #start.
+	/// \param options	Buffer configuration.
+	CapturePipeline(AxiDataCapture& capture, const std::string& filename, const Options& options);
+
+	/// Create the pipeline with the default options.
+	CapturePipeline(AxiDataCapture& capture, const std::string& filename);
+
+	/// Stop, if still running.
+	~CapturePipeline();
+
+	/// Open the output file, start the capture in the streaming mode and start both threads.
+	void start();
+
+	/// Stop the capture, write out all captured data and close the file.
+	/// The IP core is halted first, then the data left in the DMA ring is written out, too.
+	/// Rethrows the first error encountered by either thread.
+	void stop();
+
+	/// Get the current statistics. Can be called from any thread.
+	Statistics getStatistics() const;
+
+private:
+	/// Reader thread main loop.
+	void _readerMain();
+
+	/// Writer thread main loop.
+	void _writerMain();
+
+	/// Write the whole buffer to the file.
+	void _writeAll(const std::uint8_t* data, std::size_t size);
+
+	/// Record the first exception and make both threads finish.
+	void _fail();
+
+	/// Write the WAV header for the given amount of sample data at the start of the file.
+	void _writeWavHeader(const std::uint64_t data_size);
+
+	AxiDataCapture&					m_capture;
+	const std::string				m_filename;
+	Options							m_options;
+
+	/// Output file descriptor, -1 when closed.
+	int								m_fd;
+
+	/// Size of the file header, 0 for raw output.
+	std::size_t						m_header_size;
+
+	/// Buffer pool memory, m_options.buffer_count buffers of m_options.buffer_size bytes.
+	std::uint8_t*					m_pool;
+
+	/// Number of valid bytes in each of the buffers.
+	std::vector<std::size_t>		m_fill;
+
+	/// Indices of the buffers ready to be filled, writer to reader.
+	SpscRing<unsigned int>			m_free;
+
+	/// Indices of the buffers ready to be written, reader to writer.
+	SpscRing<unsigned int>			m_full;
+
+	/// Number of entries in m_free.
+	std::counting_semaphore<>		m_free_count;
+
+	/// Number of entries in m_full.
+	std::counting_semaphore<>		m_full_count;
+
+	std::thread						m_reader;
+	std::thread						m_writer;
+
+	/// Set while the reader should keep on reading; cleared on errors.
+	std::atomic_bool				m_running;
+
+	/// Set by #stop: the reader halts the IP core, drains the DMA ring and finishes.
+	std::atomic_bool				m_stopping;
+
+	/// First error encountered by either thread.
+	std::exception_ptr				m_error;
+	std::mutex						m_error_mutex;
+
+	/// Statistics, updated by the threads.
+	std::atomic<std::uint64_t>		m_bytes_captured;
+	std::atomic<std::uint64_t>		m_bytes_written;
+	std::atomic<std::uint64_t>		m_buffers_written;
+	std::atomic<std::uint64_t>		m_reader_stalls;
+	std::atomic_uint				m_max_buffers_queued;
+	std::atomic_bool				m_direct_io;
+	std::uint64_t					m_start_time_us;
+	std::atomic<std::uint64_t>		m_stop_time_us;
+};
+
+} // namespace hw
+} // namespace smart
@@ -0,0 +1,354 @@
+/// \file  FlightRecorder.cpp
+/// \brief Implementation of the class FlightRecorder.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#include <algorithm>		// std::min
+#include <cmath>			// std::llround
+#include <stdexcept>		// std::runtime_error
+
+#include <string.h>			// memcpy
+
+#include "FlightRecorder.h"
+
+#include "../Interleave.h"	// Interleave::deinterleave
+#include "../string.h"		// ssprintf
+#include "../WavFormat.h"	// WavFormat::writeFile
+
+namespace smart {
+namespace hw {
+
+/// Maximum time the reader sleeps in one go, in microseconds.
+static constexpr unsigned int READER_WAIT_US = 100u * 1000u;
+
+/// Largest chunk scanned at once, in bytes; keeps the channel buffers in the cache.
+static constexpr std::size_t MAX_CHUNK_SIZE = 256u * 1024u;
+
+// --------------------------------------------------------------------------------------------------------------------
+static std::size_t frames_of_seconds(const double seconds, const unsigned int sample_rate)
+{
+	return seconds <= 0.0 ? 0u : static_cast<std::size_t>(std::llround(seconds * sample_rate));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+FlightRecorder::FlightRecorder(AxiDataCapture& capture, const std::vector<ChannelTrigger>& triggers, const Options& options)
+: m_capture(capture),
+  m_triggers(triggers),
+  m_options(options),
+  m_sample_size(capture.sample_width / 8u),
+  m_frame_size(capture.nchannels * (capture.sample_width / 8u)),
+  m_pre_frames(frames_of_seconds(options.pre_trigger_seconds, capture.sample_rate)),
+  m_post_frames(std::max<std::size_t>(frames_of_seconds(options.post_trigger_seconds, capture.sample_rate), 1u)),
+  m_chunk_frames(m_frame_size == 0 ? 1u : std::max<std::size_t>(std::min(capture.getBufferSize() / 4u, MAX_CHUNK_SIZE) / m_frame_size, 1u)),
+  m_history_frames(m_pre_frames + m_chunk_frames),
+  m_previous(triggers.size(), 0),
+  m_frame_count(0),
+  m_queue_count(0),
+  m_frames_scanned(0),
+  m_events_detected(0),
+  m_running(false)
+{
+	if (capture.sample_width != 16 && capture.sample_width != 32) {
+		throw std::runtime_error(ssprintf("FlightRecorder: %u-bit samples are not supported, only 16 and 32 bits", capture.sample_width));
+	}
+	if (m_triggers.empty()) {
+		throw std::runtime_error("FlightRecorder: no triggers");
+	}
+	for (const auto& t : m_triggers) {
+		if (t.channel >= capture.nchannels) {
+			throw std::runtime_error(ssprintf("FlightRecorder: trigger on channel %u, the device has %u channels", t.channel, capture.nchannels));
+		}
+	}
+	m_history.resize(m_history_frames * m_frame_size);
+	m_planes.resize(m_chunk_frames * m_frame_size);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+FlightRecorder::FlightRecorder(AxiDataCapture& capture, const std::vector<ChannelTrigger>& triggers)
+	: FlightRecorder(capture, triggers, Options())
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+FlightRecorder::~FlightRecorder()
+{
+	try {
+		stop();
+	} catch (...) {
+		// Nobody to report to.
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::start()
+{
+	if (m_reader.joinable()) {
+		throw std::runtime_error("FlightRecorder::start: already running");
+	}
+	m_error = nullptr;
+	m_frame_count = 0;
+	m_recording.reset();
+	m_running = true;
+	m_capture.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+	m_writer = std::thread(&FlightRecorder::_writerMain, this);
+	m_reader = std::thread(&FlightRecorder::_readerMain, this);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::stop()
+{
+	if (!m_reader.joinable()) {
+		return;
+	}
+	m_running = false;
+	m_capture.cancelWait();
+	m_reader.join();
+	m_capture.stopCapture();
+
+	// The event in progress is written as far as it got.
+	if (m_recording) {
+		_finishRecording();
+	}
+	m_queue.push(nullptr);
+	m_queue_count.release();
+	m_writer.join();
+
+	if (m_error) {
+		std::rethrow_exception(m_error);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::process(const std::uint8_t* frames, const std::size_t nframes)
+{
+	for (std::size_t done = 0; done < nframes; ) {
+		const std::size_t	n = std::min(nframes - done, m_chunk_frames);
+		_processChunk(&frames[done * m_frame_size], n);
+		done += n;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::flush()
+{
+	if (m_recording) {
+		_finishRecording();
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::vector<FlightRecorder::Event> FlightRecorder::getEvents() const
+{
+	std::lock_guard<std::mutex>	guard(m_events_mutex);
+	return m_events;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+FlightRecorder::Statistics FlightRecorder::getStatistics() const
+{
+	Statistics	r;
+	r.frames_scanned = m_frames_scanned;
+	r.events_detected = m_events_detected;
+	{
+		std::lock_guard<std::mutex>	guard(m_events_mutex);
+		r.events_written = m_events.size();
+	}
+	return r;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::int32_t FlightRecorder::_sample(const std::uint8_t* frame, const unsigned int channel) const
+{
+	if (m_sample_size == 2) {
+		std::int16_t	x;
+		memcpy(&x, &frame[channel * 2u], sizeof(x));
+		return x;
+	}
+	std::int32_t	x;
+	memcpy(&x, &frame[channel * 4u], sizeof(x));
+	return x;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::_copyHistory(std::uint8_t* dst, const std::uint64_t first_frame, const std::size_t nframes) const
+{
+	for (std::size_t done = 0; done < nframes; ) {
+		const std::size_t	index = (first_frame + done) % m_history_frames;
+		const std::size_t	n = std::min(nframes - done, m_history_frames - index);
+		memcpy(&dst[done * m_frame_size], &m_history[index * m_frame_size], n * m_frame_size);
+		done += n;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::size_t FlightRecorder::_scan(const std::uint8_t* frames, const std::size_t nframes, const std::uint8_t* previous_frame, unsigned int& trigger_index)
+{
+	const unsigned int	nchannels = m_capture.nchannels;
+	const std::size_t	plane_size = nframes * m_sample_size;
+	std::vector<void*>	channels(nchannels);
+	for (unsigned int c=0; c<nchannels; ++c) {
+		channels[c] = &m_planes[c * plane_size];
+	}
+	Interleave::deinterleave(channels.data(), frames, nchannels, m_sample_size, nframes);
+
+	std::size_t	r = nframes;
+	for (unsigned int t=0; t<m_triggers.size(); ++t) {
+		const ChannelTrigger&	trigger = m_triggers[t];
+		const std::int32_t		previous = previous_frame == nullptr ? m_previous[t] : _sample(previous_frame, trigger.channel);
+		// Only the part before the best hit so far needs to be searched.
+		std::size_t				hit;
+		if (m_sample_size == 2) {
+			hit = Trigger::findFirst(reinterpret_cast<const std::int16_t*>(channels[trigger.channel]), r, static_cast<std::int16_t>(previous), trigger.condition);
+		} else {
+			hit = Trigger::findFirst(reinterpret_cast<const std::int32_t*>(channels[trigger.channel]), r, previous, trigger.condition);
+		}
+		if (hit < r) {
+			r = hit;
+			trigger_index = t;
+		}
+	}
+	return r;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::_processChunk(const std::uint8_t* frames, const std::size_t nframes)
+{
+	if (nframes == 0) {
+		return;
+	}
+
+	// Into the history first, the pre-trigger part of an event in this chunk is taken from there.
+	const std::uint64_t	chunk_start = m_frame_count;
+	for (std::size_t done = 0; done < nframes; ) {
+		const std::size_t	index = (chunk_start + done) % m_history_frames;
+		const std::size_t	n = std::min(nframes - done, m_history_frames - index);
+		memcpy(&m_history[index * m_frame_size], &frames[done * m_frame_size], n * m_frame_size);
+		done += n;
+	}
+
+	std::size_t	pos = 0;
+	while (pos < nframes) {
+		if (m_recording) {
+			Event&				event = m_recording->event;
+			const std::size_t	total = m_recording->data.size() / m_frame_size;
+			const std::size_t	n = std::min<std::size_t>(total - event.nframes, nframes - pos);
+			memcpy(&m_recording->data[event.nframes * m_frame_size], &frames[pos * m_frame_size], n * m_frame_size);
+			event.nframes += n;
+			pos += n;
+			if (event.nframes == total) {
+				_finishRecording();
+			}
+			continue;
+		}
+
+		unsigned int		trigger_index = 0;
+		const std::size_t	hit = _scan(&frames[pos * m_frame_size], nframes - pos, pos == 0 ? nullptr : &frames[(pos - 1) * m_frame_size], trigger_index);
+		m_frames_scanned += hit == nframes - pos ? hit : hit + 1;
+		if (hit == nframes - pos) {
+			break;
+		}
+
+		const std::uint64_t	trigger_frame = chunk_start + pos + hit;
+		const std::size_t	npre = std::min<std::uint64_t>(m_pre_frames, trigger_frame);
+		auto				recording = std::make_shared<Recording>();
+		recording->event.number = m_events_detected++;
+		recording->event.trigger_frame = trigger_frame;
+		recording->event.trigger_index = trigger_index;
+		recording->event.first_frame = trigger_frame - npre;
+		recording->event.nframes = npre;
+		recording->event.filename = ssprintf("%s%06u.wav", m_options.path_prefix.c_str(), recording->event.number);
+		recording->data.resize((npre + m_post_frames) * m_frame_size);
+		_copyHistory(recording->data.data(), trigger_frame - npre, npre);
+		m_recording = recording;
+		pos += hit;
+	}
+
+	const std::uint8_t*	last_frame = &frames[(nframes - 1) * m_frame_size];
+	for (unsigned int t=0; t<m_triggers.size(); ++t) {
+		m_previous[t] = _sample(last_frame, m_triggers[t].channel);
+	}
+	m_frame_count += nframes;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::_finishRecording()
+{
+	std::shared_ptr<Recording>	recording;
+	recording.swap(m_recording);
+	recording->data.resize(recording->event.nframes * m_frame_size);
+	if (m_writer.joinable()) {
+		m_queue.push(recording);
+		m_queue_count.release();
+	} else {
+		_write(*recording);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::_write(const Recording& recording)
+{
+	WavFormat::writeFile(recording.event.filename, m_capture.nchannels, m_capture.sample_width, m_capture.sample_rate,
+		recording.data.data(), recording.data.size());
+	std::lock_guard<std::mutex>	guard(m_events_mutex);
+	m_events.push_back(recording.event);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::_readerMain()
+{
+	const std::size_t			chunk_size = m_chunk_frames * m_frame_size;
+	std::vector<std::uint8_t>	chunk(chunk_size);
+
+	try {
+		while (m_running) {
+			m_capture.waitForData(chunk_size, READER_WAIT_US);
+
+			// Whole frames only, the rest stays in the ring.
+			const auto			region = m_capture.reserve(chunk_size);
+			const std::size_t	nframes = region.size() / m_frame_size;
+			const std::size_t	size = nframes * m_frame_size;
+			const std::size_t	size1 = std::min(size, region.first.size());
+			memcpy(&chunk[0], region.first.data(), size1);
+			memcpy(&chunk[size1], region.second.data(), size - size1);
+			m_capture.release(size);
+
+			_processChunk(chunk.data(), nframes);
+		}
+	} catch (...) {
+		_fail();
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::_writerMain()
+{
+	for (;;) {
+		m_queue_count.acquire();
+		std::shared_ptr<Recording>	recording;
+		m_queue.pop(recording);
+		if (!recording) {
+			break;
+		}
+		try {
+			_write(*recording);
+		} catch (...) {
+			_fail();
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void FlightRecorder::_fail()
+{
+	{
+		std::lock_guard<std::mutex>	guard(m_error_mutex);
+		if (!m_error) {
+			m_error = std::current_exception();
+		}
+	}
+	m_running = false;
+}
+
+} // namespace hw
+} // namespace smart
@@ -0,0 +1,222 @@
+/// \file  FlightRecorder.h
+/// \brief Interface of the class FlightRecorder.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+#pragma once
+
+#include <atomic>		// std::atomic
+#include <cstddef>		// std::size_t
+#include <cstdint>		// std::uint64_t
+#include <exception>	// std::exception_ptr
+#include <memory>		// std::shared_ptr
+#include <mutex>		// std::mutex
+#include <semaphore>	// std::counting_semaphore
+#include <string>		// std::string
+#include <thread>		// std::thread
+#include <vector>		// std::vector
+
+#include "../Trigger.h"
+#include "../ts/Queue.h"
+#include "AxiDataCapture.h"
+
+namespace smart {
+namespace hw {
+
+/// \brief Event recording from an AxiDataCapture device with software triggers.
+///
+/// The streaming data is scanned as it arrives: every chunk is split into channels with
+/// Interleave::deinterleave and the trigger conditions are evaluated with the vector kernels of Trigger.
+/// The last #Options::pre_trigger_seconds of data are kept in a history ring. When a condition is met,
+/// the history and the following #Options::post_trigger_seconds are written to a WAV file by a writer
+/// thread; nothing else is stored.
+///
+/// Samples are signed, 16 or 32 bits wide. Conditions found while an event is being recorded extend nothing;
+/// the triggers are re-armed once the post-trigger time has been recorded.
+///
+/// Example:
+/// @code
+///	AxiDataCapture		dev(AxiDataCapture::DEFAULT_UIO_NAME);
+///	FlightRecorder		recorder(dev, { { 0, Trigger::Condition::rising(10000) } });
+///
+///	recorder.start();
+///	msleep(3600 * 1000);
+///	recorder.stop();
+/// @endcode
+class FlightRecorder {
+public:
+	/// Condition on one channel.
+	struct ChannelTrigger {
+		/// Channel index.
+		unsigned int		channel;
+
+		/// Condition.
+		Trigger::Condition	condition;
+	};
+
+	/// Recording options.
+	struct Options {
+		/// Time recorded before the trigger, in seconds.
+		double			pre_trigger_seconds = 1.0;
+
+		/// Time recorded from the trigger on, in seconds.
+		double			post_trigger_seconds = 1.0;
+
+		/// The event files are named <path_prefix>NNNNNN.wav, NNNNNN being the event number.
+		std::string		path_prefix = "event-";
+	};
+
+	/// Recorded event.
+	struct Event {
+		/// Event number, from 0.
+		unsigned int	number;
+
+		/// Frame of the trigger, counted from the start of the recording.
+		std::uint64_t	trigger_frame;
+
+		/// Index of the trigger in the constructor argument.
+		unsigned int	trigger_index;
+
+		/// First frame in the file.
+		std::uint64_t	first_frame;
+
+		/// Number of frames in the file.
+		std::uint64_t	nframes;
+
+		/// Name of the file.
+		std::string		filename;
+	};
+
+	/// Statistics.
+	struct Statistics {
+		/// Frames scanned by the triggers.
+		std::uint64_t	frames_scanned;
+
+		/// Events detected.
+		unsigned int	events_detected;
+
+		/// Event files written.
+		unsigned int	events_written;
+	};
+
+	/// Set up a recorder; nothing is started yet.
+	/// \param capture	Capture device, not owned.
+	/// \param triggers	Trigger conditions; any of them starts an event.
+	/// \param options	Options.
+	FlightRecorder(AxiDataCapture& capture, const std::vector<ChannelTrigger>& triggers, const Options& options);
+
+	/// Set up a recorder with the default options.
+	FlightRecorder(AxiDataCapture& capture, const std::vector<ChannelTrigger>& triggers);
+
+	/// Stops the recording.
+	~FlightRecorder();
+
+	/// Start the capture and the reader and writer threads.
+	void start();
+
+	/// Stop the capture, write the event in progress and wait for the writer.
+	/// Rethrows the first error of the threads.
+	void stop();
+
+	/// Scan and record the given frames, as the reader thread does with the captured data.
+	/// For offline processing; must not be used while started.
+	/// \param frames	Interleaved frames.
+	/// \param nframes	Number of frames.
+	void process(const std::uint8_t* frames, const std::size_t nframes);
+
+	/// Write the event in progress, if any, and wait until all events are written.
+	/// For offline processing; must not be used while started.
+	void flush();
+
+	/// Events written so far.
+	std::vector<Event> getEvents() const;
+
+	/// Statistics.
+	Statistics getStatistics() const;
+private:
+	/// Event being recorded or waiting for the writer.
+	struct Recording {
+		Event						event;
+		std::vector<std::uint8_t>	data;
+	};
+
+	AxiDataCapture&					m_capture;
+	const std::vector<ChannelTrigger>	m_triggers;
+	const Options					m_options;
+
+	/// Bytes per sample and per frame.
+	const unsigned int				m_sample_size;
+	const unsigned int				m_frame_size;
+
+	/// Frames before and after the trigger.
+	const std::size_t				m_pre_frames;
+	const std::size_t				m_post_frames;
+
+	/// Frames per scan.
+	const std::size_t				m_chunk_frames;
+
+	/// History ring, m_history_frames frames; frame f is stored at f % m_history_frames.
+	std::vector<std::uint8_t>		m_history;
+	const std::size_t				m_history_frames;
+
+	/// Channels of the chunk being scanned.
+	std::vector<std::uint8_t>		m_planes;
+
+	/// Last sample of every triggered channel in the previous chunk, for the edge conditions.
+	std::vector<std::int32_t>		m_previous;
+
+	/// Frames processed so far.
+	std::uint64_t					m_frame_count;
+
+	/// Event being recorded, null when armed.
+	std::shared_ptr<Recording>		m_recording;
+
+	/// Events for the writer; null ends the writer.
+	ts::Queue<std::shared_ptr<Recording>>	m_queue;
+	std::counting_semaphore<>		m_queue_count;
+
+	/// Events written.
+	std::vector<Event>				m_events;
+	mutable std::mutex				m_events_mutex;
+
+	std::atomic<std::uint64_t>		m_frames_scanned;
+	std::atomic<unsigned int>		m_events_detected;
+
+	std::thread						m_reader;
+	std::thread						m_writer;
+	std::atomic<bool>				m_running;
+
+	/// First error of the threads.
+	std::exception_ptr				m_error;
+	std::mutex						m_error_mutex;
+
+	/// Copy frames out of the history ring.
+	void _copyHistory(std::uint8_t* dst, const std::uint64_t first_frame, const std::size_t nframes) const;
+
+	/// Scan and record at most m_chunk_frames frames.
+	void _processChunk(const std::uint8_t* frames, const std::size_t nframes);
+
+	/// Scan frames for the first trigger condition met.
+	/// \param previous_frame	Frame preceding the frames, null for the last frame of the previous chunk.
+	/// \return Index of the first hit, nframes if none.
+	std::size_t _scan(const std::uint8_t* frames, const std::size_t nframes, const std::uint8_t* previous_frame, unsigned int& trigger_index);
+
+	/// Sign-extended sample of a channel in a frame.
+	std::int32_t _sample(const std::uint8_t* frame, const unsigned int channel) const;
+
+	/// Hand the recording over to the writer, or write it right away when there is no writer thread.
+	void _finishRecording();
+
+	/// Write the WAV file of a recording.
+	void _write(const Recording& recording);
+
+	void _readerMain();
+	void _writerMain();
+
+	/// Record the current exception and stop.
+	void _fail();
+};
+
+} // namespace hw
+} // namespace smart
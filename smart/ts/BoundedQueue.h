@@ -0,0 +1,239 @@
+/// \file  BoundedQueue.h
+/// \brief	Interface and implementation of the class BoundedQueue.
+///
+/// \version 	1.0
+/// \date		2017
+/// \copyright	SPDX: BSD-3-Clause 2016-2017 Trenz Electronic GmbH
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+
+namespace smart {
+namespace ts {
+
+/**
+ * Bounded lock-free FIFO for any number of producer and consumer threads.
+ *
+ * Every slot carries a sequence number telling whether it is free for the push of a given round or holds
+ * the element of a given round (D. Vyukov's bounded MPMC queue). A push or a pop claims its position
+ * with one compare-and-swap and publishes the slot with one store; nothing is allocated after construction.
+ * Elements are moved in and out, thus move-only types work.
+ *
+ * The blocking #push and #pop spin for a short while, then sleep on the sequence number of the slot;
+ * the try variants pay for a wake-up call only while some thread sleeps.
+ */
+template<class T>
+class BoundedQueue
+{
+public:
+	/**
+	 * Create an empty queue.
+	 * The capacity is rounded up to a power of 2, at least 2.
+	 */
+	explicit BoundedQueue( const std::size_t capacity )
+	: _capacity(round_up_pow2(capacity)),
+	  _mask(_capacity - 1u),
+	  _slots(new Slot[_capacity])
+	{
+		for( std::size_t i = 0; i < _capacity; ++i )
+			_slots[i].sequence.store(i, std::memory_order_relaxed);
+		_push_position.store(0u, std::memory_order_relaxed);
+		_pop_position.store(0u, std::memory_order_relaxed);
+		_sleepers.store(0u, std::memory_order_relaxed);
+	}
+
+	BoundedQueue( const BoundedQueue& ) = delete;
+	BoundedQueue& operator=( const BoundedQueue& ) = delete;
+
+	/**
+	 * Destroy the elements left.
+	 */
+	~BoundedQueue(){
+		const std::size_t	push_position = _push_position.load(std::memory_order_relaxed);
+		for( std::size_t position = _pop_position.load(std::memory_order_relaxed); position != push_position; ++position )
+			std::launder(reinterpret_cast<T*>(_slots[position & _mask].storage))->~T();
+	}
+
+	/**
+	 * Construct an element in place at the end of the queue.
+	 *
+	 * returns false when the queue is full.
+	 */
+	template<class... ARGS>
+	bool try_emplace( ARGS&&... args ){
+		std::size_t	position = _push_position.load(std::memory_order_relaxed);
+		Slot*		slot;
+		for( ;; ){
+			slot = &_slots[position & _mask];
+			const std::size_t		sequence = slot->sequence.load(std::memory_order_acquire);
+			const std::intptr_t		diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+			if( diff == 0 ){
+				if( _push_position.compare_exchange_weak(position, position + 1u, std::memory_order_relaxed) )
+					break;
+			} else if( diff < 0 ){
+				return false;
+			} else {
+				position = _push_position.load(std::memory_order_relaxed);
+			}
+		}
+		new (slot->storage) T(std::forward<ARGS>(args)...);
+		publish(*slot, position + 1u);
+		return true;
+	}
+
+	/**
+	 * Push an element, moving it.
+	 *
+	 * returns false when the queue is full; the element is left alone then.
+	 */
+	bool try_push( T&& element ){
+		return try_emplace(std::move(element));
+	}
+
+	/**
+	 * Push a copy of an element.
+	 *
+	 * returns false when the queue is full.
+	 */
+	bool try_push( const T& element ){
+		return try_emplace(element);
+	}
+
+	/**
+	 * Pop the front element, moving it into element.
+	 *
+	 * returns false when the queue is empty.
+	 */
+	bool try_pop( T& element ){
+		std::size_t	position = _pop_position.load(std::memory_order_relaxed);
+		Slot*		slot;
+		for( ;; ){
+			slot = &_slots[position & _mask];
+			const std::size_t		sequence = slot->sequence.load(std::memory_order_acquire);
+			const std::intptr_t		diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1u);
+			if( diff == 0 ){
+				if( _pop_position.compare_exchange_weak(position, position + 1u, std::memory_order_relaxed) )
+					break;
+			} else if( diff < 0 ){
+				return false;
+			} else {
+				position = _pop_position.load(std::memory_order_relaxed);
+			}
+		}
+		T*	stored = std::launder(reinterpret_cast<T*>(slot->storage));
+		element = std::move(*stored);
+		stored->~T();
+		publish(*slot, position + _capacity);
+		return true;
+	}
+
+	/**
+	 * Push an element, waiting while the queue is full.
+	 */
+	void push( T element ){
+		for( unsigned int spins = 0; !try_push(std::move(element)); ++spins ){
+			if( spins < SPIN_COUNT )
+				continue;
+			// Sleep until the slot to be pushed to changes.
+			const std::size_t	position = _push_position.load(std::memory_order_relaxed);
+			Slot&				slot = _slots[position & _mask];
+			const std::size_t	sequence = slot.sequence.load(std::memory_order_acquire);
+			if( static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position) < 0 )
+				sleep(slot, sequence);
+		}
+	}
+
+	/**
+	 * Pop the front element, waiting while the queue is empty.
+	 */
+	void pop( T& element ){
+		for( unsigned int spins = 0; !try_pop(element); ++spins ){
+			if( spins < SPIN_COUNT )
+				continue;
+			// Sleep until the slot to be popped from changes.
+			const std::size_t	position = _pop_position.load(std::memory_order_relaxed);
+			Slot&				slot = _slots[position & _mask];
+			const std::size_t	sequence = slot.sequence.load(std::memory_order_acquire);
+			if( static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1u) < 0 )
+				sleep(slot, sequence);
+		}
+	}
+
+	/**
+	 * Get the number of elements, a snapshot while other threads work on the queue.
+	 */
+	std::size_t size() const {
+		const std::size_t	pop_position = _pop_position.load(std::memory_order_acquire);
+		const std::size_t	push_position = _push_position.load(std::memory_order_acquire);
+		return push_position > pop_position ? push_position - pop_position : 0u;
+	}
+
+	/**
+	 * Get the maximum number of elements.
+	 */
+	std::size_t capacity() const {
+		return _capacity;
+	}
+
+private:
+	/// Failed attempts of #push and #pop before they sleep.
+	static constexpr unsigned int	SPIN_COUNT = 64u;
+
+	/// Size of the cache line the positions are kept apart by.
+	static constexpr std::size_t	CACHE_LINE_SIZE = 64u;
+
+	/// An element and its state.
+	struct Slot {
+		/// position: free for the push at position; position + 1: holds the element pushed at position.
+		std::atomic<std::size_t>	sequence;
+		/// the element, when holding one
+		alignas(T) unsigned char	storage[sizeof(T)];
+	};
+
+	/// Store the new sequence number of a slot, waking the threads sleeping on it, if any.
+	void publish( Slot& slot, const std::size_t sequence ){
+		// Sequentially consistent, thus either the sleeper sees the new sequence or we see the sleeper.
+		slot.sequence.store(sequence, std::memory_order_seq_cst);
+		if( _sleepers.load(std::memory_order_seq_cst) != 0u )
+			slot.sequence.notify_all();
+	}
+
+	/// Sleep while the sequence number of a slot is still sequence.
+	void sleep( Slot& slot, const std::size_t sequence ){
+		_sleepers.fetch_add(1u, std::memory_order_seq_cst);
+		if( slot.sequence.load(std::memory_order_seq_cst) == sequence )
+			slot.sequence.wait(sequence, std::memory_order_acquire);
+		_sleepers.fetch_sub(1u, std::memory_order_relaxed);
+	}
+
+	static std::size_t round_up_pow2( const std::size_t n ){
+		std::size_t	r = 2u;
+		while( r < n )
+			r <<= 1;
+		return r;
+	}
+
+	/// number of slots, a power of 2
+	const std::size_t						_capacity;
+	/// _capacity - 1
+	const std::size_t						_mask;
+	/// the slots
+	const std::unique_ptr<Slot[]>			_slots;
+	/// position of the next push, on a cache line of its own
+	alignas(CACHE_LINE_SIZE) std::atomic<std::size_t>	_push_position;
+	/// position of the next pop, on a cache line of its own
+	alignas(CACHE_LINE_SIZE) std::atomic<std::size_t>	_pop_position;
+	/// number of threads in #sleep, on a cache line of its own
+	alignas(CACHE_LINE_SIZE) std::atomic<unsigned int>	_sleepers;
+};
+
+} // namespace ts
+
+} // namespace smart
@@ -0,0 +1,409 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/hw/AxiDataCapture.h>
+#include <smart/hw/AxiDataCaptureEmulator.h>
+#include <smart/hw/CapturePipeline.h>
+#include <smart/time.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+
+using smart::hw::AxiDataCapture;
+using smart::hw::AxiDataCaptureEmulator;
+
+namespace {
+
+// Copy a region out and check that it continues the counter pattern.
+void check_counter(const AxiDataCapture::Region& region, uint32_t& next_word) {
+    std::vector<uint8_t> data(region.first.begin(), region.first.end());
+    data.insert(data.end(), region.second.begin(), region.second.end());
+    REQUIRE(data.size() % 4 == 0);
+    for (size_t i = 0; i < data.size(); i += 4) {
+        uint32_t word;
+        memcpy(&word, &data[i], sizeof(word));
+        REQUIRE(word == next_word);
+        ++next_word;
+    }
+}
+
+AxiDataCaptureEmulator::Options small_ring() {
+    AxiDataCaptureEmulator::Options options;
+    options.buffer_size = 64 * 1024;
+    return options;
+}
+
+} // namespace
+
+TEST_CASE("emulated device exposes configuration and maps", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+
+    REQUIRE(dev.nchannels == 2);
+    REQUIRE(dev.sample_width == 16);
+    REQUIRE(dev.sample_rate == 48000);
+    REQUIRE(dev.getBufferSize() == 64 * 1024);
+}
+
+TEST_CASE("nothing is produced before the trigger", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+
+    REQUIRE(emulator.advance(4096) == 0);
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+    REQUIRE(emulator.advance(4096) == 4096);
+    REQUIRE(dev.reserve().size() == 4096);
+}
+
+TEST_CASE("reserve/release follow the ring across the wrap", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+
+    uint32_t next_word = 0;
+    bool wrapped = false;
+    for (int round = 0; round < 20; ++round) {
+        emulator.advance(24 * 1024);
+        const auto region = dev.reserve();
+        REQUIRE(region.size() == 24 * 1024);
+        wrapped = wrapped || !region.second.empty();
+        check_counter(region, next_word);
+        dev.release(region.size());
+    }
+    REQUIRE(wrapped);
+    REQUIRE(dev.getLossCounters().overruns == 0);
+    REQUIRE(dev.reserve().size() == 0);
+    REQUIRE_THROWS(dev.release(1));
+}
+
+TEST_CASE("capture into a block of a DMA arena", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    smart::DmaArena arena(*emulator.getDevice(), 1);
+    const auto first = arena.allocate(16 * 1024, 4096);
+    const auto ring = arena.allocate(32 * 1024, 4096);
+    memset(first.data, 0xA5, first.size);
+
+    AxiDataCapture dev(emulator.getDevice(), ring);
+    REQUIRE(dev.getBufferSize() == 32 * 1024);
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+
+    uint32_t next_word = 0;
+    bool wrapped = false;
+    for (int round = 0; round < 6; ++round) {
+        emulator.advance(12 * 1024);
+        const auto region = dev.reserve();
+        REQUIRE(region.size() == 12 * 1024);
+        REQUIRE(region.first.data() >= static_cast<uint8_t*>(ring.data));
+        REQUIRE(region.first.data() + region.first.size() <= static_cast<uint8_t*>(ring.data) + ring.size);
+        wrapped = wrapped || !region.second.empty();
+        check_counter(region, next_word);
+        dev.release(region.size());
+    }
+    REQUIRE(wrapped);
+    const auto* untouched = static_cast<const uint8_t*>(first.data);
+    REQUIRE(std::all_of(untouched, untouched + first.size, [](uint8_t b) { return b == 0xA5; }));
+
+    smart::DmaArena::Block odd = ring;
+    odd.size = 1000;
+    REQUIRE_THROWS_AS(AxiDataCapture(emulator.getDevice(), odd), std::runtime_error);
+}
+
+TEST_CASE("fetchPacket copies packets split by the wrap", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+
+    std::vector<uint8_t> packet_buffer(10000);
+    uint32_t next_word = 0;
+    for (int round = 0; round < 30; ++round) {
+        emulator.advance(10240);
+        for (;;) {
+            const void* packet = dev.fetchPacket(packet_buffer.data(), 4000);
+            if (packet == nullptr) {
+                break;
+            }
+            AxiDataCapture::Region region;
+            region.first = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(packet), 4000);
+            check_counter(region, next_word);
+        }
+    }
+    REQUIRE(next_word == 30 * 10240 / 4000 * 1000);
+}
+
+TEST_CASE("fetchPackets copies whole packets across the wrap", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+
+    struct Packet {
+        uint32_t words[3];
+    };
+    std::vector<Packet> packets(1000);
+    uint32_t next_word = 0;
+    size_t total = 0;
+    for (int round = 0; round < 30; ++round) {
+        emulator.advance(10240);
+        const auto got = dev.fetchPackets(std::span<Packet>(packets));
+        REQUIRE(got.size() <= 10240 * 2 / sizeof(Packet));
+        for (const Packet& packet : got) {
+            for (const uint32_t word : packet.words) {
+                REQUIRE(word == next_word);
+                ++next_word;
+            }
+        }
+        total += got.size();
+    }
+    REQUIRE(total == 30 * 10240 / sizeof(Packet));
+    REQUIRE(dev.fetchPackets(packets.data(), 0) == 0);
+}
+
+TEST_CASE("head caching reads the head again only when the cache is exhausted", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+
+    std::vector<uint8_t> packets(64 * 1024);
+    emulator.advance(4096);
+    REQUIRE(dev.fetchPackets(packets.data(), 1024, 1) == 1);
+    emulator.advance(4096);
+
+    SECTION("cached") {
+        dev.setHeadCaching(true);
+        REQUIRE(dev.fetchPackets(packets.data(), 1024, 100) == 3);
+        // Served from the cache: not counted, not timed.
+        REQUIRE(dev.getTelemetry().fetches == 1);
+        REQUIRE(dev.fetchPackets(packets.data(), 1024, 100) == 4);
+        REQUIRE(dev.getTelemetry().fetches == 2);
+    }
+    SECTION("uncached") {
+        REQUIRE(dev.fetchPackets(packets.data(), 1024, 100) == 7);
+    }
+    REQUIRE(dev.fetchPackets(packets.data(), 1024, 100) == 0);
+}
+
+TEST_CASE("overruns are detected", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+
+    SECTION("RESYNC skips to the head") {
+        emulator.advance(48 * 1024);
+        emulator.advance(48 * 1024);
+        REQUIRE(dev.reserve().size() == 0);
+        const auto loss = dev.getLossCounters();
+        REQUIRE(loss.overruns == 1);
+        // 32 KiB overwritten, and the block the DMA engine writes next.
+        REQUIRE(loss.bytes_lost == 32 * 1024 + 128);
+
+        // Continues with fresh data.
+        emulator.advance(1024);
+        uint32_t next_word = 96 * 1024 / 4;
+        const auto region = dev.reserve();
+        REQUIRE(region.size() == 1024);
+        check_counter(region, next_word);
+    }
+
+    SECTION("THROW reports the loss") {
+        dev.setOverrunPolicy(AxiDataCapture::OverrunPolicy::THROW);
+        emulator.advance(64 * 1024);
+        REQUIRE_THROWS_AS(dev.reserve(), std::runtime_error);
+    }
+}
+
+TEST_CASE("waitForData sleeps on the interrupt", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+
+    SECTION("woken up by data") {
+        std::thread producer([&emulator]() {
+            smart::msleep(20);
+            emulator.advance(8192);
+        });
+        const uint64_t t0 = smart::time_us();
+        const size_t available = dev.waitForData(8192, 5 * 1000 * 1000);
+        const uint64_t elapsed = smart::time_us() - t0;
+        producer.join();
+        REQUIRE(available == 8192);
+        REQUIRE(elapsed < 2 * 1000 * 1000);
+        REQUIRE(emulator.getIrqCount() >= 1);
+    }
+
+    SECTION("times out") {
+        REQUIRE(dev.waitForData(8192, 10 * 1000) == 0);
+    }
+
+    SECTION("cancelled") {
+        std::thread canceller([&dev]() {
+            smart::msleep(20);
+            dev.cancelWait();
+        });
+        REQUIRE(dev.waitForData(8192, 5 * 1000 * 1000) == 0);
+        canceller.join();
+    }
+}
+
+TEST_CASE("telemetry reports the IP core counters", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+
+    emulator.advance(32 * 1024);
+    emulator.injectBurstErrors(3);
+    const auto region = dev.reserve(16 * 1024);
+    dev.release(region.size());
+
+    const auto t = dev.getTelemetry();
+    REQUIRE(t.burst_successes == 32 * 1024 / 128);
+    REQUIRE(t.burst_errors == 3);
+    REQUIRE(t.fill_bytes == 32 * 1024);
+    REQUIRE(t.lag_bytes == 16 * 1024);
+    REQUIRE(t.bytes_consumed == 16 * 1024);
+    REQUIRE(t.fetches == 1);
+    REQUIRE(t.fill_histogram[8] == 1);
+}
+
+TEST_CASE("telemetry stays sane while the head is inside a block", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+
+    emulator.advance(4096);
+    dev.release(dev.reserve().size());
+    // The head leads the block count by half a block.
+    REQUIRE(emulator.advanceHead(64) == 64);
+    const auto region = dev.reserve();
+    REQUIRE(region.size() == 64);
+    dev.release(region.size());
+    dev.release(dev.reserve().size());
+
+    const auto t = dev.getTelemetry();
+    REQUIRE(t.bytes_consumed == 4096 + 64);
+    REQUIRE(t.fill_bytes == 0);
+    REQUIRE(t.max_fill_bytes == 4096);
+    REQUIRE(t.lag_bytes == 0);
+    REQUIRE(t.fill_histogram[AxiDataCapture::FILL_HISTOGRAM_BUCKETS - 1] == 0);
+    REQUIRE(dev.getLossCounters().overruns == 0);
+
+    // Completing the block keeps the stream continuous.
+    emulator.advanceHead(64);
+    uint32_t next_word = (4096 + 64) / 4;
+    check_counter(dev.reserve(), next_word);
+}
+
+TEST_CASE("advanceHead writes odd pieces byte-exact across the wrap", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+    dev.startCapture(AxiDataCapture::CAPTURE_STREAMING);
+
+    const size_t ring_size = dev.getBufferSize();
+    emulator.advance(ring_size - 4096);
+    const auto first = dev.reserve();
+    REQUIRE(first.first.size() == ring_size - 4096);
+    // The emulated memory is ours to poke.
+    uint8_t* end = const_cast<uint8_t*>(first.first.data()) + ring_size;
+    dev.release(first.size());
+    uint32_t next_word = (ring_size - 4096) / 4;
+
+    // Ends 3 bytes before the ring end: those must stay untouched.
+    memset(end - 3, 0xAA, 3);
+    REQUIRE(emulator.advanceHead(4093) == 4093);
+    CHECK(end[-3] == 0xAA);
+    CHECK(end[-2] == 0xAA);
+    CHECK(end[-1] == 0xAA);
+
+    // 7 bytes more cross the ring end; the counter stays in phase with the byte offsets.
+    REQUIRE(emulator.advanceHead(7) == 7);
+    REQUIRE(emulator.getBytesProduced() == ring_size + 4);
+    emulator.advance(4096);
+    check_counter(dev.reserve(), next_word);
+    REQUIRE(next_word == (ring_size + 4100) / 4);
+}
+
+TEST_CASE("capture pipeline stores the emulated stream", "[axi-data-capture]") {
+    AxiDataCaptureEmulator::Options options;
+    options.buffer_size = 256 * 1024;
+    options.nchannels = 8;
+    options.sample_rate = 1000 * 1000;   // 16 MB/s
+    AxiDataCaptureEmulator emulator(options);
+    AxiDataCapture dev(emulator.getDevice());
+
+    const char* temp_file = "/tmp/test_axi_data_capture.raw";
+    smart::hw::CapturePipeline::Options pipeline_options;
+    pipeline_options.buffer_size = 64 * 1024;
+    smart::hw::CapturePipeline pipeline(dev, temp_file, pipeline_options);
+
+    emulator.startProducer();
+    pipeline.start();
+    smart::msleep(200);
+    pipeline.stop();
+    emulator.stopProducer();
+
+    const auto stats = pipeline.getStatistics();
+    REQUIRE(stats.bytes_written > 0);
+    REQUIRE(stats.bytes_written == emulator.getBytesProduced());
+    REQUIRE(dev.getLossCounters().overruns == 0);
+
+    FILE* fin = fopen(temp_file, "rb");
+    REQUIRE(fin != nullptr);
+    std::vector<uint8_t> data(stats.bytes_written);
+    REQUIRE(fread(data.data(), 1, data.size(), fin) == data.size());
+    fclose(fin);
+    std::remove(temp_file);
+
+    uint32_t first_word;
+    memcpy(&first_word, data.data(), sizeof(first_word));
+    AxiDataCapture::Region region;
+    region.first = std::span<const uint8_t>(data.data(), data.size() / 4 * 4);
+    check_counter(region, first_word);
+}
+
+TEST_CASE("capture pipeline stop writes out the data left in the ring", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+
+    const char* temp_file = "/tmp/test_axi_data_capture_drain.raw";
+    smart::hw::CapturePipeline::Options pipeline_options;
+    pipeline_options.buffer_size = 64 * 1024;
+    smart::hw::CapturePipeline pipeline(dev, temp_file, pipeline_options);
+
+    pipeline.start();
+    emulator.advance(40 * 1024);
+    pipeline.stop();
+    std::remove(temp_file);
+
+    REQUIRE(pipeline.getStatistics().bytes_written == 40 * 1024);
+    // The core is stopped.
+    REQUIRE(emulator.advance(4096) == 0);
+}
+
+TEST_CASE("capture pipeline closes the file when start fails", "[axi-data-capture]") {
+    AxiDataCaptureEmulator emulator(small_ring());
+    AxiDataCapture dev(emulator.getDevice());
+
+    smart::hw::CapturePipeline::Options pipeline_options;
+    pipeline_options.format = smart::hw::CapturePipeline::Format::WAV;
+    // Opens fine, but every write fails with ENOSPC.
+    smart::hw::CapturePipeline pipeline(dev, "/dev/full", pipeline_options);
+
+    const auto count_fds = [] {
+        int n = 0;
+        DIR* dir = opendir("/proc/self/fd");
+        if (dir != nullptr) {
+            while (readdir(dir) != nullptr) {
+                ++n;
+            }
+            closedir(dir);
+        }
+        return n;
+    };
+    const int fds_before = count_fds();
+    REQUIRE_THROWS_AS(pipeline.start(), std::runtime_error);
+    REQUIRE(count_fds() == fds_before);
+    REQUIRE_THROWS_AS(pipeline.start(), std::runtime_error);
+    REQUIRE(count_fds() == fds_before);
+}
@@ -0,0 +1,71 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/hw/AxiDataCapture.h>
+#include <smart/hw/AxiDataCaptureEmulator.h>
+#include <smart/hw/AxiDataCaptureGroup.h>
+
+#include <vector>
+
+using smart::hw::AxiDataCapture;
+using smart::hw::AxiDataCaptureEmulator;
+using smart::hw::AxiDataCaptureGroup;
+
+TEST_CASE("capture group rejects mixed sample rates", "[axi-data-capture]") {
+    AxiDataCaptureEmulator::Options options;
+    options.buffer_size = 64 * 1024;
+    AxiDataCaptureEmulator emulator0(options);
+    options.sample_rate = 96000;
+    AxiDataCaptureEmulator emulator1(options);
+    AxiDataCapture dev0(emulator0.getDevice());
+    AxiDataCapture dev1(emulator1.getDevice());
+
+    REQUIRE_THROWS(AxiDataCaptureGroup({&dev0, &dev1}));
+    REQUIRE_THROWS(AxiDataCaptureGroup({}));
+}
+
+TEST_CASE("capture group returns aligned frames", "[axi-data-capture]") {
+    AxiDataCaptureEmulator::Options options;
+    options.buffer_size = 64 * 1024;
+    options.nchannels = 2;      // 4-byte frames
+    AxiDataCaptureEmulator emulator0(options);
+    options.nchannels = 4;      // 8-byte frames
+    AxiDataCaptureEmulator emulator1(options);
+    AxiDataCapture dev0(emulator0.getDevice());
+    AxiDataCapture dev1(emulator1.getDevice());
+
+    AxiDataCaptureGroup group({&dev0, &dev1});
+    REQUIRE(group.size() == 2);
+    group.start();
+
+    // Back-to-back register writes are far less than a sample period apart at 48 kHz.
+    const auto& offsets = group.getStartOffsets();
+    REQUIRE(offsets.size() == 2);
+    REQUIRE(offsets[0] <= 1);
+    REQUIRE(offsets[1] <= 1);
+    REQUIRE((offsets[0] == 0 || offsets[1] == 0));
+
+    std::vector<AxiDataCapture::Region> regions;
+    REQUIRE(group.reserve(regions) == 0);
+    REQUIRE(regions.size() == 2);
+
+    emulator0.advance(8192);
+    emulator1.advance(8192);
+    REQUIRE(group.waitForData(1000, 1000) >= 1000 - 1);
+
+    // Limited by device 1 with the larger frames.
+    const size_t nframes = group.reserve(regions);
+    REQUIRE(nframes >= 1024 - 1);
+    REQUIRE(nframes <= 1024);
+    REQUIRE(regions[0].size() == nframes * 4);
+    REQUIRE(regions[1].size() == nframes * 8);
+
+    const size_t some = group.reserve(regions, 100);
+    REQUIRE(some == 100);
+    REQUIRE(regions[0].size() == 400);
+    REQUIRE(regions[1].size() == 800);
+    group.release(some);
+
+    REQUIRE(group.reserve(regions) == nframes - 100);
+    group.release(nframes - 100);
+    REQUIRE(group.reserve(regions) == 0);
+    group.stop();
+}
@@ -0,0 +1,163 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/ts/BoundedQueue.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE("BoundedQueue initialization", "[bounded_queue]") {
+    smart::ts::BoundedQueue<int> queue(10);
+
+    SECTION("capacity is rounded up to a power of 2") {
+        REQUIRE(queue.capacity() == 16);
+        REQUIRE(smart::ts::BoundedQueue<int>(16).capacity() == 16);
+        REQUIRE(smart::ts::BoundedQueue<int>(0).capacity() == 2);
+    }
+
+    SECTION("starts empty") {
+        REQUIRE(queue.size() == 0);
+        int value;
+        REQUIRE_FALSE(queue.try_pop(value));
+    }
+}
+
+TEST_CASE("BoundedQueue keeps the order and refuses when full", "[bounded_queue]") {
+    smart::ts::BoundedQueue<int> queue(4);
+
+    for (int round = 0; round < 5; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(queue.try_push(round * 10 + i));
+        }
+        REQUIRE_FALSE(queue.try_push(99));
+        REQUIRE(queue.size() == 4);
+
+        int value;
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(queue.try_pop(value));
+            REQUIRE(value == round * 10 + i);
+        }
+        REQUIRE_FALSE(queue.try_pop(value));
+    }
+}
+
+TEST_CASE("BoundedQueue moves move-only elements", "[bounded_queue]") {
+    auto counter = std::make_shared<int>(0);
+
+    SECTION("elements are moved in and out") {
+        smart::ts::BoundedQueue<std::unique_ptr<int>> queue(2);
+        REQUIRE(queue.try_push(std::make_unique<int>(1)));
+        REQUIRE(queue.try_emplace(new int(2)));
+
+        auto refused = std::make_unique<int>(3);
+        REQUIRE_FALSE(queue.try_push(std::move(refused)));
+        REQUIRE(refused != nullptr);
+
+        std::unique_ptr<int> value;
+        REQUIRE(queue.try_pop(value));
+        REQUIRE(*value == 1);
+        queue.pop(value);
+        REQUIRE(*value == 2);
+    }
+
+    SECTION("elements left are destroyed with the queue") {
+        {
+            smart::ts::BoundedQueue<std::shared_ptr<int>> queue(8);
+            for (int i = 0; i < 5; ++i) {
+                REQUIRE(queue.try_push(counter));
+            }
+            std::shared_ptr<int> value;
+            REQUIRE(queue.try_pop(value));
+            REQUIRE(counter.use_count() == 6);
+        }
+        REQUIRE(counter.use_count() == 1);
+    }
+}
+
+TEST_CASE("BoundedQueue blocking pop waits for a push", "[bounded_queue]") {
+    smart::ts::BoundedQueue<int> queue(2);
+    int value = 0;
+
+    std::thread consumer([&queue, &value] {
+        queue.pop(value);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.push(42);
+    consumer.join();
+    REQUIRE(value == 42);
+}
+
+TEST_CASE("BoundedQueue blocking push waits for a pop", "[bounded_queue]") {
+    smart::ts::BoundedQueue<int> queue(2);
+    queue.push(1);
+    queue.push(2);
+
+    std::thread producer([&queue] {
+        queue.push(3);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    int value;
+    REQUIRE(queue.try_pop(value));
+    producer.join();
+    REQUIRE(queue.try_pop(value));
+    REQUIRE(queue.try_pop(value));
+    REQUIRE(value == 3);
+}
+
+TEST_CASE("BoundedQueue passes every element with several producers and consumers", "[bounded_queue]") {
+    constexpr uint32_t PRODUCERS = 3;
+    constexpr uint32_t CONSUMERS = 3;
+    constexpr uint32_t PER_PRODUCER = 100000;
+    smart::ts::BoundedQueue<uint32_t> queue(64);
+
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < PRODUCERS; ++p) {
+        threads.emplace_back([&queue, p] {
+            for (uint32_t i = 0; i < PER_PRODUCER; ++i) {
+                const uint32_t e = p * PER_PRODUCER + i;
+                while (!queue.try_push(e)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<std::atomic<uint8_t>> seen(PRODUCERS * PER_PRODUCER);
+    std::atomic<uint32_t> popped(0);
+    std::atomic<bool> in_order(true);
+    for (uint32_t c = 0; c < CONSUMERS; ++c) {
+        threads.emplace_back([&] {
+            std::vector<uint32_t> last(PRODUCERS, 0);
+            std::vector<bool> any(PRODUCERS, false);
+            while (popped.load() < PRODUCERS * PER_PRODUCER) {
+                uint32_t e;
+                if (!queue.try_pop(e)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                // Elements of one producer arrive in order at each consumer.
+                const uint32_t p = e / PER_PRODUCER;
+                if (any[p] && e <= last[p]) {
+                    in_order = false;
+                }
+                any[p] = true;
+                last[p] = e;
+                seen[e].fetch_add(1);
+                popped.fetch_add(1);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    REQUIRE(in_order);
+    bool each_once = true;
+    for (auto& s : seen) {
+        each_once = each_once && s.load() == 1;
+    }
+    REQUIRE(each_once);
+    REQUIRE(queue.size() == 0);
+}
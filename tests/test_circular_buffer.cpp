@@ -1,6 +1,9 @@
 #include <catch2/catch_test_macros.hpp>
 #include <smart/CircularBuffer.h>
 
+#include <chrono>
+#include <thread>
+
 TEST_CASE("CircularBuffer initialization", "[circular_buffer]") {
     smart::CircularBuffer<int> buffer(10);
 
@@ -230,3 +233,126 @@ TEST_CASE("CircularBuffer with different types", "[circular_buffer]") {
         REQUIRE(p.y == 20);
     }
 }
+
+TEST_CASE("CircularBuffer reserve/commit and readable/consume work in place", "[circular_buffer]") {
+    smart::CircularBuffer<int> buffer(8);  // capacity = 7
+
+    SECTION("reserve is limited by the free room") {
+        REQUIRE(buffer.reserve(100).size() == 7);
+        buffer.push(1);
+        REQUIRE(buffer.reserve(100).size() == 6);
+        REQUIRE(buffer.reserve(2).size() == 2);
+    }
+
+    SECTION("nothing is visible before commit") {
+        auto region = buffer.reserve(3);
+        region.first[0] = 7;
+        REQUIRE(buffer.empty());
+        REQUIRE(buffer.readable().size() == 0);
+        buffer.commit(1);
+        REQUIRE(buffer.size() == 1);
+        int v;
+        REQUIRE(buffer.pop(v));
+        REQUIRE(v == 7);
+    }
+
+    SECTION("regions are split at the wrap") {
+        int next_in = 0;
+        int next_out = 0;
+        bool wrapped = false;
+        for (int round = 0; round < 10; ++round) {
+            auto w = buffer.reserve(5);
+            REQUIRE(w.size() == 5);
+            for (auto& e : w.first) e = next_in++;
+            for (auto& e : w.second) e = next_in++;
+            buffer.commit(5);
+
+            const auto r = buffer.readable();
+            REQUIRE(r.size() == 5);
+            wrapped = wrapped || !r.second.empty();
+            for (const int e : r.first) REQUIRE(e == next_out++);
+            for (const int e : r.second) REQUIRE(e == next_out++);
+            buffer.consume(5);
+            REQUIRE(buffer.empty());
+        }
+        REQUIRE(wrapped);
+    }
+
+    SECTION("consume frees part of the readable elements") {
+        const int values[] = { 1, 2, 3, 4 };
+        buffer.push(values, values + 4);
+        buffer.consume(3);
+        const auto r = buffer.readable();
+        REQUIRE(r.size() == 1);
+        REQUIRE(r.first[0] == 4);
+    }
+}
+
+TEST_CASE("BlockingCircularBuffer waits for data and space", "[circular_buffer]") {
+    using namespace std::chrono_literals;
+    smart::BlockingCircularBuffer<int> buffer(4);  // capacity = 3
+
+    SECTION("returns at once when satisfied") {
+        REQUIRE(buffer.wait_for_space(3, 0ms));
+        buffer.push(1);
+        REQUIRE(buffer.wait_for_data(1, 0ms));
+        REQUIRE_FALSE(buffer.wait_for_data(2, 0ms));
+    }
+
+    SECTION("times out") {
+        const auto t0 = std::chrono::steady_clock::now();
+        REQUIRE_FALSE(buffer.wait_for_data(1, 20ms));
+        REQUIRE(std::chrono::steady_clock::now() - t0 >= 20ms);
+    }
+
+    SECTION("refuses more than the capacity") {
+        REQUIRE_FALSE(buffer.wait_for_space(4, 1s));
+        REQUIRE_FALSE(buffer.wait_for_data(4, 1s));
+    }
+
+    SECTION("consumer is woken by the producer") {
+        std::thread producer([&buffer] {
+            std::this_thread::sleep_for(10ms);
+            buffer.push(1);
+            std::this_thread::sleep_for(10ms);
+            buffer.push(2);
+        });
+        REQUIRE(buffer.wait_for_data(2, 10s));
+        producer.join();
+        REQUIRE(buffer.size() == 2);
+    }
+
+    SECTION("producer is woken by the consumer") {
+        const int values[] = { 1, 2, 3 };
+        buffer.push(values, values + 3);
+        std::thread consumer([&buffer] {
+            std::this_thread::sleep_for(10ms);
+            buffer.consume(2);
+        });
+        REQUIRE(buffer.wait_for_space(2, 10s));
+        consumer.join();
+        REQUIRE(buffer.available() == 2);
+    }
+
+    SECTION("keeps the order when both sides block") {
+        constexpr int COUNT = 100000;
+        std::thread producer([&buffer] {
+            for (int i = 0; i < COUNT; ++i) {
+                buffer.wait_for_space(1, 10s);
+                buffer.push(i);
+            }
+        });
+        bool in_order = true;
+        for (int i = 0; i < COUNT; ++i) {
+            if (!buffer.wait_for_data(1, 10s)) {
+                in_order = false;
+                break;
+            }
+            int v;
+            buffer.pop(v);
+            in_order = in_order && v == i;
+        }
+        producer.join();
+        REQUIRE(in_order);
+    }
+}
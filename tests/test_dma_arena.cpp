@@ -0,0 +1,119 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/DmaArena.h>
+#include <smart/MappedFile.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+using smart::DmaArena;
+using smart::MappedFile;
+
+namespace {
+
+constexpr size_t REGION_SIZE = 1024 * 1024;
+constexpr uintptr_t PHYSICAL_BASE = 0x1F000000;
+
+// Region of REGION_SIZE bytes in an anonymous file.
+struct Region {
+    int fd;
+    MappedFile map;
+
+    Region() : fd(make_fd()), map(fd, 0, REGION_SIZE) {}
+
+    ~Region() {
+        close(fd);
+    }
+
+    static int make_fd() {
+        const int fd = memfd_create("test_dma_arena", MFD_CLOEXEC);
+        if (fd < 0 || ftruncate(fd, REGION_SIZE) != 0) {
+            throw std::runtime_error("test_dma_arena: cannot create the region");
+        }
+        return fd;
+    }
+};
+
+} // namespace
+
+TEST_CASE("DmaArena blocks are aligned, disjoint and translated", "[dma-arena]") {
+    Region region;
+    DmaArena arena(&region.map, PHYSICAL_BASE);
+    REQUIRE(arena.freeSize() == REGION_SIZE);
+
+    const auto a = arena.allocate(100);
+    const auto b = arena.allocate(4096, 4096);
+    const auto c = arena.allocate(64 * 1024, 64 * 1024);
+
+    CHECK(a.size == 128);
+    CHECK(a.physical % DmaArena::MIN_ALIGNMENT == 0);
+    CHECK(b.physical % 4096 == 0);
+    CHECK(c.physical % (64 * 1024) == 0);
+    CHECK(a.offset + a.size <= b.offset);
+    CHECK(b.offset + b.size <= c.offset);
+    CHECK(arena.freeSize() == REGION_SIZE - a.size - b.size - c.size);
+
+    for (const auto& block : { a, b, c }) {
+        CHECK(block.data == static_cast<uint8_t*>(region.map.data()) + block.offset);
+        CHECK(block.physical == PHYSICAL_BASE + block.offset);
+        CHECK(arena.physicalOf(block.data) == block.physical);
+        CHECK(arena.virtualOf(block.physical + 8) == static_cast<uint8_t*>(block.data) + 8);
+    }
+    CHECK_THROWS_AS(arena.virtualOf(PHYSICAL_BASE + REGION_SIZE), std::runtime_error);
+    CHECK_THROWS_AS(arena.physicalOf(static_cast<uint8_t*>(region.map.data()) - 1), std::runtime_error);
+}
+
+TEST_CASE("DmaArena aligns the physical address, not the virtual one", "[dma-arena]") {
+    Region region;
+    DmaArena arena(&region.map, PHYSICAL_BASE + 4096);
+
+    const auto block = arena.allocate(4096, 8192);
+    CHECK(block.physical % 8192 == 0);
+    CHECK(block.offset == 4096);
+}
+
+TEST_CASE("DmaArena merges freed neighbours", "[dma-arena]") {
+    Region region;
+    DmaArena arena(&region.map, PHYSICAL_BASE);
+
+    std::vector<DmaArena::Block> blocks;
+    for (int i = 0; i < 4; ++i) {
+        blocks.push_back(arena.allocate(REGION_SIZE / 4));
+    }
+    CHECK(arena.freeSize() == 0);
+    CHECK_THROWS_AS(arena.allocate(64), std::runtime_error);
+
+    arena.free(blocks[1]);
+    arena.free(blocks[3]);
+    CHECK(arena.largestFree() == REGION_SIZE / 4);
+    CHECK_THROWS_AS(arena.allocate(REGION_SIZE / 2), std::runtime_error);
+
+    arena.free(blocks[2]);
+    CHECK(arena.largestFree() == 3 * REGION_SIZE / 4);
+    arena.free(blocks[0]);
+    CHECK(arena.largestFree() == REGION_SIZE);
+
+    CHECK(arena.allocate(REGION_SIZE).offset == 0);
+}
+
+TEST_CASE("DmaArena rejects foreign blocks and bad alignments", "[dma-arena]") {
+    Region region;
+    DmaArena arena(&region.map, PHYSICAL_BASE);
+
+    const auto block = arena.allocate(256);
+    arena.free(block);
+    CHECK_THROWS_AS(arena.free(block), std::runtime_error);
+    CHECK_THROWS_AS(arena.allocate(256, 96), std::runtime_error);
+    CHECK_THROWS_AS(arena.allocate(0), std::runtime_error);
+
+    // Sizes that would wrap when rounded up, and alignments that would wrap the address.
+    const auto free_size = arena.freeSize();
+    CHECK_THROWS_AS(arena.allocate(SIZE_MAX), std::runtime_error);
+    CHECK_THROWS_AS(arena.allocate(SIZE_MAX - 10), std::runtime_error);
+    CHECK_THROWS_AS(arena.allocate(SIZE_MAX - 255, 256), std::runtime_error);
+    CHECK_THROWS_AS(arena.allocate(256, std::size_t(1) << (sizeof(std::size_t) * 8 - 1)), std::runtime_error);
+    CHECK(arena.freeSize() == free_size);
+}
@@ -0,0 +1,128 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/hw/AxiDataCapture.h>
+#include <smart/hw/AxiDataCaptureEmulator.h>
+#include <smart/hw/FlightRecorder.h>
+#include <smart/time.h>
+#include <smart/WavFormat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using smart::hw::AxiDataCapture;
+using smart::hw::AxiDataCaptureEmulator;
+using smart::hw::FlightRecorder;
+using smart::Trigger::Condition;
+
+namespace {
+
+// Read a WAV file back, return the data.
+std::vector<uint8_t> read_wav(const std::string& filename, unsigned int& channels, unsigned int& bits) {
+    FILE* fin = fopen(filename.c_str(), "rb");
+    REQUIRE(fin != nullptr);
+    unsigned int rate = 0, size = 0;
+    smart::WavFormat::readHeader(fin, channels, bits, rate, size);
+    std::vector<uint8_t> data(size);
+    REQUIRE(fread(data.data(), 1, size, fin) == size);
+    fclose(fin);
+    return data;
+}
+
+} // namespace
+
+TEST_CASE("flight recorder validates its configuration", "[flight-recorder]") {
+    AxiDataCaptureEmulator emulator;
+    AxiDataCapture dev(emulator.getDevice());
+
+    REQUIRE_THROWS(FlightRecorder(dev, {}));
+    REQUIRE_THROWS(FlightRecorder(dev, {{2, Condition::above(0)}}));
+
+    AxiDataCaptureEmulator::Options options;
+    options.sample_width = 24;
+    AxiDataCaptureEmulator emulator24(options);
+    AxiDataCapture dev24(emulator24.getDevice());
+    REQUIRE_THROWS(FlightRecorder(dev24, {{0, Condition::above(0)}}));
+}
+
+TEST_CASE("flight recorder writes the frames around the trigger", "[flight-recorder]") {
+    // 2 channels of 16 bits at 48 kHz; channel 1 steps up at frame 5000 and again at frame 9000.
+    AxiDataCaptureEmulator emulator;
+    AxiDataCapture dev(emulator.getDevice());
+
+    FlightRecorder::Options options;
+    options.pre_trigger_seconds = 0.01;     // 480 frames
+    options.post_trigger_seconds = 0.02;    // 960 frames
+    options.path_prefix = "/tmp/test_flight_recorder-";
+    FlightRecorder recorder(dev, {{1, Condition::rising(1000)}}, options);
+
+    std::vector<int16_t> frames;
+    for (int16_t f = 0; f < 12000; ++f) {
+        frames.push_back(f);
+        frames.push_back((f >= 5000 && f < 5500) || f >= 9000 ? 2000 : 0);
+    }
+    // Odd pieces, so that events span several calls.
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(frames.data());
+    size_t done = 0;
+    for (size_t n : {1234u, 3000u, 777u, 5000u, 1989u}) {
+        recorder.process(&data[done * 4], n);
+        done += n;
+    }
+    REQUIRE(done == 12000);
+    recorder.flush();
+
+    const auto events = recorder.getEvents();
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].trigger_frame == 5000);
+    REQUIRE(events[0].first_frame == 4520);
+    REQUIRE(events[0].nframes == 1440);
+    REQUIRE(events[1].trigger_frame == 9000);
+    REQUIRE(recorder.getStatistics().events_detected == 2);
+
+    for (const auto& event : events) {
+        unsigned int channels = 0, bits = 0;
+        const std::vector<uint8_t> wav = read_wav(event.filename, channels, bits);
+        std::remove(event.filename.c_str());
+        REQUIRE(channels == 2);
+        REQUIRE(bits == 16);
+        REQUIRE(wav.size() == event.nframes * 4);
+        REQUIRE(memcmp(wav.data(), &frames[event.first_frame * 2], wav.size()) == 0);
+    }
+}
+
+TEST_CASE("flight recorder scans the emulated capture stream", "[flight-recorder]") {
+    // Channel 0 is the low half of the counter pattern: it rises through 0 every 65536 frames.
+    AxiDataCaptureEmulator::Options emulator_options;
+    emulator_options.sample_rate = 1000 * 1000;
+    emulator_options.buffer_size = 1024 * 1024;
+    AxiDataCaptureEmulator emulator(emulator_options);
+    AxiDataCapture dev(emulator.getDevice());
+
+    FlightRecorder::Options options;
+    options.pre_trigger_seconds = 0.001;
+    options.post_trigger_seconds = 0.001;
+    options.path_prefix = "/tmp/test_flight_recorder-stream-";
+    FlightRecorder recorder(dev, {{0, Condition::rising(0)}}, options);
+
+    emulator.startProducer();
+    recorder.start();
+    smart::msleep(250);
+    recorder.stop();
+    emulator.stopProducer();
+
+    const auto events = recorder.getEvents();
+    REQUIRE(events.size() >= 1);
+    for (const auto& event : events) {
+        unsigned int channels = 0, bits = 0;
+        const std::vector<uint8_t> wav = read_wav(event.filename, channels, bits);
+        std::remove(event.filename.c_str());
+        const size_t trigger_offset = (event.trigger_frame - event.first_frame) * 4;
+        REQUIRE(wav.size() > trigger_offset + 4);
+        int16_t at_trigger, before_trigger;
+        memcpy(&at_trigger, &wav[trigger_offset], 2);
+        REQUIRE(at_trigger == 1);
+        if (trigger_offset >= 4) {
+            memcpy(&before_trigger, &wav[trigger_offset - 4], 2);
+            REQUIRE(before_trigger == 0);
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/MappedFile.h>
+
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+using smart::MappedFile;
+
+namespace {
+
+// Anonymous file of the given size, closed at the end of the test.
+struct MemFile {
+    int fd;
+
+    explicit MemFile(const size_t size) : fd(memfd_create("test_mapped_file", MFD_CLOEXEC)) {
+        REQUIRE(fd >= 0);
+        REQUIRE(ftruncate(fd, size) == 0);
+    }
+
+    ~MemFile() {
+        close(fd);
+    }
+};
+
+constexpr size_t MAP_SIZE = 64 * 1024;
+
+} // namespace
+
+TEST_CASE("writeBlock and readBlock move ranges at any word offset", "[mapped-file]") {
+    MemFile file(MAP_SIZE);
+    MappedFile map(file.fd, 0, MAP_SIZE);
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(map.data());
+    REQUIRE_FALSE(map.isMemory());
+
+    // Word by word as registers, then with wide accesses as memory.
+    for (const bool memory : { false, true }) {
+        map.setMemory(memory);
+        for (const uint32_t index : { 0u, 1u, 3u, 5u, 100u }) {
+            for (const size_t count : { 0u, 1u, 3u, 4u, 7u, 33u, 1000u }) {
+                std::vector<uint32_t> src(count);
+                std::iota(src.begin(), src.end(), index * 1000u + count);
+                map.fill(0, 0xDEADBEEF, map.size32());
+                map.writeBlock(index, src.data(), count);
+
+                for (size_t i = 0; i < count; ++i) {
+                    REQUIRE(words[index + i] == src[i]);
+                }
+                if (index > 0) {
+                    REQUIRE(words[index - 1] == 0xDEADBEEF);
+                }
+                REQUIRE(words[index + count] == 0xDEADBEEF);
+
+                std::vector<uint32_t> dst(count + 1, 0);
+                map.readBlock(index, dst.data(), count);
+                REQUIRE(std::vector<uint32_t>(dst.begin(), dst.begin() + count) == src);
+                REQUIRE(dst[count] == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("fill writes only the given range", "[mapped-file]") {
+    MemFile file(MAP_SIZE);
+    MappedFile map(file.fd, 0, MAP_SIZE);
+
+    for (const bool memory : { false, true }) {
+        map.setMemory(memory);
+        map.fill(0, 0, map.size32());
+        map.fill(3, 0x12345678, 17);
+        for (uint32_t i = 0; i < 32; ++i) {
+            REQUIRE(map.read32(i) == (i >= 3 && i < 20 ? 0x12345678u : 0u));
+        }
+    }
+}
+
+TEST_CASE("block transfers check the bounds", "[mapped-file]") {
+    MemFile file(MAP_SIZE);
+    MappedFile map(file.fd, 0, MAP_SIZE);
+    std::vector<uint32_t> buffer(map.size32() + 1);
+
+    REQUIRE_NOTHROW(map.readBlock(0, buffer.data(), map.size32()));
+    REQUIRE_NOTHROW(map.fill(map.size32(), 0, 0));
+    REQUIRE_THROWS_AS(map.readBlock(1, buffer.data(), map.size32()), std::runtime_error);
+    REQUIRE_THROWS_AS(map.writeBlock(0, buffer.data(), map.size32() + 1), std::runtime_error);
+    REQUIRE_THROWS_AS(map.fill(map.size32() + 1, 0, 0), std::runtime_error);
+}
+
+TEST_CASE("transactions merge masked writes and apply them on commit", "[mapped-file]") {
+    MemFile file(MAP_SIZE);
+    MappedFile map(file.fd, 0, MAP_SIZE);
+    map.fill(0, 0, map.size32());
+    map.write32(5, 0xFF00FF00);
+
+    MappedFile::Transaction t(map);
+    t.write32Masked(5, 0x0000000F, 0x3);
+    t.write32Masked(5, 0x000000F0, 0x50);
+    t.write32(7, 0x12345678);
+    t.write32Masked(5, 0x0000000F, 0x4);
+    REQUIRE(t.size() == 2);
+    REQUIRE(map.read32(5) == 0xFF00FF00u);
+    REQUIRE(map.read32(7) == 0);
+
+    t.commit();
+    REQUIRE(t.size() == 0);
+    REQUIRE(map.read32(5) == 0xFF00FF54u);
+    REQUIRE(map.read32(7) == 0x12345678u);
+
+    t.write32(7, 1);
+    t.clear();
+    t.commit();
+    REQUIRE(map.read32(7) == 0x12345678u);
+    REQUIRE_THROWS_AS(t.write32(map.size32(), 0), std::runtime_error);
+}
+
+TEST_CASE("the shadow covers the whole map", "[mapped-file]") {
+    MemFile file(MAP_SIZE);
+    MappedFile map(file.fd, 0, MAP_SIZE);
+    volatile uint32_t* words = reinterpret_cast<volatile uint32_t*>(map.data());
+    std::vector<bool> hardware_read(100);
+    hardware_read[40] = true;
+    map.createShadow(hardware_read);
+
+    map.write32(40, 1);
+    map.write32(41, 1);
+    map.write32(map.size32() - 1, 1);
+    words[40] = 2;
+    words[41] = 2;
+    words[map.size32() - 1] = 2;
+    REQUIRE(map.read32(40) == 2);
+    REQUIRE(map.read32(41) == 1);
+    REQUIRE(map.read32(map.size32() - 1) == 1);
+
+    // Partial writes take the old value from the shadow.
+    MappedFile::Transaction t(map);
+    t.write32Masked(41, 0xF0, 0x30);
+    t.write32Masked(40, 0xF0, 0x30);
+    t.commit();
+    REQUIRE(words[41] == 0x31u);
+    REQUIRE(words[40] == 0x32u);
+}
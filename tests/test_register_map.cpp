@@ -0,0 +1,103 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/MappedFile.h>
+#include <smart/RegisterMap.h>
+
+#include <cstdint>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace smart::RegisterMap;
+
+namespace {
+
+typedef Register<0>            CTRL;
+typedef Register<1, ReadOnly>  STATUS;
+typedef Register<1, WriteOnly> COMMAND;
+typedef Register<3>            CONFIG;
+
+typedef Field<CTRL, 0, 1>   CTRL_ENABLE;
+typedef Field<CTRL, 4, 4>   CTRL_MODE;
+typedef Field<CTRL, 31, 1>  CTRL_RESET;
+typedef Field<CONFIG, 0, 16> CONFIG_LOW;
+typedef Field<CONFIG, 16, 16> CONFIG_HIGH;
+
+static_assert(CONFIG::offset == 12);
+static_assert(CTRL_MODE::mask == 0xF0u);
+static_assert(CTRL_MODE::encode(0x15) == 0x50u);
+static_assert(CTRL_MODE::decode(0x1234) == 0x3u);
+static_assert(Field<CTRL, 0, 32>::mask == 0xFFFFFFFFu);
+static_assert(bitsOf<CTRL_ENABLE::Set, CTRL_MODE::Value<9>>() == 0x91u);
+static_assert(maskOf<CTRL_ENABLE::Set, CTRL_MODE::Value<9>>() == 0xF1u);
+
+// Anonymous file of one page.
+int page_file() {
+    const int fd = memfd_create("test_register_map", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, smart::MappedFile::pageSize()) != 0) {
+        throw std::runtime_error("memfd_create failed");
+    }
+    return fd;
+}
+
+// Anonymous file mapped as a register block, closed at the end of the test.
+struct MemRegisters {
+    int fd;
+    smart::MappedFile map;
+    volatile uint32_t* words;
+
+    MemRegisters()
+        : fd(page_file()),
+          map(fd, 0, smart::MappedFile::pageSize()),
+          words(reinterpret_cast<volatile uint32_t*>(map.data())) {}
+
+    ~MemRegisters() {
+        close(fd);
+    }
+};
+
+} // namespace
+
+TEST_CASE("registers are read and written at their index", "[register-map]") {
+    MemRegisters mem;
+    Block<4> regs(&mem.map);
+
+    regs.write<CONFIG>(0x12345678);
+    REQUIRE(mem.words[3] == 0x12345678u);
+    mem.words[1] = 7;
+    REQUIRE(regs.read<STATUS>() == 7);
+    regs.write<COMMAND>(9);
+    REQUIRE(regs.read<STATUS>() == 9);
+}
+
+TEST_CASE("field operations keep the other bits", "[register-map]") {
+    MemRegisters mem;
+    Block<4> regs(&mem.map);
+    mem.words[0] = 0x0000FF00;
+
+    regs.modify<CTRL_ENABLE::Set, CTRL_MODE::Value<5>>();
+    REQUIRE(mem.words[0] == 0x0000FF51u);
+    REQUIRE(regs.get<CTRL_MODE>() == 5);
+    REQUIRE(regs.isSet<CTRL_ENABLE>());
+
+    regs.set<CTRL_MODE>(0xA);
+    REQUIRE(mem.words[0] == 0x0000FFA1u);
+
+    regs.modify<CTRL_RESET::Set>();
+    REQUIRE(mem.words[0] == 0x8000FFA1u);
+    regs.modify<CTRL_ENABLE::Clear>();
+    REQUIRE_FALSE(regs.isSet<CTRL_ENABLE>());
+
+    regs.assign<CTRL_MODE::Value<3>>();
+    REQUIRE(mem.words[0] == 0x30u);
+
+    mem.words[3] = 0xFFFFFFFF;
+    regs.modify<CONFIG_LOW::Value<0x1234>, CONFIG_HIGH::Value<0xABCD>>();
+    REQUIRE(mem.words[3] == 0xABCD1234u);
+}
+
+TEST_CASE("a block larger than the mapping is refused", "[register-map]") {
+    MemRegisters mem;
+    REQUIRE_NOTHROW(Block<1024>(&mem.map));
+    REQUIRE_THROWS_AS(Block<1025>(&mem.map), std::runtime_error);
+}
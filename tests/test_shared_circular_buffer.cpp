@@ -0,0 +1,209 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/SharedCircularBuffer.h>
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using Ring = smart::SharedCircularBuffer<uint32_t>;
+using Role = Ring::Role;
+using namespace std::chrono_literals;
+
+namespace {
+
+/// Anonymous file, closed at the end of the scope.
+struct Memfd {
+    int fd = memfd_create("test_shared_circular_buffer", MFD_CLOEXEC);
+    ~Memfd() { close(fd); }
+};
+
+/// Exit status of a child process running f.
+template <class F>
+int run_child(F f) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        int status = 1;
+        try {
+            status = f() ? 0 : 1;
+        } catch (...) {
+        }
+        _exit(status);
+    }
+    int status = -1;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+} // namespace
+
+TEST_CASE("SharedCircularBuffer has the CircularBuffer semantics", "[shared_circular_buffer]") {
+    Memfd memfd;
+    REQUIRE(memfd.fd >= 0);
+    Ring producer(memfd.fd, 8, Role::PRODUCER);
+    Ring consumer(memfd.fd, 0, Role::CONSUMER);
+
+    REQUIRE(producer.capacity() == 7);
+    REQUIRE(consumer.capacity() == 7);
+    REQUIRE(consumer.empty());
+
+    SECTION("elements pushed by one side are popped by the other") {
+        const uint32_t values[] = { 1, 2, 3, 4, 5, 6, 7 };
+        REQUIRE(producer.push(values, values + 7));
+        REQUIRE_FALSE(producer.push(8));
+        REQUIRE(consumer.size() == 7);
+
+        uint32_t out[8];
+        REQUIRE(consumer.pop_n(out, 8) == 7);
+        for (int i = 0; i < 7; ++i) {
+            REQUIRE(out[i] == values[i]);
+        }
+        REQUIRE(consumer.empty());
+    }
+
+    SECTION("regions are split at the wrap") {
+        uint32_t next_in = 0;
+        uint32_t next_out = 0;
+        bool wrapped = false;
+        for (int round = 0; round < 10; ++round) {
+            auto w = producer.reserve(5);
+            REQUIRE(w.size() == 5);
+            for (auto& e : w.first) e = next_in++;
+            for (auto& e : w.second) e = next_in++;
+            producer.commit(5);
+
+            const auto r = consumer.readable();
+            REQUIRE(r.size() == 5);
+            wrapped = wrapped || !r.second.empty();
+            for (const uint32_t e : r.first) REQUIRE(e == next_out++);
+            for (const uint32_t e : r.second) REQUIRE(e == next_out++);
+            consumer.consume(5);
+        }
+        REQUIRE(wrapped);
+    }
+
+    SECTION("each side sees the other") {
+        REQUIRE(producer.peer() == getpid());
+        REQUIRE(consumer.peer() == getpid());
+    }
+}
+
+TEST_CASE("SharedCircularBuffer attaches one process per side", "[shared_circular_buffer]") {
+    Memfd memfd;
+
+    SECTION("a side held by a live process is refused") {
+        Ring producer(memfd.fd, 16, Role::PRODUCER);
+        REQUIRE_THROWS_AS(Ring(memfd.fd, 16, Role::PRODUCER), std::runtime_error);
+    }
+
+    SECTION("a side is free again after detaching") {
+        {
+            Ring producer(memfd.fd, 16, Role::PRODUCER);
+            producer.push(1);
+        }
+        Ring producer(memfd.fd, 16, Role::PRODUCER);
+        REQUIRE(producer.size() == 1);
+    }
+
+    SECTION("a side held by a crashed process is taken over, keeping the committed elements") {
+        Ring consumer(memfd.fd, 16, Role::CONSUMER);
+        const int status = run_child([&memfd] {
+            Ring producer(memfd.fd, 0, Role::PRODUCER);
+            producer.push(41);
+            producer.push(42);
+            producer.reserve(3);
+            // Die without detaching.
+            _exit(0);
+            return true;
+        });
+        REQUIRE(status == 0);
+        REQUIRE(consumer.peer() == 0);
+
+        Ring producer(memfd.fd, 0, Role::PRODUCER);
+        REQUIRE(producer.push(43));
+        uint32_t out[4];
+        REQUIRE(consumer.pop_n(out, 4) == 3);
+        REQUIRE(out[0] == 41);
+        REQUIRE(out[1] == 42);
+        REQUIRE(out[2] == 43);
+    }
+}
+
+TEST_CASE("SharedCircularBuffer validates the file", "[shared_circular_buffer]") {
+    Memfd memfd;
+
+    SECTION("an empty file is not attached to without a size") {
+        REQUIRE_THROWS_AS(Ring(memfd.fd, 0, Role::CONSUMER), std::runtime_error);
+    }
+
+    SECTION("size and element size must match") {
+        Ring producer(memfd.fd, 16, Role::PRODUCER);
+        REQUIRE_THROWS_AS(Ring(memfd.fd, 32, Role::CONSUMER), std::runtime_error);
+        REQUIRE_THROWS_AS(smart::SharedCircularBuffer<uint64_t>(memfd.fd, 0, Role::CONSUMER), std::runtime_error);
+        Ring consumer(memfd.fd, 16, Role::CONSUMER);
+        REQUIRE(consumer.capacity() == 15);
+    }
+
+    SECTION("other files are refused") {
+        const std::string junk(256, 'x');
+        REQUIRE(write(memfd.fd, junk.data(), junk.size()) == static_cast<ssize_t>(junk.size()));
+        REQUIRE_THROWS_AS(Ring(memfd.fd, 16, Role::CONSUMER), std::runtime_error);
+    }
+
+    SECTION("a missing path is not created without a size") {
+        const std::string path = "/tmp/test_shared_circular_buffer." + std::to_string(getpid());
+        REQUIRE_THROWS_AS(Ring(path, 0, Role::CONSUMER), std::runtime_error);
+        {
+            Ring producer(path, 16, Role::PRODUCER);
+            Ring consumer(path, 0, Role::CONSUMER);
+            producer.push(7);
+            uint32_t v = 0;
+            REQUIRE(consumer.pop(v));
+            REQUIRE(v == 7);
+        }
+        unlink(path.c_str());
+    }
+}
+
+TEST_CASE("SharedCircularBuffer wakes a consumer in another process", "[shared_circular_buffer]") {
+    constexpr uint32_t COUNT = 20000;
+    Memfd memfd;
+    Ring producer(memfd.fd, 64, Role::PRODUCER);
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        bool in_order = false;
+        try {
+            Ring consumer(memfd.fd, 0, Role::CONSUMER);
+            in_order = true;
+            for (uint32_t i = 0; i < COUNT; ++i) {
+                uint32_t v;
+                if (!consumer.wait_for_data(1, 10s) || !consumer.pop(v) || v != i) {
+                    in_order = false;
+                    break;
+                }
+            }
+        } catch (...) {
+        }
+        _exit(in_order ? 0 : 1);
+    }
+
+    bool pushed = true;
+    for (uint32_t i = 0; i < COUNT && pushed; ++i) {
+        pushed = producer.wait_for_space(1, 10s) && producer.push(i);
+        if (i == 0) {
+            // Let the consumer park.
+            std::this_thread::sleep_for(20ms);
+        }
+    }
+    int status = -1;
+    waitpid(pid, &status, 0);
+    REQUIRE(pushed);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+}
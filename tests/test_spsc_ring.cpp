@@ -0,0 +1,117 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/SpscRing.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+TEST_CASE("SpscRing initialization", "[spsc_ring]") {
+    smart::SpscRing<int> ring(10);
+
+    SECTION("capacity is rounded up to a power of 2") {
+        REQUIRE(ring.capacity() == 16);
+        REQUIRE(smart::SpscRing<int>(16).capacity() == 16);
+        REQUIRE(smart::SpscRing<int>(0).capacity() == 1);
+    }
+
+    SECTION("starts empty") {
+        REQUIRE(ring.empty());
+        REQUIRE(ring.size() == 0);
+        REQUIRE(ring.available() == 16);
+        int value;
+        REQUIRE_FALSE(ring.pop(value));
+    }
+}
+
+TEST_CASE("SpscRing uses every slot", "[spsc_ring]") {
+    smart::SpscRing<int> ring(4);
+
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(ring.push(i));
+    }
+    REQUIRE_FALSE(ring.push(4));
+    REQUIRE(ring.size() == 4);
+    REQUIRE(ring.available() == 0);
+
+    int value;
+    REQUIRE(ring.pop(value));
+    REQUIRE(value == 0);
+    REQUIRE(ring.push(4));
+    for (int i = 1; i <= 4; ++i) {
+        REQUIRE(ring.pop(value));
+        REQUIRE(value == i);
+    }
+    REQUIRE(ring.empty());
+}
+
+TEST_CASE("SpscRing moves ranges across the wrap", "[spsc_ring]") {
+    smart::SpscRing<int> ring(8);
+    int next_in = 0;
+    int next_out = 0;
+
+    for (int round = 0; round < 20; ++round) {
+        const std::vector<int> in = { next_in, next_in + 1, next_in + 2, next_in + 3, next_in + 4 };
+        REQUIRE(ring.push(in.data(), in.data() + in.size()));
+        next_in += 5;
+        REQUIRE_FALSE(ring.push(in.data(), in.data() + in.size()));
+
+        int out[8];
+        REQUIRE(ring.pop_n(out, 8) == 5);
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(out[i] == next_out++);
+        }
+    }
+    int out[8];
+    REQUIRE(ring.pop_n(out, 8) == 0);
+}
+
+TEST_CASE("SpscRing clear drops the elements", "[spsc_ring]") {
+    smart::SpscRing<int> ring(4);
+    ring.push(1);
+    ring.push(2);
+    ring.clear();
+    REQUIRE(ring.empty());
+    REQUIRE(ring.push(3));
+    int value;
+    REQUIRE(ring.pop(value));
+    REQUIRE(value == 3);
+}
+
+TEST_CASE("SpscRing keeps the order between two threads", "[spsc_ring]") {
+    constexpr uint32_t COUNT = 1000000;
+    smart::SpscRing<uint32_t> ring(64);
+
+    std::thread producer([&ring] {
+        for (uint32_t i = 0; i < COUNT; ) {
+            if (i % 3 == 0) {
+                const uint32_t batch[3] = { i, i + 1, i + 2 };
+                if (i + 3 <= COUNT && ring.push(batch, batch + 3)) {
+                    i += 3;
+                    continue;
+                }
+            }
+            if (ring.push(i)) {
+                ++i;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    bool in_order = true;
+    uint32_t batch[16];
+    while (expected < COUNT) {
+        const size_t n = ring.pop_n(batch, 16);
+        if (n == 0) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < n; ++i) {
+            in_order = in_order && batch[i] == expected;
+            ++expected;
+        }
+    }
+    producer.join();
+    REQUIRE(in_order);
+    REQUIRE(ring.empty());
+}
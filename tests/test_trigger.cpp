@@ -0,0 +1,101 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/Trigger.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using smart::Trigger::Condition;
+
+namespace {
+
+template <typename T>
+void compare_with_scalar(const std::vector<T>& samples, const Condition& condition) {
+    const T previous = samples.empty() ? 0 : samples.back();
+    for (size_t n : {size_t(0), size_t(1), size_t(7), size_t(33), samples.size()}) {
+        REQUIRE(smart::Trigger::findFirst(samples.data(), n, previous, condition) ==
+                smart::Trigger::findFirstScalar(samples.data(), n, previous, condition));
+    }
+    // Every hit in turn: search from each index on.
+    size_t start = 0;
+    while (start < samples.size()) {
+        const T prev = start == 0 ? previous : samples[start - 1];
+        const size_t hit = smart::Trigger::findFirst(&samples[start], samples.size() - start, prev, condition);
+        REQUIRE(hit == smart::Trigger::findFirstScalar(&samples[start], samples.size() - start, prev, condition));
+        start += hit + 1;
+    }
+}
+
+} // namespace
+
+TEST_CASE("trigger conditions on 16-bit samples", "[trigger]") {
+    const std::vector<int16_t> samples = {0, 5, 10, 5, 0, -5, -10, -5, 0};
+
+    REQUIRE(smart::Trigger::findFirst(samples.data(), samples.size(), 0, Condition::above(7)) == 2);
+    REQUIRE(smart::Trigger::findFirst(samples.data(), samples.size(), 0, Condition::below(-7)) == 6);
+    REQUIRE(smart::Trigger::findFirst(samples.data(), samples.size(), 0, Condition::rising(3)) == 1);
+    REQUIRE(smart::Trigger::findFirst(samples.data(), samples.size(), 0, Condition::falling(3)) == 4);
+    REQUIRE(smart::Trigger::findFirst(samples.data(), samples.size(), 0, Condition::outside(-7, 7)) == 2);
+    REQUIRE(smart::Trigger::findFirst(samples.data(), samples.size(), 20, Condition::inside(-1, 1)) == 0);
+    REQUIRE(smart::Trigger::findFirst(samples.data(), samples.size(), 0, Condition::above(10)) == samples.size());
+
+    // The edge needs the previous sample.
+    REQUIRE(smart::Trigger::findFirst(&samples[2], 3, 5, Condition::rising(7)) == 0);
+    REQUIRE(smart::Trigger::findFirst(&samples[2], 3, 10, Condition::rising(7)) == 3);
+
+    // Levels beyond the sample range.
+    REQUIRE(smart::Trigger::findFirst(samples.data(), samples.size(), 0, Condition::above(100000)) == samples.size());
+    REQUIRE(smart::Trigger::findFirst(samples.data(), samples.size(), 0, Condition::inside(-100000, 100000)) == 0);
+}
+
+TEST_CASE("trigger levels beyond the 16-bit range", "[trigger]") {
+    const std::vector<int16_t> samples = {0, 1, -32768, 2, 32767, 3};
+
+    for (const bool scalar : {false, true}) {
+        const auto find = [&samples, scalar](const Condition& condition) {
+            return scalar ? smart::Trigger::findFirstScalar(samples.data(), samples.size(), 0, condition)
+                          : smart::Trigger::findFirst(samples.data(), samples.size(), 0, condition);
+        };
+        REQUIRE(find(Condition::above(-40000)) == 0);
+        REQUIRE(find(Condition::above(40000)) == samples.size());
+        REQUIRE(find(Condition::below(40000)) == 0);
+        REQUIRE(find(Condition::below(-40000)) == samples.size());
+        REQUIRE(find(Condition::rising(-40000)) == samples.size());
+        REQUIRE(find(Condition::rising(40000)) == samples.size());
+        REQUIRE(find(Condition::falling(40000)) == samples.size());
+        REQUIRE(find(Condition::falling(-40000)) == samples.size());
+        REQUIRE(find(Condition::inside(40000, 50000)) == samples.size());
+        REQUIRE(find(Condition::inside(-50000, -40000)) == samples.size());
+        REQUIRE(find(Condition::inside(32767, 50000)) == 4);
+        REQUIRE(find(Condition::inside(-50000, -32768)) == 2);
+        REQUIRE(find(Condition::outside(40000, 50000)) == 0);
+        REQUIRE(find(Condition::outside(-50000, -40000)) == 0);
+        REQUIRE(find(Condition::outside(-40000, 32766)) == 4);
+        REQUIRE(find(Condition::outside(-32767, 40000)) == 2);
+    }
+}
+
+TEST_CASE("vector trigger kernels match the scalar reference", "[trigger]") {
+    std::mt19937 rng(1234);
+    const Condition conditions[] = {
+        Condition::above(900), Condition::below(-900),
+        Condition::rising(100), Condition::falling(-100),
+        Condition::inside(-5, 5), Condition::outside(-990, 990),
+    };
+
+    std::vector<int16_t> samples16(1001);
+    std::vector<int32_t> samples32(1001);
+    std::uniform_int_distribution<int> dist(-1000, 1000);
+    for (size_t i = 0; i < samples16.size(); ++i) {
+        samples16[i] = static_cast<int16_t>(dist(rng));
+        samples32[i] = dist(rng) * 100000;
+    }
+
+    for (const auto& condition : conditions) {
+        compare_with_scalar(samples16, condition);
+        Condition scaled = condition;
+        scaled.low *= 100000;
+        scaled.high *= 100000;
+        compare_with_scalar(samples32, scaled);
+    }
+}
@@ -0,0 +1,79 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/File.h>
+#include <smart/MappedFile.h>
+#include <smart/UioDevice.h>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+using smart::UioDevice;
+
+namespace {
+
+// Device with two maps of one page each in a memory file.
+std::shared_ptr<UioDevice> make_device(const UioDevice::IpCoreConfigurationMap& configuration) {
+    const std::size_t page = smart::MappedFile::pageSize();
+    const int memory_fd = memfd_create("test_uio_device", MFD_CLOEXEC);
+    REQUIRE(memory_fd >= 0);
+    REQUIRE(ftruncate(memory_fd, 2 * page) == 0);
+
+    std::vector<smart::UioMap> maps(2);
+    for (unsigned i = 0; i < maps.size(); ++i) {
+        maps[i].addr = 0x43C00000 + i * 0x10000;
+        maps[i].name = "map";
+        maps[i].offset = 0;
+        maps[i].size = page;
+        maps[i].map = reinterpret_cast<smart::MappedFile*>(0x1);  // must not leak through
+    }
+    return std::make_shared<UioDevice>("test", nullptr, std::make_shared<smart::File>(memory_fd), maps, configuration);
+}
+
+std::vector<std::uint8_t> be32(std::uint32_t v) {
+    return { std::uint8_t(v >> 24), std::uint8_t(v >> 16), std::uint8_t(v >> 8), std::uint8_t(v) };
+}
+
+} // namespace
+
+TEST_CASE("UioDevice maps on first use", "[uio_device]") {
+    auto device = make_device({});
+
+    CHECK(device->maps[0].map == nullptr);
+    CHECK(device->maps[1].map == nullptr);
+
+    smart::MappedFile* map1 = device->getRequiredMap(1);
+    REQUIRE(map1 != nullptr);
+    CHECK(device->maps[1].map == map1);
+    CHECK(device->maps[0].map == nullptr);
+    CHECK(device->getRequiredMap(1) == map1);
+    CHECK(map1->size() == smart::MappedFile::pageSize());
+
+    // Map N is at the offset N*pageSize().
+    map1->write32(0, 0xCAFE);
+    CHECK(device->getRequiredMap(0)->read32(0) == 0);
+    CHECK(device->getRequiredMap(0)->read32(smart::MappedFile::pageSize() / 4 - 1) == 0);
+
+    CHECK_THROWS_AS(device->getRequiredMap(2), std::runtime_error);
+}
+
+TEST_CASE("UioDevice finds vendor-prefixed properties by their short name", "[uio_device]") {
+    UioDevice::IpCoreConfigurationMap configuration;
+    configuration["trenz.biz,channels"] = be32(4);
+    configuration["xlnx,channels"] = be32(8);
+    configuration["sample-rate"] = be32(1000000);
+    configuration["compatible"] = { 'a', 'x', 'i' };
+    auto device = make_device(configuration);
+
+    // The first prefixed key in sorted order wins.
+    CHECK(device->getConfigurationUInt32("channels") == 4);
+    CHECK(device->getConfigurationUInt32("xlnx,channels") == 8);
+    CHECK(device->getConfigurationUInt32("sample-rate") == 1000000);
+    CHECK(device->getConfigurationString("compatible") == "axi");
+    CHECK(device->getConfigurationUInt32("missing", 7) == 7);
+    CHECK_THROWS_AS(device->getConfigurationUInt32("missing"), std::runtime_error);
+    CHECK_THROWS_AS(device->getConfigurationUInt32("compatible"), std::runtime_error);
+}
@@ -0,0 +1,134 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/File.h>
+#include <smart/MappedFile.h>
+#include <smart/UioDevice.h>
+#include <smart/UioEventLoop.h>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using smart::UioDevice;
+using smart::UioEventLoop;
+
+namespace {
+
+// UIO device whose interrupt is driven by the test through the other end of a socket pair.
+struct FakeDevice {
+    int irq_fd;
+    std::shared_ptr<UioDevice> device;
+
+    explicit FakeDevice(const char* name) {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == 0);
+        irq_fd = fds[0];
+        const int memory_fd = memfd_create(name, MFD_CLOEXEC);
+        REQUIRE(memory_fd >= 0);
+        REQUIRE(ftruncate(memory_fd, smart::MappedFile::pageSize()) == 0);
+
+        std::vector<smart::UioMap> maps(1);
+        maps[0].addr = 0x43C00000;
+        maps[0].name = "registers";
+        maps[0].offset = 0;
+        maps[0].size = smart::MappedFile::pageSize();
+        device = std::make_shared<UioDevice>(name, std::make_shared<smart::File>(fds[1]),
+            std::make_shared<smart::File>(memory_fd), maps, UioDevice::IpCoreConfigurationMap());
+    }
+
+    ~FakeDevice() {
+        close(irq_fd);
+    }
+
+    // Next request of the driver: 1 to enable the interrupt; -1 when there is none.
+    int64_t request() {
+        uint32_t value;
+        return recv(irq_fd, &value, sizeof(value), MSG_DONTWAIT) == sizeof(value) ? static_cast<int64_t>(value) : -1;
+    }
+
+    void raise(const uint32_t count) {
+        REQUIRE(send(irq_fd, &count, sizeof(count), 0) == sizeof(count));
+    }
+};
+
+} // namespace
+
+TEST_CASE("interrupts are dispatched and enabled again", "[uio-event-loop]") {
+    FakeDevice a("fake-a");
+    FakeDevice b("fake-b");
+    UioEventLoop loop;
+    std::vector<UioEventLoop::Interrupt> seen;
+    const auto handler = [&](const UioEventLoop::Interrupt& irq) {
+        seen.push_back(irq);
+        // Still disabled while the handler runs.
+        REQUIRE(a.request() == -1);
+    };
+
+    loop.add(*a.device, handler);
+    loop.add(*b.device, [&](const UioEventLoop::Interrupt& irq) { seen.push_back(irq); });
+    REQUIRE(a.request() == 1);
+    REQUIRE(b.request() == 1);
+    REQUIRE(loop.runOnce(0) == 0);
+
+    a.raise(1);
+    REQUIRE(loop.runOnce(1000) == 1);
+    REQUIRE(seen.size() == 1);
+    REQUIRE(seen[0].device == a.device.get());
+    REQUIRE(seen[0].count == 1);
+    REQUIRE(seen[0].missed == 0);
+    REQUIRE(a.request() == 1);
+
+    // Counts advancing by more than one are missed interrupts.
+    a.raise(4);
+    b.raise(7);
+    unsigned int n = 0;
+    while (n < 2) {
+        n += loop.runOnce(1000);
+    }
+    REQUIRE(seen.size() == 3);
+    for (size_t i = 1; i < seen.size(); ++i) {
+        REQUIRE(seen[i].missed == (seen[i].device == a.device.get() ? 2u : 0u));
+    }
+    REQUIRE(loop.getInterruptCount() == 3);
+    REQUIRE(loop.getMissedCount() == 2);
+
+    loop.remove(*b.device);
+    b.raise(8);
+    REQUIRE(loop.runOnce(0) == 0);
+}
+
+TEST_CASE("plain files and stop share the loop", "[uio-event-loop]") {
+    UioEventLoop loop;
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    unsigned int reads = 0;
+    loop.addFile(fds[0], [&](uint32_t) {
+        char c;
+        REQUIRE(read(fds[0], &c, 1) == 1);
+        ++reads;
+        if (c == 'q') {
+            loop.stop();
+        }
+    });
+    REQUIRE_THROWS_AS(loop.addFile(fds[0], [](uint32_t) {}), std::runtime_error);
+
+    std::thread writer([&] {
+        REQUIRE(write(fds[1], "abq", 3) == 3);
+    });
+    loop.run();
+    writer.join();
+    REQUIRE(reads == 3);
+
+    // stop() from another thread ends run() as well.
+    std::thread stopper([&] { loop.stop(); });
+    loop.run();
+    stopper.join();
+
+    close(fds[0]);
+    close(fds[1]);
+}
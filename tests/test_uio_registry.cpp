@@ -0,0 +1,179 @@
+#include <catch2/catch_test_macros.hpp>
+#include <smart/File.h>
+#include <smart/UioRegistry.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using smart::UioRegistry;
+
+namespace {
+
+// sysfs, device tree and /dev of two UIO devices in a temporary directory.
+struct FakeSystem {
+    std::filesystem::path root;
+    UioRegistry::Options options;
+
+    FakeSystem() {
+        char dir[] = "/tmp/test_uio_registry_XXXXXX";
+        REQUIRE(mkdtemp(dir) != nullptr);
+        root = dir;
+        options.sysfs_directory = (root / "sys").string();
+        options.device_tree_roots = { (root / "dt1").string(), (root / "dt2").string() };
+        options.dev_directory = (root / "dev").string();
+        std::filesystem::create_directories(root / "dev");
+
+        addDevice(0, "gpio", { 0x41200000 });
+        addDevice(1, "AXI-Data-Capture", { 0x43C00000, 0x1F000000 });
+        addNode("dt1", "gpio@41200000", "xlnx,gpio-width", "8");
+        addNode("dt2", "axi_data_capture@43c00000", "compatible", "capture");
+        addNode("dt2", "gpio@41200000", "xlnx,gpio-width", "16");
+    }
+
+    ~FakeSystem() {
+        std::filesystem::remove_all(root);
+    }
+
+    static void write(const std::filesystem::path& path, const std::string& text) {
+        std::ofstream(path) << text;
+    }
+
+    void addDevice(unsigned index, const std::string& name, const std::vector<std::uintptr_t>& addresses) {
+        const auto dir = root / "sys" / ("uio" + std::to_string(index));
+        std::filesystem::create_directories(dir);
+        write(dir / "name", name + "\n");
+        write(dir / "version", "devicetree\n");
+        for (size_t i = 0; i < addresses.size(); ++i) {
+            const auto map = dir / "maps" / ("map" + std::to_string(i));
+            std::filesystem::create_directories(map);
+            char addr[32];
+            snprintf(addr, sizeof(addr), "0x%08lx\n", static_cast<unsigned long>(addresses[i]));
+            write(map / "addr", addr);
+            write(map / "name", "map" + std::to_string(i) + "\n");
+            write(map / "offset", "0x0\n");
+            write(map / "size", "0x00010000\n");
+        }
+    }
+
+    void addNode(const char* tree, const std::string& node, const std::string& property, const std::string& value) {
+        const auto dir = root / tree / node;
+        std::filesystem::create_directories(dir);
+        write(dir / property, value);
+    }
+};
+
+} // namespace
+
+TEST_CASE("UioRegistry indexes devices by name, index and address", "[uio_registry]") {
+    FakeSystem sys;
+    UioRegistry registry(sys.options);
+
+    REQUIRE(registry.getEntries().size() == 2);
+
+    const auto capture = registry.findByName("axi-data-capture");
+    REQUIRE(capture);
+    CHECK(capture->index == 1);
+    CHECK(capture->name == "AXI-Data-Capture");
+    CHECK(capture->version == "devicetree");
+    REQUIRE(capture->maps.size() == 2);
+    CHECK(capture->maps[0].addr == 0x43C00000);
+    CHECK(capture->maps[1].addr == 0x1F000000);
+    CHECK(capture->maps[1].size == 0x10000);
+    CHECK(capture->maps[1].map == nullptr);
+    CHECK(capture->device_tree_node == (sys.root / "dt2" / "axi_data_capture@43c00000").string());
+
+    CHECK(registry.findByIndex(1) == capture);
+    CHECK(registry.findByAddress(0x1F000000) == capture);
+    CHECK_FALSE(registry.findByAddress(0x1F000004));
+    CHECK_FALSE(registry.findByIndex(2));
+    CHECK_FALSE(registry.findByName("uart"));
+}
+
+TEST_CASE("UioRegistry::find accepts the names UioDevice accepts", "[uio_registry]") {
+    FakeSystem sys;
+    UioRegistry registry(sys.options);
+
+    const auto gpio = registry.findByIndex(0);
+    REQUIRE(gpio);
+    CHECK(registry.find("0") == gpio);
+    CHECK(registry.find("uio0") == gpio);
+    CHECK(registry.find("/dev/uio0") == gpio);
+    CHECK(registry.find("GPIO") == gpio);
+    CHECK_FALSE(registry.find("uio7"));
+    CHECK_THROWS_AS(registry.open("uio7"), std::runtime_error);
+}
+
+TEST_CASE("UioRegistry takes the node from the first device tree root", "[uio_registry]") {
+    FakeSystem sys;
+    UioRegistry registry(sys.options);
+
+    const auto gpio = registry.find("gpio");
+    REQUIRE(gpio);
+    CHECK(gpio->device_tree_node == (sys.root / "dt1" / "gpio@41200000").string());
+
+    smart::UioDevice::IpCoreConfigurationMap configuration;
+    smart::UioDevice::readDeviceTreeNode(configuration, gpio->device_tree_node);
+    REQUIRE(configuration.count("xlnx,gpio-width") == 1);
+    CHECK(configuration["xlnx,gpio-width"] == std::vector<std::uint8_t>{ '8' });
+}
+
+TEST_CASE("UioRegistry::refresh keeps entries handed out", "[uio_registry]") {
+    FakeSystem sys;
+    UioRegistry registry(sys.options);
+
+    const auto gpio = registry.find("gpio");
+    std::filesystem::remove_all(sys.root / "sys" / "uio0");
+    sys.addDevice(2, "uart", { 0x42C00000 });
+    registry.refresh();
+
+    CHECK_FALSE(registry.find("gpio"));
+    CHECK(registry.find("uart"));
+    REQUIRE(gpio);
+    CHECK(gpio->name == "gpio");
+}
+
+TEST_CASE("UioRegistry::update refreshes when a device node appears", "[uio_registry]") {
+    FakeSystem sys;
+    UioRegistry registry(sys.options);
+
+    const int fd = registry.watch();
+    REQUIRE(fd >= 0);
+    CHECK(registry.watch() == fd);
+    CHECK_FALSE(registry.update());
+
+    sys.addDevice(3, "uart", { 0x42C00000 });
+    FakeSystem::write(sys.root / "dev" / "console", "");
+    CHECK_FALSE(registry.update());
+    CHECK_FALSE(registry.find("uart"));
+
+    FakeSystem::write(sys.root / "dev" / "uio3", "");
+    CHECK(registry.update());
+    const auto uart = registry.find("uio3");
+    REQUIRE(uart);
+    CHECK(uart->name == "uart");
+}
+
+TEST_CASE("UioRegistry::watch creates one inotify descriptor for all threads", "[uio_registry]") {
+    FakeSystem sys;
+    UioRegistry registry(sys.options);
+
+    std::vector<int> fds(8, -1);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < fds.size(); ++i) {
+        threads.emplace_back([&registry, &fds, i] {
+            fds[i] = registry.watch();
+            registry.update();
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (const int fd : fds) {
+        CHECK(fd == fds[0]);
+    }
+}
@@ -172,3 +172,68 @@ TEST_CASE("writeFile/readHeader roundtrip", "[wav]") {
     // Clean up temp file
     std::remove(temp_file);
 }
+
+TEST_CASE("makeStreamHeader RIFF layout", "[wav]") {
+    std::vector<uint8_t> header;
+    smart::WavFormat::makeStreamHeader(header, 2, 16, 48000, 1000, 4096);
+
+    REQUIRE(header.size() == 4096);
+    REQUIRE(memcmp(&header[0], "RIFF", 4) == 0);
+    REQUIRE(read_u32_le(&header[4]) == 4096 - 8 + 1000);
+    REQUIRE(memcmp(&header[12], "fmt ", 4) == 0);
+    REQUIRE(memcmp(&header[36], "JUNK", 4) == 0);
+    REQUIRE(memcmp(&header[4088], "data", 4) == 0);
+    REQUIRE(read_u32_le(&header[4092]) == 1000);
+}
+
+TEST_CASE("makeStreamHeader switches to RF64 above 4 GiB", "[wav]") {
+    std::vector<uint8_t> header;
+    const uint64_t data_size = 5ull * 1024 * 1024 * 1024;
+    smart::WavFormat::makeStreamHeader(header, 2, 16, 48000, data_size, 4096);
+
+    REQUIRE(header.size() == 4096);
+    REQUIRE(memcmp(&header[0], "RF64", 4) == 0);
+    REQUIRE(read_u32_le(&header[4]) == 0xFFFFFFFFu);
+    REQUIRE(memcmp(&header[12], "ds64", 4) == 0);
+    REQUIRE(read_u32_le(&header[16]) == 28);
+    REQUIRE(read_u32_le(&header[20]) + (uint64_t(read_u32_le(&header[24])) << 32) == 4096 - 8 + data_size);
+    REQUIRE(read_u32_le(&header[28]) + (uint64_t(read_u32_le(&header[32])) << 32) == data_size);
+    REQUIRE(read_u32_le(&header[36]) + (uint64_t(read_u32_le(&header[40])) << 32) == data_size / 4);
+    REQUIRE(memcmp(&header[48], "fmt ", 4) == 0);
+    REQUIRE(memcmp(&header[4088], "data", 4) == 0);
+    REQUIRE(read_u32_le(&header[4092]) == 0xFFFFFFFFu);
+}
+
+TEST_CASE("makeStreamHeader rejects too small headers", "[wav]") {
+    std::vector<uint8_t> header;
+    REQUIRE_THROWS(smart::WavFormat::makeStreamHeader(header, 2, 16, 48000, 0, 44));
+    // RF64 needs 36 more bytes, leaving 4 bytes that cannot hold a JUNK chunk.
+    REQUIRE_THROWS(smart::WavFormat::makeStreamHeader(header, 2, 16, 48000, 5ull << 30, 84));
+}
+
+TEST_CASE("makeStreamHeader/readHeader roundtrip", "[wav]") {
+    const char* temp_file = "/tmp/test_wav_format_stream.wav";
+    std::vector<uint8_t> header;
+    std::vector<uint8_t> sample_data(64, 0x5A);
+    smart::WavFormat::makeStreamHeader(header, 4, 32, 78125, sample_data.size(), 512);
+
+    FILE* fout = fopen(temp_file, "wb");
+    REQUIRE(fout != nullptr);
+    fwrite(header.data(), 1, header.size(), fout);
+    fwrite(sample_data.data(), 1, sample_data.size(), fout);
+    fclose(fout);
+
+    FILE* fin = fopen(temp_file, "rb");
+    REQUIRE(fin != nullptr);
+    unsigned int channels = 0, bits = 0, rate = 0, data_size = 0;
+    smart::WavFormat::readHeader(fin, channels, bits, rate, data_size);
+    const long data_offset = ftell(fin);
+    fclose(fin);
+    std::remove(temp_file);
+
+    REQUIRE(channels == 4);
+    REQUIRE(bits == 32);
+    REQUIRE(rate == 78125);
+    REQUIRE(data_size == 64);
+    REQUIRE(data_offset == 512);
+}